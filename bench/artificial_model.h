@@ -0,0 +1,135 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ACCLIMATE_BENCH_ARTIFICIAL_MODEL_H
+#define ACCLIMATE_BENCH_ARTIFICIAL_MODEL_H
+
+#include <cstddef>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "ModelRun.h"
+#include "settingsnode.h"
+#include "settingsnode/yaml.h"
+
+namespace acclimate::bench {
+
+// settings for a model run on the artificial network of ModelInitializer::build_artificial_network, with a capacity shock
+// of SEC1:RG0 from timestep 2 to 5 so that the run leaves the baseline
+struct ArtificialModel {
+    std::size_t regions = 10;
+    std::size_t sectors = 10;
+    std::size_t basket_size = 5;  // number of sectors per consumer basket
+    unsigned int timesteps = 10;
+    std::string model_parameters;    // further lines for the model node, e.g. "batched_purchasing: true"
+    std::string network_parameters;  // further lines for the network node
+
+    std::string settings() const {
+        std::ostringstream ss;
+        ss << "log_level: warning\n"
+              "model:\n"
+              "  delta_t: 1\n"
+              "  no_self_supply: true\n"
+              "  transport_penalty_small: 0.1\n"
+              "  transport_penalty_large: 10\n"
+              "  optimization_maxiter: 10000\n"
+              "  optimization_timeout: 60\n"
+              "  cheapest_price_range_width: auto\n";
+        indent(ss, model_parameters);
+        ss << "network:\n"
+              "  type: artificial\n"
+              "  regions: "
+           << regions
+           << "\n"
+              "  sectors: "
+           << sectors
+           << "\n"
+              "  skewness: 2\n";
+        indent(ss, network_parameters);
+        ss << "transport:\n"
+              "  type: const\n"
+              "  value: 1\n"
+              "sectors:\n"
+              "  ALL:\n"
+              "    upper_storage_limit: 2.0\n"
+              "    initial_storage_fill_factor: 15\n"
+              "    transport: roadsea\n"
+              "    supply_elasticity: 0.05\n"
+              "    price_increase_production_extension: 5.0\n"
+              "    initial_markup: 0.1\n"
+              "    target_storage_refill_time: 2\n"
+              "    target_storage_withdraw_time: 2\n"
+              "firms:\n"
+              "  ALL:\n"
+              "    possible_overcapacity_ratio: 1.25\n"
+              "consumers:\n"
+              "  ALL:\n"
+              "    bool_utilitarian: true\n"
+              "    consumption_price_elasticity: -0.5\n"
+              "    inter_basket_substitution_coefficient: 0.5\n"
+              "    consumer_baskets:\n";
+        for (std::size_t first = 0; first < sectors; first += basket_size) {
+            ss << "      - substituition_coefficient: 0.8\n"
+                  "        sectors: [";
+            for (std::size_t i = first; i < first + basket_size && i < sectors; ++i) {
+                ss << (i == first ? "" : ", ") << "SEC" << i + 1;
+            }
+            ss << "]\n";
+        }
+        ss << "scenario:\n"
+              "  type: events\n"
+              "  start: 0\n"
+              "  stop: "
+           << timesteps - 1
+           << "\n"
+              "  events:\n"
+              "    - type: shock\n"
+              "      from: 2\n"
+              "      to: 5\n"
+              "      targets:\n"
+              "        - firm:\n"
+              "            sector: SEC1\n"
+              "            region: RG0\n"
+              "            remaining_capacity: 0.5\n"
+              "outputs: []\n";
+        return ss.str();
+    }
+
+    // constructs and initializes the model, call run() on the result to iterate it
+    std::unique_ptr<ModelRun> create() const {
+        std::istringstream ss(settings());
+        return std::make_unique<ModelRun>(settings::SettingsNode(std::make_unique<settings::YAML>(ss)));
+    }
+
+  private:
+    static void indent(std::ostringstream& ss, const std::string& lines) {
+        std::istringstream in(lines);
+        std::string line;
+        while (std::getline(in, line)) {
+            ss << "  " << line << "\n";
+        }
+    }
+};
+
+}  // namespace acclimate::bench
+
+#endif
@@ -0,0 +1,105 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Model iterations with purchasing problems solved per agent through NLopt or in batches of same dimension (model.batched_purchasing).
+// In the artificial network all storages have one or two suppliers, so nearly all problems fall into two batch dimensions.
+// BM_BatchedAgainstNLopt re-solves every batched problem with NLopt (model.batched_purchasing_cross_check_tolerance) and fails if the batched
+// solution is costlier by more than the tolerance; it checks the last timestep of runs of different lengths, before, during and after the shock.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "ModelRun.h"
+#include "artificial_model.h"
+#include "model/EconomicAgent.h"
+#include "model/Model.h"
+#include "model/PurchasingManager.h"
+#include "model/Storage.h"
+
+namespace acclimate::bench {
+
+// arguments: number of regions (with 10 sectors each), batched (0 or 1)
+static void BM_Purchasing(benchmark::State& state) {
+    ArtificialModel artificial;
+    artificial.regions = static_cast<std::size_t>(state.range(0));
+    artificial.timesteps = 10;
+    artificial.model_parameters = state.range(1) != 0 ? "batched_purchasing: true" : "batched_purchasing: false";
+    std::size_t storages = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto run = artificial.create();
+        storages = 0;
+        for (const auto& economic_agent : run->model()->economic_agents) {
+            storages += economic_agent->input_storages.size();
+        }
+        state.ResumeTiming();
+        run->run();
+        state.PauseTiming();
+        run.reset();
+        state.ResumeTiming();
+    }
+    state.counters["storages"] = static_cast<double>(storages);
+    state.counters["problems/s"] =
+        benchmark::Counter(static_cast<double>(storages * artificial.timesteps * state.iterations()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Purchasing)->ArgsProduct({{10, 100}, {0, 1}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// arguments: number of timesteps
+static void BM_BatchedAgainstNLopt(benchmark::State& state) {
+    static constexpr double TOLERANCE = 1e-6;
+    ArtificialModel artificial;
+    artificial.regions = 10;
+    artificial.timesteps = static_cast<std::size_t>(state.range(0));
+    artificial.model_parameters = "batched_purchasing: true\nbatched_purchasing_cross_check_tolerance: 1e-6";
+    double max_deviation = 0.0;
+    std::size_t checked = 0;
+    for (auto _ : state) {
+        auto run = artificial.create();
+        run->run();
+        state.PauseTiming();
+        max_deviation = 0.0;
+        checked = 0;
+        for (const auto& economic_agent : run->model()->economic_agents) {
+            for (const auto& storage : economic_agent->input_storages) {
+                const auto deviation = storage->purchasing_manager->batched_deviation();
+                if (!std::isnan(deviation)) {
+                    max_deviation = std::max(max_deviation, static_cast<double>(deviation));
+                    ++checked;
+                }
+            }
+        }
+        run.reset();
+        state.ResumeTiming();
+    }
+    state.counters["checked"] = static_cast<double>(checked);
+    state.counters["max_deviation"] = max_deviation;
+    if (checked == 0) {
+        state.SkipWithError("no batched problems were cross-checked");
+    } else if (max_deviation > TOLERANCE) {
+        state.SkipWithError("batched purchasing deviates from NLopt");
+    }
+}
+BENCHMARK(BM_BatchedAgainstNLopt)->Arg(3)->Arg(6)->Arg(10)->Unit(benchmark::kMillisecond)->Iterations(1);
+
+}  // namespace acclimate::bench
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+# Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+#                         Christian Otto <christian.otto@pik-potsdam.de>
+#
+# This file is part of Acclimate.
+#
+# Acclimate is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of
+# the License, or (at your option) any later version.
+#
+# Acclimate is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+
+"""Compares the variables of two Acclimate NetCDF outputs (all groups, ignoring global attributes such as run times and version).
+
+Exits with 0 if all variables are identical (NaN equal to NaN) or within the given tolerance, with 1 otherwise.
+"""
+
+import argparse
+import sys
+
+import netCDF4
+import numpy as np
+
+
+def walk(group, path=""):
+    yield path, group
+    for name, subgroup in group.groups.items():
+        yield from walk(subgroup, path + "/" + name)
+
+
+def compare(file_a, file_b, rtol, atol):
+    differing = 0
+    with netCDF4.Dataset(file_a) as a, netCDF4.Dataset(file_b) as b:
+        groups_a = dict(walk(a))
+        groups_b = dict(walk(b))
+        for path in sorted(set(groups_a) | set(groups_b)):
+            if path not in groups_a or path not in groups_b:
+                print(f"group {path or '/'} only in {file_a if path in groups_a else file_b}")
+                differing += 1
+                continue
+            vars_a = groups_a[path].variables
+            vars_b = groups_b[path].variables
+            for name in sorted(set(vars_a) | set(vars_b)):
+                if name not in vars_a or name not in vars_b:
+                    print(f"{path}/{name} only in {file_a if name in vars_a else file_b}")
+                    differing += 1
+                    continue
+                x = vars_a[name][:]
+                y = vars_b[name][:]
+                if x.shape != y.shape:
+                    print(f"{path}/{name}: shapes differ {x.shape} != {y.shape}")
+                    differing += 1
+                    continue
+                if x.dtype.kind not in "fiu":
+                    if not np.array_equal(x, y):
+                        print(f"{path}/{name}: differs")
+                        differing += 1
+                    continue
+                x = np.ma.filled(x.astype(float), np.nan)
+                y = np.ma.filled(y.astype(float), np.nan)
+                close = np.isclose(x, y, rtol=rtol, atol=atol, equal_nan=True)
+                if not close.all():
+                    diff = np.abs(x - y)
+                    print(f"{path}/{name}: {np.count_nonzero(~close)} of {close.size} values differ, max abs difference {np.nanmax(diff)}")
+                    differing += 1
+    return differing
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("file_a")
+    parser.add_argument("file_b")
+    parser.add_argument("--rtol", type=float, default=0, help="relative tolerance (default: exact)")
+    parser.add_argument("--atol", type=float, default=0, help="absolute tolerance (default: exact)")
+    args = parser.parse_args()
+    differing = compare(args.file_a, args.file_b, args.rtol, args.atol)
+    if differing:
+        print(f"{differing} variables differ")
+        sys.exit(1)
+    print("outputs are identical" if args.rtol == 0 and args.atol == 0 else "outputs agree within tolerance")
+
+
+if __name__ == "__main__":
+    main()
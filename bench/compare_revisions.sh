@@ -0,0 +1,61 @@
+#!/usr/bin/env bash
+# Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+#                         Christian Otto <christian.otto@pik-potsdam.de>
+#
+# This file is part of Acclimate.
+#
+# Acclimate is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as
+# published by the Free Software Foundation, either version 3 of
+# the License, or (at your option) any later version.
+#
+# Acclimate is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+
+# Builds two revisions of Acclimate (Release), runs both on the same settings and compares their NetCDF outputs and run times.
+# Used as equivalence check for changes that must not alter results, e.g.
+#   bench/compare_revisions.sh HEAD~1 HEAD
+#   OMP_NUM_THREADS=1 bench/compare_revisions.sh HEAD~1 HEAD bench/artificial.yml --rtol 1e-12
+# Further cmake arguments can be given in CMAKE_ARGS. Needs git, cmake, and python3 with netCDF4 and numpy.
+
+set -euo pipefail
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <revision a> <revision b> [<settings file>] [<compare_outputs.py options>...]" >&2
+    exit 1
+fi
+revision_a=$1
+revision_b=$2
+source_dir=$(git -C "$(dirname "$0")" rev-parse --show-toplevel)
+settings=$(realpath "${3:-$source_dir/bench/artificial.yml}")
+shift $(($# < 3 ? $# : 3))
+workdir=$(mktemp -d)
+trap 'git -C "$source_dir" worktree remove --force "$workdir/a" 2>/dev/null || true; git -C "$source_dir" worktree remove --force "$workdir/b" 2>/dev/null || true; rm -rf "$workdir"' EXIT
+
+for side in a b; do
+    revision_var=revision_$side
+    revision=${!revision_var}
+    echo "== building $revision"
+    git -C "$source_dir" worktree add --detach "$workdir/$side" "$revision" >/dev/null
+    git -C "$workdir/$side" submodule update --init --recursive >/dev/null
+    cmake -S "$workdir/$side" -B "$workdir/$side/build" -DCMAKE_BUILD_TYPE=Release ${CMAKE_ARGS:-} >/dev/null
+    cmake --build "$workdir/$side/build" -j"$(nproc)" --target acclimate >/dev/null
+    mkdir "$workdir/run_$side"
+done
+
+for side in a b; do
+    revision_var=revision_$side
+    echo "== running ${!revision_var}"
+    start=$(date +%s.%N)
+    (cd "$workdir/run_$side" && "$workdir/$side/build/acclimate" "$settings" >log.txt 2>&1)
+    end=$(date +%s.%N)
+    echo "wall time: $(echo "$end - $start" | bc) s"
+done
+
+echo "== comparing outputs"
+python3 "$source_dir/bench/compare_outputs.py" "$@" "$workdir/run_a/output.nc" "$workdir/run_b/output.nc"
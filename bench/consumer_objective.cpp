@@ -0,0 +1,64 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Cost of one evaluation of the consumer utility objective and its gradient, as called by NLopt. Only uses the public
+// Consumer::max_objective, so that the same file can be built against earlier revisions for comparison. Needs the full
+// model (NLopt, NetCDF and the library submodules) and has not been run so far; consumer_utility.cpp times the
+// utility kernel itself without a model.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "ModelRun.h"
+#include "artificial_model.h"
+#include "model/Consumer.h"
+#include "model/EconomicAgent.h"
+#include "model/Model.h"
+
+namespace acclimate::bench {
+
+// argument: number of sectors, i.e. consumer inputs (in baskets of 5)
+static void BM_ConsumerObjective(benchmark::State& state) {
+    ArtificialModel artificial;
+    artificial.regions = 2;
+    artificial.sectors = static_cast<std::size_t>(state.range(0));
+    artificial.timesteps = 3;
+    auto run = artificial.create();
+    run->run();
+    // the objective only reads the utility parameters but is non-const as it uses pre-allocated buffers
+    auto* consumer = const_cast<Consumer*>(run->model()->economic_agents.find("FCON:RG0")->as_consumer());
+    const auto n = consumer->input_storages.size();
+    std::vector<double> x(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        x[i] = 0.8 + 0.4 * static_cast<double>(i % 5) / 4;  // baseline-relative consumption within the usual bounds
+    }
+    std::vector<double> grad(n);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(consumer->max_objective(x.data(), grad.data()));
+        benchmark::ClobberMemory();
+    }
+    state.counters["inputs"] = static_cast<double>(n);
+}
+BENCHMARK(BM_ConsumerObjective)->Arg(10)->Arg(50)->Arg(200);
+
+}  // namespace acclimate::bench
@@ -0,0 +1,115 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Cost of one evaluation of the nested CES utility of consumers with its gradient (consumption::nested_CES_utility, as called by NLopt through
+// Consumer::max_objective and by the replay of recorded problems) on random consumers, without needing a model run. Also checks the gradient
+// against central differences.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "acclimate.h"
+#include "model/ConsumptionUtility.h"
+
+namespace acclimate::bench {
+
+struct Consumer {
+    std::vector<std::vector<int>> basket_indices;
+    std::vector<FloatType> share_factors;
+    std::vector<FloatType> exponent_share_factors;
+    std::vector<FloatType> intra_basket_substitution_exponent;
+    std::vector<FloatType> basket_share_factors;
+    std::vector<FloatType> exponent_basket_share_factors;
+    FloatType inter_basket_substitution_exponent;
+    mutable std::vector<FloatType> basket_sums;
+    mutable std::vector<FloatType> basket_utilities;
+    std::vector<double> x;  // baseline-relative consumption within the usual bounds
+
+    FloatType utility(const double* x_p, double* grad) const {
+        return consumption::nested_CES_utility(x_p, grad, x.size(), basket_indices, share_factors, exponent_share_factors,
+                                               intra_basket_substitution_exponent, basket_share_factors, exponent_basket_share_factors,
+                                               inter_basket_substitution_exponent, basket_sums, basket_utilities);
+    }
+};
+
+// n goods in baskets of 5, as in the artificial network of the model benchmarks
+static Consumer make_consumer(std::size_t n, std::mt19937& rng) {
+    const auto uniform = [&rng](FloatType a, FloatType b) { return std::uniform_real_distribution<FloatType>(a, b)(rng); };
+    Consumer c;
+    const std::size_t baskets = (n + 4) / 5;
+    c.basket_indices.resize(baskets);
+    for (std::size_t i = 0; i < n; ++i) {
+        c.basket_indices[i / 5].push_back(static_cast<int>(i));
+        c.share_factors.push_back(uniform(0.5, 2));
+        c.exponent_share_factors.push_back(uniform(0.05, 0.3));
+        c.x.push_back(uniform(0.8, 1.2));
+    }
+    for (std::size_t b = 0; b < baskets; ++b) {
+        // substitution exponent (sigma - 1) / sigma for elasticities sigma between 1/3 and 3, away from sigma = 1
+        c.intra_basket_substitution_exponent.push_back(uniform(0, 1) < 0.5 ? uniform(-2, -0.2) : uniform(0.2, 0.65));
+        c.basket_share_factors.push_back(uniform(0.5, 2));
+        c.exponent_basket_share_factors.push_back(uniform(0.05, 0.3));
+    }
+    c.inter_basket_substitution_exponent = -0.5;
+    c.basket_sums.resize(baskets);
+    c.basket_utilities.resize(baskets);
+    return c;
+}
+
+// argument: number of goods
+static void BM_NestedCESUtility(benchmark::State& state) {
+    std::mt19937 rng(7);
+    const auto c = make_consumer(static_cast<std::size_t>(state.range(0)), rng);
+    std::vector<double> grad(c.x.size());
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(c.utility(c.x.data(), grad.data()));
+        benchmark::ClobberMemory();
+    }
+
+    // largest relative deviation of the gradient from central differences
+    FloatType max_deviation = 0.0;
+    std::vector<double> x = c.x;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        const double h = 1e-6;
+        x[i] = c.x[i] + h;
+        const FloatType up = c.utility(x.data(), nullptr);
+        x[i] = c.x[i] - h;
+        const FloatType down = c.utility(x.data(), nullptr);
+        x[i] = c.x[i];
+        const FloatType numeric = (up - down) / (2 * h);
+        max_deviation = std::max(max_deviation, std::abs(grad[i] - numeric) / std::max(std::abs(numeric), 1e-12));
+    }
+    state.counters["inputs"] = static_cast<double>(c.x.size());
+    state.counters["max_grad_deviation"] = max_deviation;
+    if (max_deviation > 1e-5) {
+        state.SkipWithError("gradient differs from central differences");
+    }
+}
+BENCHMARK(BM_NestedCESUtility)->Arg(10)->Arg(50)->Arg(200)->Arg(1000);
+
+}  // namespace acclimate::bench
+
+BENCHMARK_MAIN();
@@ -0,0 +1,187 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Root finding for the expected production of a firm (SalesManager::search_root_expectation) on random instances of its goal
+// function, marginal production costs minus marginal revenue. Compares the safeguarded Newton iteration against the recursive
+// bisection it replaced (kept here as reference) in time, calls and goal evaluations per root, and in the roots found.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "acclimate.h"
+#include "rootfinding.h"
+
+namespace acclimate::bench {
+
+// same curves as in SalesManager, for one firm
+struct ExpectationInstance {
+    FlowQuantity sum_demand_requests_D;
+    FlowQuantity lambda_X_star;
+    FloatType supply_elasticity;
+    Price price_increase_production_extension;
+    Price unit_production_costs_n_c;
+    Price n_min;
+    FlowQuantity production_quantity_X;  // expected production the additional quantity is added to
+    FlowQuantity maximal_additional_production_quantity;
+
+    Price marginal_costs(const FlowQuantity& X) const {
+        if (X <= lambda_X_star) {
+            return unit_production_costs_n_c;
+        }
+        return unit_production_costs_n_c + price_increase_production_extension / lambda_X_star * (X - lambda_X_star);
+    }
+    Price marginal_revenue(const FlowQuantity& X) const { return n_min * std::pow(sum_demand_requests_D / X, supply_elasticity); }
+    Price goal(const FlowQuantity& x) const {
+        const FlowQuantity X = round(production_quantity_X + x);
+        return marginal_costs(X) - marginal_revenue(X);
+    }
+    FloatType derivative(const FlowQuantity& x) const {
+        const FlowQuantity X = round(production_quantity_X + x);
+        FloatType res = supply_elasticity * to_float(marginal_revenue(X)) / to_float(X);
+        if (X > lambda_X_star) {
+            res += to_float(price_increase_production_extension) / to_float(lambda_X_star);
+        }
+        return res;
+    }
+};
+
+// instances with a root in [0, maximal_additional_production_quantity], as when the root finding is called from
+// SalesManager::calc_expected_supply_distribution_scenario
+static const std::vector<ExpectationInstance>& instances() {
+    static const std::vector<ExpectationInstance> res = [] {
+        std::vector<ExpectationInstance> v;
+        std::mt19937 rng(3);
+        const auto uniform = [&rng](FloatType a, FloatType b) { return std::uniform_real_distribution<FloatType>(a, b)(rng); };
+        while (v.size() < 3000) {
+            ExpectationInstance i;
+            const FloatType lambda_X_star = uniform(10, 1000);
+            i.lambda_X_star = FlowQuantity(lambda_X_star);
+            i.sum_demand_requests_D = FlowQuantity(uniform(1, 1.2 * lambda_X_star));
+            i.supply_elasticity = uniform(0.1, 0.9);
+            i.price_increase_production_extension = Price(uniform(0.1, 5));
+            i.unit_production_costs_n_c = Price(uniform(0.5, 1.0));
+            i.n_min = Price(uniform(to_float(i.unit_production_costs_n_c), 2.5));
+            i.production_quantity_X = i.sum_demand_requests_D;
+            i.maximal_additional_production_quantity = FlowQuantity(uniform(0.5, 1.5) * lambda_X_star);
+            if (i.goal(FlowQuantity(0.0)) < 0.0 && i.goal(i.maximal_additional_production_quantity) > 0.0) {
+                v.push_back(i);
+            }
+        }
+        return v;
+    }();
+    return res;
+}
+
+struct Counts {
+    std::size_t calls = 0;
+    std::size_t evaluations = 0;
+};
+
+// the recursive bisection formerly in SalesManager::search_root_bisec_expectation
+static FlowQuantity search_root_bisec(
+    const ExpectationInstance& i, const FlowQuantity& left, const FlowQuantity& right, const Price& precision, Counts& counts) {
+    ++counts.calls;
+    const auto goal = [&](const FlowQuantity& x) {
+        ++counts.evaluations;
+        return i.goal(x);
+    };
+    const FlowQuantity middle = (left + right) / 2;
+    if (left + FlowQuantity(FlowQuantity::precision) >= right) {
+        return abs(goal(left)) < abs(goal(right)) ? left : right;
+    }
+    if (abs(goal(middle)) < precision) {
+        return middle;
+    }
+    if (abs(goal(left)) < precision) {
+        return left;
+    }
+    if (abs(goal(right)) < precision) {
+        return right;
+    }
+    if (!same_sgn(goal(middle), goal(right))) {
+        return search_root_bisec(i, middle, right, precision, counts);
+    }
+    return search_root_bisec(i, left, middle, precision, counts);
+}
+
+static FlowQuantity search_root_newton(const ExpectationInstance& i, const Price& precision, Counts& counts) {
+    ++counts.calls;
+    const auto root = rootfinding::search_root_safeguarded_newton(
+        FlowQuantity(0.0), i.maximal_additional_production_quantity, [&i](const FlowQuantity& x) { return i.goal(x); },
+        [&i](const FlowQuantity& x) { return i.derivative(x); }, precision);
+    counts.evaluations += root.evaluations;
+    return root.x;
+}
+
+static void BM_ExpectationRootBisection(benchmark::State& state) {
+    const auto& is = instances();
+    const Price precision(Price::precision);
+    Counts counts;
+    for (auto _ : state) {
+        for (const auto& i : is) {
+            benchmark::DoNotOptimize(search_root_bisec(i, FlowQuantity(0.0), i.maximal_additional_production_quantity, precision, counts));
+        }
+    }
+    const auto roots = static_cast<double>(state.iterations() * is.size());
+    state.counters["calls/root"] = static_cast<double>(counts.calls) / roots;
+    state.counters["evaluations/root"] = static_cast<double>(counts.evaluations) / roots;
+}
+BENCHMARK(BM_ExpectationRootBisection);
+
+static void BM_ExpectationRootNewton(benchmark::State& state) {
+    const auto& is = instances();
+    const Price precision(Price::precision);
+    Counts counts;
+    for (auto _ : state) {
+        for (const auto& i : is) {
+            benchmark::DoNotOptimize(search_root_newton(i, precision, counts));
+        }
+    }
+    const auto roots = static_cast<double>(state.iterations() * is.size());
+    state.counters["calls/root"] = static_cast<double>(counts.calls) / roots;
+    state.counters["evaluations/root"] = static_cast<double>(counts.evaluations) / roots;
+
+    // deviation from the bisection result, in quantity units and in goal function value
+    double max_root_deviation = 0;
+    std::size_t goal_mismatches = 0;
+    for (const auto& i : is) {
+        Counts unused;
+        const auto bisec = search_root_bisec(i, FlowQuantity(0.0), i.maximal_additional_production_quantity, precision, unused);
+        const auto newton = search_root_newton(i, precision, unused);
+        max_root_deviation = std::max(max_root_deviation, std::abs(to_float(newton - bisec)) / FlowQuantity::precision);
+        if (abs(i.goal(newton)) < abs(i.goal(bisec)) || abs(i.goal(newton)) > abs(i.goal(bisec))) {
+            ++goal_mismatches;
+        }
+    }
+    state.counters["max_root_deviation"] = max_root_deviation;
+    state.counters["goal_mismatches"] = static_cast<double>(goal_mismatches);
+}
+BENCHMARK(BM_ExpectationRootNewton);
+
+}  // namespace acclimate::bench
+
+BENCHMARK_MAIN();
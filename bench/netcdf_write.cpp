@@ -0,0 +1,126 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Write throughput of the NetCDF output for different group settings on synthetic data, meant to mirror the
+// staging and hyperslab writes of NetCDFOutput for a (time, agent) group without needing a model run. Not built
+// or run so far (written without NetCDF at hand): the netcdfpp calls follow NetCDFOutput, and it is not yet known
+// which group settings are faster.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "netcdfpp.h"
+
+namespace {
+
+constexpr std::size_t VARIABLES_COUNT = 10;
+constexpr std::size_t TIMESTEPS_COUNT = 365;
+
+// arguments: agents, deflate level (0 disables), shuffle, agents per chunk (0 for library default chunking), slab steps
+void BM_NetCDFWrite(benchmark::State& state) {
+    const auto agents = static_cast<std::size_t>(state.range(0));
+    const auto compression_level = static_cast<int>(state.range(1));
+    const auto shuffle = state.range(2) != 0;
+    const auto chunk_agents = static_cast<std::size_t>(state.range(3));
+    const auto slab_steps = static_cast<std::size_t>(state.range(4));
+    const std::string filename = "acclimate_bench_netcdf.nc";
+
+    // smooth data with some noise, similar in compressibility to model output
+    std::vector<double> data(agents);
+    for (std::size_t i = 0; i < agents; ++i) {
+        data[i] = 1.0 + 0.1 * std::sin(static_cast<double>(i)) + 1e-6 * static_cast<double>(i % 7);
+    }
+
+    for (auto _ : state) {
+        netCDF::File file(filename, 'w');
+        const auto dim_time = file.add_dimension("time");
+        const auto dim_agent = file.add_dimension("agent", agents);
+        auto group = file.add_group("firms");
+        std::vector<netCDF::Variable> variables;
+        for (std::size_t v = 0; v < VARIABLES_COUNT; ++v) {
+            auto variable = group.add_variable<double>("var" + std::to_string(v), std::vector<int>{dim_time.id(), dim_agent.id()});
+            if (chunk_agents > 0) {
+                variable.set_chunking({slab_steps, std::min(chunk_agents, agents)});
+            }
+            if (compression_level > 0) {
+                variable.set_compression(shuffle, compression_level);
+            }
+            variable.set_fill(std::numeric_limits<double>::quiet_NaN());
+            variables.push_back(variable);
+        }
+
+        std::vector<std::vector<double>> staging(VARIABLES_COUNT, std::vector<double>(slab_steps * agents));
+        std::size_t first_timestep = 0;
+        std::size_t staged_steps = 0;
+        const auto write_staged = [&]() {
+            for (std::size_t v = 0; v < VARIABLES_COUNT; ++v) {
+                staging[v].resize(staged_steps * agents);
+                variables[v].set<double, 2>(staging[v], {first_timestep, 0}, {staged_steps, agents});
+                staging[v].resize(slab_steps * agents);
+            }
+            first_timestep += staged_steps;
+            staged_steps = 0;
+        };
+        for (std::size_t t = 0; t < TIMESTEPS_COUNT; ++t) {
+            for (std::size_t v = 0; v < VARIABLES_COUNT; ++v) {
+                auto* out = &staging[v][staged_steps * agents];
+                for (std::size_t i = 0; i < agents; ++i) {
+                    out[i] = data[i] * (1.0 + 1e-3 * static_cast<double>(t + v));
+                }
+            }
+            ++staged_steps;
+            if (staged_steps == slab_steps) {
+                write_staged();
+            }
+        }
+        if (staged_steps > 0) {
+            write_staged();
+        }
+        file.close();
+    }
+
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * TIMESTEPS_COUNT * VARIABLES_COUNT * agents * sizeof(double)));
+    std::remove(filename.c_str());
+}
+
+}  // namespace
+
+// first line is the previous fixed configuration (deflate 7, no shuffle, library chunking, one write per timestep)
+BENCHMARK(BM_NetCDFWrite)
+    ->ArgNames({"agents", "deflate", "shuffle", "chunk", "slab"})
+    ->Args({5000, 7, 0, 0, 1})
+    ->Args({5000, 7, 1, 0, 1})
+    ->Args({5000, 1, 1, 0, 1})
+    ->Args({5000, 1, 1, 5000, 1})
+    ->Args({5000, 1, 1, 5000, 16})
+    ->Args({5000, 1, 1, 1000, 16})
+    ->Args({5000, 0, 0, 5000, 16})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,57 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Model iterations on a star-heavy network, in which the hub firm SEC1:RG0 supplies to and buys from every other firm, with and
+// without splitting the connection loops of such hub agents into tasks for idle threads.
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <string>
+
+#include "ModelRun.h"
+#include "artificial_model.h"
+
+namespace acclimate::bench {
+
+// arguments: number of regions (the hub sells to about 2 * regions buyers, each of its two input storages has about regions suppliers),
+//            nested_parallelization_threshold (0 for no task splitting)
+static void BM_StarNetwork(benchmark::State& state) {
+    ArtificialModel artificial;
+    artificial.regions = static_cast<std::size_t>(state.range(0));
+    artificial.sectors = 2;
+    artificial.timesteps = 5;
+    artificial.network_parameters = "star: true";
+    artificial.model_parameters = "nested_parallelization_threshold: " + std::to_string(state.range(1));
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto run = artificial.create();
+        state.ResumeTiming();
+        run->run();
+        state.PauseTiming();
+        run.reset();
+        state.ResumeTiming();
+    }
+    state.counters["timesteps"] = artificial.timesteps;
+}
+BENCHMARK(BM_StarNetwork)->ArgsProduct({{250, 1000}, {0, 100}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}  // namespace acclimate::bench
@@ -0,0 +1,194 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Serving of demand requests in the actual and the expected supply distribution of a firm (SalesManager::serve_demand_requests) on random
+// connection books. Compares the per-scenario loop over the connections it replaced (kept here as reference) with the demand book taken once
+// per timestep and served for both scenarios, in time and in the results, which have to be identical.
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "acclimate.h"
+#include "model/DemandBook.h"
+
+namespace acclimate::bench {
+
+struct Connection {
+    Demand last_demand_request_D = Demand(0.0);
+};
+
+// same curve as in SalesManager, for one firm
+struct Firm {
+    FlowQuantity lambda_X_star;
+    FlowQuantity lambda_beta_X_star;  // marginal costs are infinite beyond
+    Price price_increase_production_extension;
+
+    Price marginal_costs(const FlowQuantity& X, const Price& n_c) const {
+        if (X <= lambda_X_star) {
+            return n_c;
+        }
+        if (X > lambda_beta_X_star) {
+            return Price::quiet_NaN();
+        }
+        return n_c + price_increase_production_extension / lambda_X_star * (X - lambda_X_star);
+    }
+};
+
+// inputs of one scenario, actual or expected
+struct Scenario {
+    FlowQuantity possible_production_quantity_X_hat;
+    Price minimal_production_price;
+    Price minimal_extension_price;
+};
+
+struct Instance {
+    Firm firm;
+    std::vector<std::shared_ptr<Connection>> connections;  // sorted by price, zero demand requests last
+    Scenario actual;
+    Scenario expected;
+};
+
+static const std::vector<Instance>& instances() {
+    static const std::vector<Instance> res = [] {
+        std::vector<Instance> v;
+        std::mt19937 rng(5);
+        const auto uniform = [&rng](FloatType a, FloatType b) { return std::uniform_real_distribution<FloatType>(a, b)(rng); };
+        for (std::size_t n = 0; n < 2000; ++n) {
+            Instance i;
+            const auto connections = static_cast<std::size_t>(uniform(1, n % 10 == 0 ? 400 : 20));
+            const auto zero = static_cast<std::size_t>(uniform(0, 0.3) * connections);
+            FloatType price = uniform(1.0, 2.5);
+            FloatType sum = 0.0;
+            for (std::size_t c = 0; c < connections; ++c) {
+                auto connection = std::make_shared<Connection>();
+                if (c < connections - zero) {
+                    const FloatType quantity = uniform(0.1, 100);
+                    sum += quantity;
+                    connection->last_demand_request_D = round(Demand(FlowQuantity(quantity), Price(price)));
+                    price = std::max(0.5, price - uniform(0, 0.05));
+                }
+                i.connections.push_back(connection);
+            }
+            i.firm.lambda_X_star = FlowQuantity(uniform(0.3, 1.2) * std::max(sum, 1.0));
+            i.firm.lambda_beta_X_star = i.firm.lambda_X_star * uniform(1.05, 1.5);
+            i.firm.price_increase_production_extension = Price(uniform(0.1, 5));
+            for (auto* scenario : {&i.actual, &i.expected}) {
+                scenario->possible_production_quantity_X_hat = round(FlowQuantity(uniform(0.2, 1.5) * std::max(sum, 1.0)));
+                scenario->minimal_production_price = round(Price(uniform(0.5, 1.2)));
+                scenario->minimal_extension_price = uniform(0, 1) < 0.5 ? scenario->minimal_production_price : round(Price(uniform(0.5, 1.5)));
+            }
+            v.push_back(std::move(i));
+        }
+        return v;
+    }();
+    return res;
+}
+
+// the loop formerly in SalesManager::serve_demand_requests, run once per scenario; returns number of served connections, production and whether
+// all were served
+static std::tuple<std::size_t, Flow, bool> serve_connections(const Instance& i, const Scenario& s) {
+    Flow production_X = Flow(0.0);
+    auto business_connection = i.connections.begin();
+    for (; business_connection != i.connections.end(); ++business_connection) {
+        const Demand& demand_request_D = (*business_connection)->last_demand_request_D;
+        if (demand_request_D.get_quantity() <= 0.0) {
+            break;
+        }
+        const FlowQuantity production_quantity_X_served = round(production_X + demand_request_D).get_quantity();
+        if (production_quantity_X_served > s.possible_production_quantity_X_hat) {
+            return {business_connection - i.connections.begin(), round(production_X), false};
+        }
+        const Price maximal_marginal_production_costs = i.firm.marginal_costs(
+            production_quantity_X_served, production_X.get_quantity() < i.firm.lambda_X_star ? s.minimal_production_price : s.minimal_extension_price);
+        if (isnan(maximal_marginal_production_costs) || round(demand_request_D.get_price()) < round(maximal_marginal_production_costs)) {
+            return {business_connection - i.connections.begin(), round(production_X), false};
+        }
+        production_X += demand_request_D;
+    }
+    return {business_connection - i.connections.begin(), round(production_X), true};
+}
+
+static sales::Served serve_book(const Instance& i, const sales::DemandBook& book, const Scenario& s) {
+    return sales::serve(book, s.possible_production_quantity_X_hat, i.firm.lambda_X_star, s.minimal_production_price, s.minimal_extension_price,
+                        [&i](const FlowQuantity& X, const Price& n_c) { return i.firm.marginal_costs(X, n_c); });
+}
+
+static void take_book(const Instance& i, sales::DemandBook& book) {
+    book.assign(std::begin(i.connections), std::end(i.connections),
+                [](const std::shared_ptr<Connection>& c) -> const Demand& { return c->last_demand_request_D; });
+}
+
+static void BM_ServeConnections(benchmark::State& state) {
+    const auto& is = instances();
+    for (auto _ : state) {
+        for (const auto& i : is) {
+            benchmark::DoNotOptimize(serve_connections(i, i.actual));
+            benchmark::DoNotOptimize(serve_connections(i, i.expected));
+        }
+    }
+    state.counters["firms/s"] = benchmark::Counter(static_cast<double>(state.iterations() * is.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ServeConnections);
+
+static void BM_ServeDemandBook(benchmark::State& state) {
+    const auto& is = instances();
+    sales::DemandBook book;
+    for (auto _ : state) {
+        for (const auto& i : is) {
+            take_book(i, book);
+            benchmark::DoNotOptimize(serve_book(i, book, i.actual));
+            benchmark::DoNotOptimize(serve_book(i, book, i.expected));
+        }
+    }
+    state.counters["firms/s"] = benchmark::Counter(static_cast<double>(state.iterations() * is.size()), benchmark::Counter::kIsRate);
+
+    // both have to give the same results for both scenarios, down to the last bit
+    std::size_t mismatches = 0;
+    std::size_t partially_served = 0;
+    for (const auto& i : is) {
+        take_book(i, book);
+        for (const auto* s : {&i.actual, &i.expected}) {
+            const auto [count, production_X, all] = serve_connections(i, *s);
+            const auto served = serve_book(i, book, *s);
+            if (served.count != count || served.all != all || to_float(served.production_X.get_quantity()) != to_float(production_X.get_quantity())
+                || to_float(served.production_X.get_value()) != to_float(production_X.get_value())) {
+                ++mismatches;
+            }
+            partially_served += all ? 0 : 1;
+        }
+    }
+    state.counters["mismatches"] = static_cast<double>(mismatches);
+    state.counters["partially_served"] = static_cast<double>(partially_served) / (2 * is.size());
+    if (mismatches > 0) {
+        state.SkipWithError("demand book results differ from serving the connections");
+    }
+}
+BENCHMARK(BM_ServeDemandBook);
+
+}  // namespace acclimate::bench
+
+BENCHMARK_MAIN();
@@ -23,9 +23,19 @@
 
 #include <features.h>  // for __STRING
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
 #include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 #include "types.h"  // IWYU pragma: export
 
@@ -58,8 +68,15 @@ IterationStep current_step(const Model& m);
 
 namespace log {
 
+enum class level_t : unsigned char { VERBOSE, INFO, WARNING, NONE };
+
+// lowest level compiled into the binary at all; messages below it cost nothing
+constexpr level_t COMPILED_LEVEL = (options::DEBUGGING || options::LOGGING) ? level_t::VERBOSE : level_t::NONE;
+
 namespace detail {
 
+inline std::atomic<level_t> runtime_level{level_t::INFO};
+
 template<class Stream, typename Arg>
 inline void to_stream(Stream& s, Arg&& arg) {
     s << arg;
@@ -71,12 +88,73 @@ inline void to_stream(Stream& s, Arg&& arg, Args&&... args) {
     to_stream(s, std::forward<Args>(args)...);
 }
 
+class Message {
+  public:
+    std::uint64_t sequence = 0;
+    virtual ~Message() = default;
+    virtual void write(std::ostream& os) const = 0;
+};
+
+template<typename... Args>
+class DeferredMessage final : public Message {
+  private:
+    std::tuple<Args...> args;
+
+  public:
+    template<typename... Params>
+    explicit DeferredMessage(Params&&... params) : args(std::forward<Params>(params)...) {}
+    void write(std::ostream& os) const override {
+        std::apply([&os](const auto&... a) { (os << ... << a); }, args);
+    }
+};
+
+// converts a log argument into a value the logger thread can safely format later
+template<typename Arg>
+inline auto capture(Arg&& arg) {
+    using T = std::decay_t<Arg>;
+    if constexpr (std::is_array_v<std::remove_reference_t<Arg>>) {
+        return static_cast<const std::remove_extent_t<std::remove_reference_t<Arg>>*>(arg);  // string literal, static storage
+    } else if constexpr (std::is_invocable_v<Arg>) {
+        return capture(arg());  // lazily computed argument, only evaluated if the message passes the filter
+    } else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*> || std::is_same_v<T, std::string_view>) {
+        return std::string(arg);
+    } else if constexpr (std::is_pointer_v<T>) {  // pointee might have changed or be gone when formatted, so format now
+        std::ostringstream ss;
+        ss << arg;
+        return ss.str();
+    } else if constexpr (std::is_copy_constructible_v<T>) {
+        return T(std::forward<Arg>(arg));
+    } else {
+        std::ostringstream ss;
+        ss << arg;
+        return ss.str();
+    }
+}
+
+// messages are constructed in place in preallocated slots of a per-thread ring buffer; larger messages are formatted into a string first
+constexpr std::size_t MESSAGE_SLOT_SIZE = 256;
+
+// storage of MESSAGE_SLOT_SIZE bytes in the calling thread's buffer, nullptr if the buffer is full (the message is then dropped and counted)
+void* acquire_slot();
+// queues the message constructed in the storage returned by the preceding acquire_slot of the same thread
+void publish_slot(Message* message);
+void write_immediately(const std::string& text);
+
+// arguments are evaluated at the call site as for any function call; only arguments passed as lambdas are evaluated here, i.e. after the level
+// filter and only if the message is not dropped
 template<typename... Args>
 inline void output(Args&&... args) {
-#pragma omp critical(output)
-    {
-        to_stream(std::cout, std::forward<Args>(args)...);
-        std::cout << std::endl;
+    void* slot = acquire_slot();
+    if (slot == nullptr) {
+        return;
+    }
+    using M = DeferredMessage<decltype(capture(std::forward<Args>(args)))...>;
+    if constexpr (sizeof(M) <= MESSAGE_SLOT_SIZE && alignof(M) <= alignof(std::max_align_t)) {
+        publish_slot(new (slot) M(capture(std::forward<Args>(args))...));
+    } else {
+        std::ostringstream ss;
+        (ss << ... << capture(std::forward<Args>(args)));
+        publish_slot(new (slot) DeferredMessage<std::string>(ss.str()));
     }
 }
 
@@ -92,6 +170,28 @@ struct has_model_and_name<T, typename to_void<decltype(std::declval<T>().model()
 
 }  // namespace detail
 
+inline void set_level(level_t level) { detail::runtime_level.store(level, std::memory_order_relaxed); }
+
+inline bool enabled(level_t level) {
+    return level != level_t::NONE && level >= COMPILED_LEVEL && level >= detail::runtime_level.load(std::memory_order_relaxed);
+}
+
+// writes out all messages queued so far
+void flush();
+
+// writes immediately, regardless of compiled and runtime log level, for explicitly requested output such as the distribution
+// dumps of debug_purchasing_steps (messages queued before are written first)
+template<typename Arg, typename... Args>
+inline void print(Arg&& arg, Args&&... args) {
+    std::ostringstream ss;
+    if constexpr (std::is_pointer<Arg>::value && detail::has_model_and_name<typename std::remove_pointer<Arg>::type>::value) {
+        detail::to_stream(ss, timeinfo(*arg->model()), ", ", arg->name(), ": ", std::forward<Args>(args)...);
+    } else {
+        detail::to_stream(ss, std::forward<Arg>(arg), std::forward<Args>(args)...);
+    }
+    detail::write_immediately(ss.str());
+}
+
 template<typename Arg, typename... Args>
 inline acclimate::exception error(Arg&& arg, Args&&... args) {
     std::ostringstream ss;
@@ -105,32 +205,40 @@ inline acclimate::exception error(Arg&& arg, Args&&... args) {
 
 template<typename Arg, typename... Args>
 inline void warning(Arg&& arg, Args&&... args) {
-    if constexpr (options::DEBUGGING) {
-        if constexpr (std::is_pointer<Arg>::value && detail::has_model_and_name<typename std::remove_pointer<Arg>::type>::value) {
-            detail::output(timeinfo(*arg->model()), ", ", arg->name(), " Warning: ", std::forward<Args>(args)...);
-        } else {
-            detail::output("Warning: ", std::forward<Arg>(arg), std::forward<Args>(args)...);
+    if constexpr (level_t::WARNING >= COMPILED_LEVEL) {
+        if (enabled(level_t::WARNING)) {
+            if constexpr (std::is_pointer<Arg>::value && detail::has_model_and_name<typename std::remove_pointer<Arg>::type>::value) {
+                detail::output(timeinfo(*arg->model()), ", ", arg->name(), " Warning: ", std::forward<Args>(args)...);
+            } else {
+                detail::output("Warning: ", std::forward<Arg>(arg), std::forward<Args>(args)...);
+            }
         }
     }
 }
 
 template<typename Arg, typename... Args>
 inline void info(Arg&& arg, Args&&... args) {
-    if constexpr (options::DEBUGGING) {
-        if constexpr (std::is_pointer<Arg>::value && detail::has_model_and_name<typename std::remove_pointer<Arg>::type>::value) {
-            detail::output(timeinfo(*arg->model()), ", ", arg->name(), ": ", std::forward<Args>(args)...);
-        } else {
-            detail::output(std::forward<Arg>(arg), std::forward<Args>(args)...);
+    if constexpr (level_t::INFO >= COMPILED_LEVEL) {
+        if (enabled(level_t::INFO)) {
+            if constexpr (std::is_pointer<Arg>::value && detail::has_model_and_name<typename std::remove_pointer<Arg>::type>::value) {
+                detail::output(timeinfo(*arg->model()), ", ", arg->name(), ": ", std::forward<Args>(args)...);
+            } else {
+                detail::output(std::forward<Arg>(arg), std::forward<Args>(args)...);
+            }
         }
     }
 }
 
 template<typename Arg, typename... Args>
 inline void debug(Arg&& arg, Args&&... args) {
-    if constexpr (std::is_pointer<Arg>::value && detail::has_model_and_name<typename std::remove_pointer<Arg>::type>::value) {
-        detail::output(timeinfo(*arg->model()), ", ", arg->name(), ": ", std::forward<Args>(args)...);
-    } else {
-        detail::output(std::forward<Arg>(arg), std::forward<Args>(args)...);
+    if constexpr (level_t::VERBOSE >= COMPILED_LEVEL) {
+        if (enabled(level_t::VERBOSE)) {
+            if constexpr (std::is_pointer<Arg>::value && detail::has_model_and_name<typename std::remove_pointer<Arg>::type>::value) {
+                detail::output(timeinfo(*arg->model()), ", ", arg->name(), ": ", std::forward<Args>(args)...);
+            } else {
+                detail::output(std::forward<Arg>(arg), std::forward<Args>(args)...);
+            }
+        }
     }
 }
 
@@ -48,6 +48,7 @@ class BusinessConnection final {
     std::unique_ptr<TransportChainLink> first_transport_link;
 
   public:
+    const id_t id;  // named 'seller->buyer' after the agents at construction
     non_owning_ptr<PurchasingManager> buyer;
     non_owning_ptr<SalesManager> seller;
 
@@ -74,7 +75,7 @@ class BusinessConnection final {
     bool get_domestic() const;
 
     const Model* model() const;
-    std::string name() const;
+    const std::string& name() const { return id.name; }
 
     template<typename Observer, typename H>
     bool observe(Observer& o) const {
@@ -58,7 +58,7 @@ class CapacityManager final {
     void debug_print_inputs() const;
 
     const Model* model() const;
-    std::string name() const;
+    const std::string& name() const;
 };
 }  // namespace acclimate
 
@@ -21,11 +21,11 @@
 #ifndef ACCLIMATE_CONSUMER_H
 #define ACCLIMATE_CONSUMER_H
 
+#include <cstdint>
 #include <map>
 
 #include "Sector.h"
 #include "acclimate.h"
-#include "autodiff.h"
 #include "model/EconomicAgent.h"
 
 namespace acclimate {
@@ -56,12 +56,17 @@ class Consumer final : public EconomicAgent {
 
     // optimization parameters
     std::vector<double> optimizer_consumption;
+    std::uint64_t objective_evaluations = 0;  // of current optimization, for recording expensive problems
     // variables for (in)equality constraint, pre-allocated to increase efficiency
     FlowValue consumption_budget;
     FlowValue not_spent_budget;  // TODO: introduce real saving possibility, for now just trying to improve numerical stability
 
     // consumption limits considered in optimization
     std::vector<Price> consumption_prices;  // prices to be considered in optimization
+    std::vector<FloatType> consumption_costs;  // costs of one unit of baseline-relative consumption, pre-allocated for analytic optimization
+    // baseline consumption quantities and prices in the budget constraint, set for NLopt optimization
+    std::vector<FloatType> budget_baseline_quantities;
+    std::vector<FloatType> budget_prices;
     std::vector<Flow> previous_consumption;
 
     FloatType baseline_utility;  // baseline utility for scaling
@@ -69,13 +74,11 @@ class Consumer final : public EconomicAgent {
     // field to store utility
     FloatType utility;
     FloatType local_optimal_utility;
+    bool local_optimal_utility_requested = false;  // only calculated for non-utilitarian consumers if needed for output
 
-    // variables for utility function , pre-allocated to increase efficiency
-    autodiff::Value<FloatType> autodiff_consumption_utility = autodiff::Value<FloatType>(0, 0.0);
-    autodiff::Value<FloatType> autodiff_basket_consumption_utility = autodiff::Value<FloatType>(0, 0.0);
-    autodiff::Value<FloatType> autodiffutility = autodiff::Value<FloatType>(0, 0.0);
-
-    autodiff::Variable<FloatType> var_optimizer_consumption = autodiff::Variable<FloatType>(0, 0.0);
+    // variables for utility function, pre-allocated to increase efficiency
+    std::vector<FloatType> basket_sums;       // inner sums of baskets
+    std::vector<FloatType> basket_utilities;  // utilities of baskets
 
   public:
     using EconomicAgent::input_storages;
@@ -90,6 +93,7 @@ class Consumer final : public EconomicAgent {
 
     Consumer* as_consumer() override { return this; };
     const Consumer* as_consumer() const override { return this; };
+    void request_local_optimal_utility() { local_optimal_utility_requested = true; }
 
     FloatType inequality_constraint(const double* x, double* grad);
     FloatType equality_constraint(const double* x, double* grad);
@@ -120,11 +124,21 @@ class Consumer final : public EconomicAgent {
     void debug_print_details() const override;
     void debug_print_distribution();
 
-    autodiff::Value<FloatType> autodiff_nested_CES_utility_function(const autodiff::Variable<FloatType>& consumption);
+    FloatType nested_CES_utility_function(const double* baseline_relative_consumption, double* grad);
 
     // some helpers for local comparison of old consumer and utilitarian
     std::pair<std::vector<Flow>, FloatType> utilitarian_consumption_optimization();
+    bool analytic_consumption_optimization(const std::vector<FloatType>& lower_bounds, const std::vector<FloatType>& upper_bounds);
+    FloatType nlopt_consumption_optimization(const std::vector<FloatType>& scaled_starting_value,
+                                             const std::vector<FloatType>& lower_bounds,
+                                             const std::vector<FloatType>& upper_bounds);
     void consume_optimisation_result(std::vector<Flow> consumption);
+    void record_problem(const std::vector<FloatType>& lower_bounds,
+                        const std::vector<FloatType>& upper_bounds,
+                        const std::vector<FloatType>& xtol_abs,
+                        std::vector<double> start,
+                        FloatType optimized_value,
+                        FloatType seconds);
 
     // function for constrained optimization
     void consumption_optimize(optimization::Optimization& optimizer);
@@ -0,0 +1,126 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ACCLIMATE_CONSUMPTIONUTILITY_H
+#define ACCLIMATE_CONSUMPTIONUTILITY_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "acclimate.h"
+
+namespace acclimate::consumption {
+
+// utility maximization of a consumer as seen by the optimizer, evaluated by the consumer and, without the model, for recorded consumption problems;
+// x is the consumption of each good relative to its baseline
+
+/**
+ * nested CES utility U = (sum_b w_b C_b^r)^(1/r), C_b = beta_b (sum_i e_i (x_i a_i)^r_b)^(1/r_b), with gradient, which is accumulated backwards
+ * through the two nesting levels, so that each partial derivative only involves its own basket (no allocations, linear in number of goods)
+ * @param x consumption of each good relative to baseline
+ * @param grad gradient vector of size n (may be nullptr), goods in no basket get a zero derivative
+ * @param n number of goods
+ * @param basket_indices goods in each basket
+ * @param basket_sums pre-allocated inner sums S_b of baskets
+ * @param basket_utilities pre-allocated utilities C_b of baskets
+ * @return value of the utility function
+ */
+inline FloatType nested_CES_utility(const double* x,
+                                    double* grad,
+                                    std::size_t n,
+                                    const std::vector<std::vector<int>>& basket_indices,
+                                    const std::vector<FloatType>& share_factors,
+                                    const std::vector<FloatType>& exponent_share_factors,
+                                    const std::vector<FloatType>& intra_basket_substitution_exponent,
+                                    const std::vector<FloatType>& basket_share_factors,
+                                    const std::vector<FloatType>& exponent_basket_share_factors,
+                                    FloatType inter_basket_substitution_exponent,
+                                    std::vector<FloatType>& basket_sums,
+                                    std::vector<FloatType>& basket_utilities) {
+    // forward pass
+    FloatType consumption_utility = 0.0;
+    for (std::size_t basket = 0; basket < basket_indices.size(); ++basket) {
+        FloatType basket_consumption_utility = 0.0;
+        for (const auto index : basket_indices[basket]) {
+            basket_consumption_utility += std::pow(x[index] * share_factors[index], intra_basket_substitution_exponent[basket]) * exponent_share_factors[index];
+        }
+        basket_sums[basket] = basket_consumption_utility;
+        basket_consumption_utility = std::pow(basket_consumption_utility, 1 / intra_basket_substitution_exponent[basket]) * basket_share_factors[basket];
+        basket_utilities[basket] = basket_consumption_utility;
+        consumption_utility += std::pow(basket_consumption_utility, inter_basket_substitution_exponent) * exponent_basket_share_factors[basket];
+    }
+    const FloatType utility_value = std::pow(consumption_utility, 1 / inter_basket_substitution_exponent);
+
+    if (grad != nullptr) {
+        // backward pass: dU/dx_i = U^(1-r) w_b C_b^(r-1) beta_b S_b^(1/r_b-1) e_i a_i (x_i a_i)^(r_b-1)
+        std::fill_n(grad, n, 0.0);
+        const FloatType outer_derivative = std::pow(consumption_utility, 1 / inter_basket_substitution_exponent - 1);
+        for (std::size_t basket = 0; basket < basket_indices.size(); ++basket) {
+            const FloatType basket_derivative = outer_derivative * exponent_basket_share_factors[basket]
+                                                * std::pow(basket_utilities[basket], inter_basket_substitution_exponent - 1) * basket_share_factors[basket]
+                                                * std::pow(basket_sums[basket], 1 / intra_basket_substitution_exponent[basket] - 1);
+            for (const auto index : basket_indices[basket]) {
+                grad[index] = basket_derivative * exponent_share_factors[index] * share_factors[index]
+                              * std::pow(x[index] * share_factors[index], intra_basket_substitution_exponent[basket] - 1);
+            }
+        }
+    }
+    return utility_value;
+}
+
+/**
+ * budget constraint on expenditure relative to the budget; expenditure of a good is its quantity times its price if linear, and the legacy
+ * quantity times baseline-relative consumption times price otherwise (its gradient being this expenditure)
+ * @param x consumption of each good relative to baseline
+ * @param grad gradient vector of size n (may be nullptr)
+ * @param n number of goods
+ * @param baseline_quantities baseline consumption quantity of each good, by which x is scaled
+ * @param prices price of each good (as used in the budget, i.e. with elastic budget the elastic price)
+ * @param budget consumption budget
+ * @param budget_share available budget relative to the budget, i.e. (budget + not spent budget) / budget
+ * @param linear whether expenditure is linear in consumption
+ * @return value of the constraint, which is targeted to be <=0 (or =0 if used as equality constraint) by NLOpt optimizers
+ */
+inline FloatType budget_constraint(const double* x,
+                                   double* grad,
+                                   std::size_t n,
+                                   const std::vector<FloatType>& baseline_quantities,
+                                   const std::vector<FloatType>& prices,
+                                   FloatType budget,
+                                   FloatType budget_share,
+                                   bool linear) {
+    FloatType scaled_budget = budget_share;
+    for (std::size_t i = 0; i < n; ++i) {
+        const FloatType price = linear ? prices[i] : x[i] * prices[i];
+        const FloatType expenditure = x[i] * baseline_quantities[i] * price / budget;
+        scaled_budget -= expenditure;
+        if (grad != nullptr) {
+            grad[i] = linear ? baseline_quantities[i] * price / budget : expenditure;
+        }
+    }
+    return -scaled_budget;  // since inequality constraint checks for <=0, we need to switch the sign
+}
+
+}  // namespace acclimate::consumption
+
+#endif
@@ -0,0 +1,99 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ACCLIMATE_DEMANDBOOK_H
+#define ACCLIMATE_DEMANDBOOK_H
+
+#include <cstddef>
+#include <vector>
+
+#include "acclimate.h"
+
+namespace acclimate::sales {
+
+// non-zero demand requests of a firm's connections in the order they are served, i.e. by price with zero requests last; taken in one pass
+// after the connections have been sorted in the production step and used for both the actual and the expected supply distribution, as demand
+// requests only change in the purchase step
+class DemandBook {
+  private:
+    std::vector<Price> prices_;     // price of each demand request
+    std::vector<Flow> cumulative_;  // sum of the demand requests before each one, and of all as last entry
+
+  public:
+    // demand(*it) gives the demand request of a connection
+    template<typename Iterator, typename Func>
+    void assign(Iterator begin, Iterator end, const Func& demand) {
+        prices_.clear();
+        cumulative_.assign(1, Flow(0.0));
+        for (auto it = begin; it != end; ++it) {
+            const Demand& demand_request_D = demand(*it);
+            if (demand_request_D.get_quantity() <= 0.0) {
+                break;  // all further requests are zero
+            }
+            prices_.push_back(demand_request_D.get_price());
+            cumulative_.push_back(cumulative_.back() + demand_request_D);
+        }
+    }
+
+    std::size_t size() const { return prices_.size(); }
+    const Price& price(std::size_t k) const { return prices_[k]; }
+    const Flow& cumulative(std::size_t k) const { return cumulative_[k]; }  // k <= size()
+};
+
+struct Served {
+    std::size_t count;  // number of demand requests served completely, the next one is the connection not served completely
+    Flow production_X;  // rounded
+    bool all;           // whether all non-zero demand requests are served
+};
+
+/**
+ * serves demand requests in order until capacity or marginal production costs are exceeded
+ * @param minimal_extension_price unit production costs once production exceeds lambda * X_star
+ * @param marginal_costs marginal_costs(X, unit_production_costs_n_c) gives the marginal production costs, NaN if infinite
+ */
+template<typename MarginalCosts>
+inline Served serve(const DemandBook& book,
+                    const FlowQuantity& possible_production_quantity_X_hat,
+                    const FlowQuantity& forced_initial_production_quantity_lambda_X_star,
+                    const Price& minimal_production_price,
+                    const Price& minimal_extension_price,
+                    const MarginalCosts& marginal_costs) {
+    for (std::size_t k = 0; k < book.size(); ++k) {
+        const FlowQuantity production_quantity_X_served = round(book.cumulative(k + 1)).get_quantity();
+        // check that connection can be served under quantitative aspects
+        if (production_quantity_X_served > possible_production_quantity_X_hat) {
+            return {k, round(book.cumulative(k)), false};
+        }
+        // check that price of demand request is high enough
+        const Price maximal_marginal_production_costs = marginal_costs(
+            production_quantity_X_served,
+            book.cumulative(k).get_quantity() < forced_initial_production_quantity_lambda_X_star ? minimal_production_price : minimal_extension_price);
+        if (isnan(maximal_marginal_production_costs)  // infinite costs
+            || round(book.price(k)) < round(maximal_marginal_production_costs)) {
+            return {k, round(book.cumulative(k)), false};
+        }
+    }
+    return {book.size(), round(book.cumulative(book.size())), true};
+}
+
+}  // namespace acclimate::sales
+
+#endif
@@ -60,7 +60,7 @@ class EconomicAgent {
     const Parameters::AgentParameters& parameters() const { return parameters_; }
     Parameters::AgentParameters const& parameters_writable() const;
     const Forcing& forcing() const { return forcing_m; }
-    void set_forcing(const Forcing& forcing_p);
+    virtual void set_forcing(const Forcing& forcing_p);
     bool is_firm() const { return type == EconomicAgent::type_t::FIRM; }
     bool is_consumer() const { return type == EconomicAgent::type_t::CONSUMER; }
     virtual Firm* as_firm() { throw log::error(this, "Not a firm"); }
@@ -77,7 +77,7 @@ class EconomicAgent {
 
     Model* model();
     const Model* model() const;
-    std::string name() const { return id.name; }
+    const std::string& name() const { return id.name; }
 
     template<typename Observer, typename H>
     bool observe(Observer& o) const {
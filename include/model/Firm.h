@@ -22,6 +22,7 @@
 #define ACCLIMATE_FIRM_H
 
 #include <memory>
+#include <vector>
 
 #include "acclimate.h"
 #include "model/CapacityManager.h"
@@ -33,6 +34,7 @@ namespace acclimate {
 class BusinessConnection;
 class Region;
 class Sector;
+class Storage;
 
 class Firm final : public EconomicAgent {
   private:
@@ -41,6 +43,19 @@ class Firm final : public EconomicAgent {
     Flow initial_total_use_U_star_ = Flow(0.0);
     std::shared_ptr<BusinessConnection> self_supply_connection_;
 
+    // intermediates only depending on forcing and baseline, derived once at the beginning of the consumption and production step and read
+    // by it and the following steps (expectation, purchase); forcing only changes in the scenario step and baseline only during
+    // initialization, both of which invalidate them (invalid values are computed on the fly); kept on their own cache line as they are read
+    // by purchasers of this firm concurrently
+    struct alignas(64) {
+        bool valid = false;
+        FlowQuantity forced_initial_production_quantity_lambda_X_star = FlowQuantity(0.0);
+        FloatType forced_initial_production_quantity_lambda_X_star_float = 0.0;
+        FlowQuantity forced_maximal_production_quantity_lambda_beta_X_star = FlowQuantity(0.0);
+        Price initial_unit_variable_production_costs = Price(0.0);
+        std::vector<Ratio> technology_coefficients_a;  // by index of input storage
+    } step_intermediates_;
+
   public:
     non_owning_ptr<Sector> sector;
     const std::unique_ptr<CapacityManager> capacity_manager;
@@ -48,10 +63,12 @@ class Firm final : public EconomicAgent {
 
   private:
     void produce_X();
+    void update_step_intermediates();
 
   public:
     Firm(id_t id_p, Sector* sector_p, Region* region_p, const Ratio& possible_overcapacity_ratio_beta_p);
     void initialize() override;
+    void set_forcing(const Forcing& forcing_p) override;
     void iterate_consumption_and_production() override;
     void iterate_expectation() override;
     void iterate_purchase() override;
@@ -68,9 +85,17 @@ class Firm final : public EconomicAgent {
     const Flow& initial_production_X_star() const { return initial_production_X_star_; }
     Flow forced_initial_production_lambda_X_star() const { return round(initial_production_X_star_ * forcing_m); }
     Flow maximal_production_beta_X_star() const;
-    FlowQuantity forced_initial_production_quantity_lambda_X_star() const { return round(initial_production_X_star_.get_quantity() * forcing_m); }
-    FloatType forced_initial_production_quantity_lambda_X_star_float() const { return to_float(initial_production_X_star_.get_quantity() * forcing_m); }
+    FlowQuantity forced_initial_production_quantity_lambda_X_star() const {
+        return step_intermediates_.valid ? step_intermediates_.forced_initial_production_quantity_lambda_X_star
+                                         : round(initial_production_X_star_.get_quantity() * forcing_m);
+    }
+    FloatType forced_initial_production_quantity_lambda_X_star_float() const {
+        return step_intermediates_.valid ? step_intermediates_.forced_initial_production_quantity_lambda_X_star_float
+                                         : to_float(initial_production_X_star_.get_quantity() * forcing_m);
+    }
     FlowQuantity forced_maximal_production_quantity_lambda_beta_X_star() const;
+    Ratio technology_coefficient_a(const Storage* input_storage) const;
+    Price initial_unit_variable_production_costs() const;
     const Flow& initial_total_use_U_star() const { return initial_total_use_U_star_; }
 
     void debug_print_details() const override;
@@ -22,6 +22,8 @@
 #define ACCLIMATE_MODEL_H
 
 #include <cstddef>
+#include <iosfwd>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -35,6 +37,8 @@ namespace acclimate {
 class EconomicAgent;
 class GeoLocation;
 class PurchasingManager;
+class ConsumptionProblemRecord;
+class PurchasingProblemRecord;
 class Region;
 class Sector;
 
@@ -51,6 +55,7 @@ class Model final {
     std::vector<std::pair<PurchasingManager*, std::size_t>> parallelized_storages;
     std::vector<std::pair<EconomicAgent*, std::size_t>> parallelized_agents;
     non_owning_ptr<ModelRun> run_m;
+    std::unique_ptr<std::ofstream> purchasing_record_stream;
 
   public:
     owning_vector<Sector> sectors;
@@ -60,6 +65,7 @@ class Model final {
 
   private:
     explicit Model(ModelRun* run_p);
+    void iterate_purchase_batched();
 
   public:
     Model(const Model& other) = delete;
@@ -78,11 +84,19 @@ class Model final {
     unsigned char other_register() const { return 1 - current_register_m; }
     const Parameters::ModelParameters& parameters() const { return parameters_m; }
     Parameters::ModelParameters& parameters_writable();
+    bool parallelize_connections(std::size_t connection_count) const {
+        return parameters_m.nested_parallelization_threshold > 0 && connection_count >= parameters_m.nested_parallelization_threshold;
+    }
+    bool parallelize_objective(std::size_t connection_count) const {
+        return parameters_m.nested_objective_parallelization_threshold > 0 && connection_count >= parameters_m.nested_objective_parallelization_threshold;
+    }
     void start();
     void iterate_consumption_and_production();
     void iterate_expectation();
     void iterate_purchase();
     void iterate_investment();
+    void record_purchasing_problem(const PurchasingProblemRecord& record);
+    void record_consumption_problem(const ConsumptionProblemRecord& record);
 
     ModelRun* run() { return run_m; }
     const ModelRun* run() const { return run_m; }
@@ -0,0 +1,301 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ACCLIMATE_PURCHASINGCOSTS_H
+#define ACCLIMATE_PURCHASINGCOSTS_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "acclimate.h"
+
+namespace acclimate::purchasing {
+
+// what a purchaser knows about one of its suppliers when deciding on its demand request; taken from the business connection by the purchasing
+// manager and stored as is in recorded purchasing problems, so that the expected costs below can be evaluated without the model
+struct Supplier {
+    FloatType offer_price_n_bar = 0.0;
+    FloatType production_X = 0.0;
+    FloatType expected_production_X = 0.0;  // including minimum passage if used in expectation
+    FloatType possible_production_X_hat = 0.0;
+    FloatType unit_production_costs_n_c = 0.0;  // price of possible production
+    FloatType last_shipment_Z = 0.0;
+    FloatType forced_initial_production_lambda_X_star = 0.0;
+    FloatType estimated_price_increase_production_extension = 0.0;
+    FloatType initial_flow_Z_star = 0.0;
+    FloatType transport_penalty_target = 0.0;  // last demand request or baseline flow, depending on deviation_penalty
+};
+
+struct CostParameters {
+    bool quadratic_transport_penalty = false;
+    bool relative_transport_penalty = false;
+    bool maximal_decrease_reservation_price_limited_by_markup = false;
+    FloatType initial_markup = 0.0;
+    Price transport_penalty_large = Price(0.0);
+    Price transport_penalty_small = Price(0.0);
+};
+
+inline FloatType estimate_production_extension_penalty(const Supplier& s, FloatType production_quantity_X) {
+    assert(production_quantity_X >= 0.0);
+    if (production_quantity_X <= s.forced_initial_production_lambda_X_star) {  // not in production extension
+        return 0.0;
+    }
+    // in production extension
+    return std::max(0.0, s.estimated_price_increase_production_extension / (2 * s.forced_initial_production_lambda_X_star)
+                             * (production_quantity_X - s.forced_initial_production_lambda_X_star)
+                             * (production_quantity_X - s.forced_initial_production_lambda_X_star));
+}
+
+inline FloatType estimate_marginal_production_extension_penalty(const Supplier& s, FloatType production_quantity_X) {
+    assert(production_quantity_X >= 0.0);
+    if (production_quantity_X <= s.forced_initial_production_lambda_X_star) {  // not in production extension
+        return 0.0;
+    }
+    // in production extension
+    return s.estimated_price_increase_production_extension / s.forced_initial_production_lambda_X_star
+           * (production_quantity_X - s.forced_initial_production_lambda_X_star);
+}
+
+inline FloatType estimate_marginal_production_costs(const Supplier& s, FloatType production_quantity_X, FloatType unit_production_costs_n_c) {
+    assert(production_quantity_X >= 0.0);
+    assert(!std::isnan(unit_production_costs_n_c));
+    if (production_quantity_X <= s.forced_initial_production_lambda_X_star) {  // not in production extension
+        return unit_production_costs_n_c;
+    }
+    // in production extension
+    return unit_production_costs_n_c + estimate_marginal_production_extension_penalty(s, production_quantity_X);
+}
+
+inline FloatType expected_additional_production(const Supplier& s) {
+    const Ratio ratio_X_expected_to_X = (s.production_X > 0.0) ? s.expected_production_X / s.production_X : 0.0;
+    return ratio_X_expected_to_X * (s.production_X - s.last_shipment_Z);
+}
+
+// reservation price n_r(D_r), the expected average price cropped from below by marginal production costs
+struct ReservationPriceRegime {
+    FloatType D_r_min;
+    FloatType n_bar_min;
+    FloatType n_co;
+};
+
+inline FloatType calc_n_co(FloatType n_bar_min, FloatType D_r_min, const Supplier& s, const CostParameters& p) {
+    const auto n_co = estimate_marginal_production_costs(s, s.production_X, s.unit_production_costs_n_c);
+    if (p.maximal_decrease_reservation_price_limited_by_markup) {
+        const auto n_crit = n_bar_min - p.initial_markup * D_r_min;
+        return std::max(n_co, n_crit);
+    }
+    return n_co;
+}
+
+inline ReservationPriceRegime reservation_price_regime(const Supplier& s, const CostParameters& p) {
+    const auto X_expected = s.expected_production_X;
+    const auto additional_X_expected = expected_additional_production(s);
+    // note: D_r_min is the demand request for X_new = lambda * X_star
+    const auto D_r_min = std::max(0.0, s.forced_initial_production_lambda_X_star - additional_X_expected);
+    assert(D_r_min >= 0.0);
+    const auto X_new_min = D_r_min + additional_X_expected;
+    assert(X_new_min > 0.0);
+    const auto npe_at_X_expected = (X_expected > 0.0) ? estimate_production_extension_penalty(s, X_expected) / X_expected : 0.0;
+    const auto npe_at_X_new_min = (X_new_min > 0.0) ? estimate_production_extension_penalty(s, X_new_min) / X_new_min : 0.0;
+    const auto n_bar_min = s.offer_price_n_bar - npe_at_X_expected + npe_at_X_new_min;
+    return {D_r_min, n_bar_min, calc_n_co(n_bar_min, D_r_min, s, p)};
+}
+
+// offer price without the production extension penalty at the expected production, the part of the expected average price not depending on D_r
+inline FloatType offer_price_without_expected_penalty(const Supplier& s) {
+    const auto X_expected = s.expected_production_X;
+    return s.offer_price_n_bar - ((X_expected > 0.0) ? estimate_production_extension_penalty(s, X_expected) / X_expected : 0.0);
+}
+
+// supplier together with the terms of its reservation price that do not depend on the demand request; the functions below evaluate these terms
+// once per problem for a PreparedSupplier (as used by the optimizers) instead of once per call, with identical results
+struct PreparedSupplier : Supplier {
+    FloatType additional_X_expected = 0.0;
+    FloatType offer_price_without_expected_penalty = 0.0;
+    ReservationPriceRegime regime = {0.0, 0.0, 0.0};
+
+    PreparedSupplier() = default;
+    PreparedSupplier(const Supplier& s, const CostParameters& p)
+        : Supplier(s),
+          additional_X_expected(expected_additional_production(s)),
+          offer_price_without_expected_penalty(purchasing::offer_price_without_expected_penalty(s)),
+          regime(reservation_price_regime(s, p)) {}
+};
+
+inline FloatType additional_production(const Supplier& s) { return expected_additional_production(s); }
+inline FloatType additional_production(const PreparedSupplier& s) { return s.additional_X_expected; }
+inline FloatType price_without_expected_penalty(const Supplier& s) { return offer_price_without_expected_penalty(s); }
+inline FloatType price_without_expected_penalty(const PreparedSupplier& s) { return s.offer_price_without_expected_penalty; }
+inline ReservationPriceRegime regime(const Supplier& s, const CostParameters& p) { return reservation_price_regime(s, p); }
+inline const ReservationPriceRegime& regime(const PreparedSupplier& s, const CostParameters& /* p */) { return s.regime; }
+
+template<class S>
+FloatType expected_new_production(FloatType D_r, const S& s) {
+    auto X_new = D_r + additional_production(s);
+    assert(round(FlowQuantity(X_new)) <= FlowQuantity(s.possible_production_X_hat));
+    if (X_new > s.possible_production_X_hat) {
+        if constexpr (options::OPTIMIZATION_WARNINGS) {
+            log::warning("X_new > X_hat: X_new = ", FlowQuantity(X_new), " X_hat = ", FlowQuantity(s.possible_production_X_hat));
+        }
+        X_new = s.possible_production_X_hat;
+    }
+    return X_new;
+}
+
+template<class S>
+FloatType expected_average_price_E_n_r(FloatType D_r, const S& s) {
+    const auto X_new = expected_new_production(D_r, s);
+    // offer price corrected by the production extension penalties at expected (if any) and new production
+    auto new_price_demand_request = price_without_expected_penalty(s);
+    if (X_new > 0.0) {
+        new_price_demand_request += estimate_production_extension_penalty(s, X_new) / X_new;
+    }
+    assert(!std::isnan(new_price_demand_request));
+    assert(new_price_demand_request > 0.0);
+    return new_price_demand_request;
+}
+
+template<class S>
+FloatType grad_expected_average_price_E_n_r(FloatType D_r, const S& s) {
+    const auto X_new = expected_new_production(D_r, s);
+    if (X_new <= 0.0) {
+        return 0.0;
+    }
+    // regular case
+    return estimate_marginal_production_extension_penalty(s, X_new) / X_new - estimate_production_extension_penalty(s, X_new) / X_new / X_new;
+}
+
+template<class S>
+FloatType n_r(FloatType D_r, const S& s, const CostParameters& p) {
+    assert(D_r >= 0.0);
+    const auto E_n_r = expected_average_price_E_n_r(D_r, s);
+    const auto& r = regime(s, p);
+    if (r.n_co <= r.n_bar_min) {  // in linear regime of E_n(D) curve
+        if (D_r < r.D_r_min) {    // note: D_r_min == 0 cannot occur
+            assert(r.D_r_min > 0.0);
+            return r.n_co + (r.n_bar_min - r.n_co) / r.D_r_min * D_r;
+        }
+        // in production extension of E_n(D) curve
+        return E_n_r;
+    }
+    // E_n(D) curved cropped from below with n_co
+    if (E_n_r <= r.n_co) {
+        return r.n_co;
+    }
+    return E_n_r;
+}
+
+template<class S>
+FloatType grad_n_r(FloatType D_r, const S& s, const CostParameters& p) {
+    const auto grad_E_n_r = grad_expected_average_price_E_n_r(D_r, s);
+    const auto E_n_r = expected_average_price_E_n_r(D_r, s);
+    const auto& r = regime(s, p);
+    if (r.n_co <= r.n_bar_min) {  // in linear regime of E_n(D) curve
+        if (D_r < r.D_r_min && r.D_r_min > 0.0) {
+            return (r.n_bar_min - r.n_co) / r.D_r_min;
+        }
+        // in production extension of E_n(D) curve
+        return grad_E_n_r;
+    }
+    // E_n(D) curved cropped from below with n_co
+    if (E_n_r <= r.n_co) {
+        return 0.0;
+    }
+    return grad_E_n_r;
+}
+
+inline FloatType partial_D_r_transport_penalty(FloatType D_r, const Supplier& s, const CostParameters& p) {
+    const auto target = s.transport_penalty_target;
+    if (p.quadratic_transport_penalty) {
+        FloatType marg_penalty = 0.0;
+        if (D_r < target) {
+            marg_penalty = -p.initial_markup;
+        } else if (D_r > target) {
+            marg_penalty = p.initial_markup;
+        } else {
+            marg_penalty = 0.0;
+        }
+        if (p.relative_transport_penalty) {
+            if (target > FlowQuantity::precision) {
+                return (D_r - target) * to_float(p.transport_penalty_large) / (target * target) + marg_penalty;
+            }
+            return D_r * to_float(p.transport_penalty_large) + marg_penalty;
+        }
+        return (D_r - target) * to_float(p.transport_penalty_large) + marg_penalty;
+    }
+    if (p.relative_transport_penalty) {
+        if (D_r < target) {
+            return -to_float(p.transport_penalty_small) / target;
+        }
+        if (D_r > target) {
+            return to_float(p.transport_penalty_large) / target;
+        }
+        return (to_float(p.transport_penalty_large) - to_float(p.transport_penalty_small)) / 2 / target;
+    }
+    if (D_r < target) {
+        return -to_float(p.transport_penalty_small);
+    }
+    if (D_r > target) {
+        return to_float(p.transport_penalty_large);
+    }
+    return (to_float(p.transport_penalty_large) - to_float(p.transport_penalty_small)) / 2;
+}
+
+inline FloatType transport_penalty(FloatType D_r, const Supplier& s, const CostParameters& p) {
+    const auto target = s.transport_penalty_target;
+    if (p.quadratic_transport_penalty) {
+        FloatType marg_penalty = 0.0;
+        if (D_r < target) {
+            marg_penalty = -p.initial_markup;
+        } else if (D_r > target) {
+            marg_penalty = p.initial_markup;
+        } else {
+            marg_penalty = 0.0;
+        }
+        if (p.relative_transport_penalty) {
+            if (target > FlowQuantity::precision) {
+                return (D_r - target) * ((D_r - target) * to_float(p.transport_penalty_large) / (target * target) / 2 + marg_penalty);
+            }
+            return D_r * D_r * to_float(p.transport_penalty_large / 2 + Price(marg_penalty));
+        }
+        return (D_r - target) * ((D_r - target) * to_float(p.transport_penalty_large) / 2 + marg_penalty);
+    }
+    if (p.relative_transport_penalty) {
+        return partial_D_r_transport_penalty(D_r, s, p) * (D_r - target) / target;
+    }
+    return partial_D_r_transport_penalty(D_r, s, p) * (D_r - target);
+}
+
+// expected costs n_r(D_r) * D_r + transport penalty and their derivative with respect to D_r
+template<class S>
+FloatType costs(FloatType D_r, const S& s, const CostParameters& p) {
+    return n_r(D_r, s, p) * D_r + transport_penalty(D_r, s, p);
+}
+
+template<class S>
+FloatType marginal_costs_m_r(FloatType D_r, const S& s, const CostParameters& p) {
+    return grad_n_r(D_r, s, p) * D_r + n_r(D_r, s, p) + partial_D_r_transport_penalty(D_r, s, p);
+}
+
+}  // namespace acclimate::purchasing
+
+#endif
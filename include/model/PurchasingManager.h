@@ -23,9 +23,11 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "acclimate.h"
+#include "model/PurchasingCosts.h"
 
 namespace acclimate {
 
@@ -48,18 +50,65 @@ class PurchasingManager final {
     FlowQuantity desired_purchase_ = FlowQuantity(0.0);
     FlowValue expected_costs_ = FlowValue(0.0);
     FlowValue total_transport_penalty_ = FlowValue(0.0);
+    FlowValue pruning_error_ = FlowValue(0.0);  // first-order estimate of costs missed by not optimizing pruned suppliers
     std::vector<BusinessConnection*> purchasing_connections;
+    // snapshot of the suppliers in purchasing_connections, taken once per problem in prepare_purchase together with their terms not depending on
+    // the demand request; optimizer, distribution and recorder all evaluate this same snapshot
+    std::vector<purchasing::PreparedSupplier> suppliers;
     std::vector<FloatType> demand_requests_D;  // demand requests considered in optimization
     std::vector<double> upper_bounds;
     std::vector<double> lower_bounds;
     std::vector<double> xtol_abs;
     std::vector<double> pre_xtol_abs;
+    // scratch for very large supplier sets, whose connections are handled in parallel and then combined in fixed order
+    bool parallel_connections = false;
+    bool parallel_objective = false;
+    std::vector<FloatType> connection_upper_limits;  // per business connection, negative if not considered in optimization
+    std::vector<FloatType> connection_initial_values;
+    std::vector<purchasing::PreparedSupplier> connection_suppliers;  // per business connection, only valid if considered in optimization
+    mutable std::vector<FloatType> connection_costs;  // per purchasing connection
+    std::vector<FloatType> connection_transport_penalties;  // per purchasing connection
+    mutable std::uint64_t objective_evaluations = 0;  // of current optimization, for recording expensive problems
+    std::vector<std::pair<std::size_t, FloatType>> pruned_connections;  // index in business_connections and fixed demand request
+
+    // last purchasing problem solved by the optimizer (approximated ones are not kept), reused when inputs are effectively unchanged or used as
+    // starting point otherwise
+    struct {
+        std::vector<const BusinessConnection*> connections;
+        std::vector<FloatType> fingerprint;
+        std::vector<double> solution;  // scaled demand requests
+        FloatType optimized_value = 0.0;
+    } memo;
+    std::vector<FloatType> fingerprint;
+    enum class solution_t { SOLVED, WARM_STARTED, REUSED, APPROXIMATED };
+    solution_t last_solution_ = solution_t::SOLVED;
+    bool approximation_rejected_ = false;  // first-order update was tried but failed the optimality check
+    FloatType kkt_residual_ = 0.0;         // relative residual of optimality conditions of last first-order update
+    FloatType batched_deviation_ = 0.0;    // relative excess costs of batched over NLopt solution if cross-checked, NaN otherwise
+
+    // parameters only changing with the baseline, gathered once from storage, sector and model so that optimizer evaluations read them from a
+    // single cache line instead of following pointers; there is no investment yet, so only baseline changes during initialization invalidate them
+    // (firms keep their forcing-dependent values in Firm::step_intermediates_; storages read theirs only a few times per timestep and consumers
+    // keep their utility parameters as members already, so neither has such a block)
+    struct alignas(64) : purchasing::CostParameters {
+        bool valid = false;
+        bool deviation_penalty = false;
+        FloatType initial_used_flow_U_star = 0.0;  // scaling of objective and use
+    } invariant_parameters;
 
   public:
     non_owning_ptr<Storage> storage;
     std::vector<std::shared_ptr<BusinessConnection>> business_connections;
 
   private:
+    void update_invariant_parameters();
+    void calc_fingerprint();
+    bool memo_applicable() const;
+    bool approximate_purchase();
+    void optimize_purchase();
+    void solve_purchase(std::vector<double>* local_start);
+    void memorize_solution();
+    void record_problem(std::vector<double> start, FloatType seconds, bool batched = false);
     FloatType run_optimizer(optimization::Optimization& opt);
     void optimization_exception_handling(bool res, optimization::Optimization& opt);
     FloatType equality_constraint(const double* x, double* grad) const;
@@ -73,19 +122,13 @@ class PurchasingManager final {
     FloatType scaled_use(FloatType use) const;
     FloatType unscaled_use(FloatType x) const;
     FloatType partial_use_scaled_use() const;
-    FloatType n_r(FloatType D_r, const BusinessConnection* business_connection) const;
-    FloatType estimate_production_extension_penalty(const BusinessConnection* bc, FloatType production_quantity_X) const;
-    FloatType estimate_marginal_production_costs(const BusinessConnection* bc, FloatType production_quantity_X, FloatType unit_production_costs_n_c) const;
-    FloatType estimate_marginal_production_extension_penalty(const BusinessConnection* bc, FloatType production_quantity_X) const;
-    FloatType expected_average_price_E_n_r(FloatType D_r, const BusinessConnection* business_connection) const;
-    FloatType transport_penalty(FloatType D_r, const BusinessConnection* business_connection) const;
-    FloatType calc_n_co(FloatType n_bar_min, FloatType D_r_min, const BusinessConnection* business_connection) const;
-    FloatType grad_n_r(FloatType D_r, const BusinessConnection* business_connection) const;
-    FloatType grad_expected_average_price_E_n_r(FloatType D_r, const BusinessConnection* business_connection) const;
-    FloatType partial_D_r_transport_penalty(FloatType D_r, const BusinessConnection* business_connection) const;
+    purchasing::Supplier supplier(const BusinessConnection* bc) const;
+    FloatType n_r(FloatType D_r, const purchasing::PreparedSupplier& s) const;
+    FloatType transport_penalty(FloatType D_r, const purchasing::PreparedSupplier& s) const;
+    FloatType grad_n_r(FloatType D_r, const purchasing::PreparedSupplier& s) const;
+    FloatType partial_D_r_transport_penalty(FloatType D_r, const purchasing::PreparedSupplier& s) const;
+    FloatType marginal_costs_m_r(FloatType D_r, const purchasing::PreparedSupplier& s) const;
     static FlowQuantity calc_analytical_approximation_X_max(const BusinessConnection* bc);
-    static FloatType expected_production(const BusinessConnection* business_connection);
-    static FloatType expected_additional_production(const BusinessConnection* business_connection);
 
     void debug_print_distribution(const std::vector<double>& demand_requests_D) const;
 
@@ -103,9 +146,23 @@ class PurchasingManager final {
     const Demand& purchase() const;
     const FlowValue& expected_costs(const EconomicAgent* caller = nullptr) const;
     const FlowValue& total_transport_penalty() const;
+    std::size_t pruned_connections_count() const;
+    const FlowValue& pruning_error() const;
+    std::size_t reused_solution() const;
+    std::size_t warm_started_solution() const;
+    std::size_t approximated_solution() const;
+    std::size_t rejected_approximation() const;
+    FloatType kkt_residual() const;
+    FloatType batched_deviation() const;
     Flow get_disequilibrium() const;
     FloatType get_stddeviation() const;
     void iterate_purchase();
+    // phases of iterate_purchase, for the model to solve problems of several purchasing managers together
+    enum class purchase_phase_t { DONE, OPTIMIZE, DISTRIBUTE };
+    purchase_phase_t prepare_purchase();
+    std::size_t optimization_dimension() const { return purchasing_connections.size(); }
+    static void optimize_purchase_batch(const std::vector<PurchasingManager*>& batch);
+    void distribute_purchase();
     void add_initial_demand_D_star(const Demand& demand_D_p);
     void subtract_initial_demand_D_star(const Demand& demand_D_p);
 
@@ -113,9 +170,10 @@ class PurchasingManager final {
 
     const Model* model() const;
     Model* model();
-    std::string name() const;
+    const std::string& name() const;
 
     int optimization_restart_count;  // TODO: remove after debug
+    bool debug_distribution = false;  // print distribution before each optimization, resolved from debug_purchasing_steps at initialization
 };
 }  // namespace acclimate
 
@@ -0,0 +1,133 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ACCLIMATE_PURCHASINGPROBLEMRECORD_H
+#define ACCLIMATE_PURCHASINGPROBLEMRECORD_H
+
+#include <array>
+#include <cstdint>
+#include <iosfwd>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "acclimate.h"
+#include "model/PurchasingCosts.h"
+
+namespace acclimate {
+
+// Optimization problems with all inputs needed to solve them again without the model, as written by purchasing managers and consumers to the
+// file given by purchasing_record_file:
+//   MAGIC | (kind | record)*
+// with kind being a ProblemKind byte and each purchasing record being
+//   name | timestep | algorithm | maxeval | deterministic | global | batched | desired purchase | U_star | cost parameters | evaluations | seconds | optimized value | dimension n |
+//   Supplier[n] | lower bounds[n] | upper bounds[n] | xtol[n] | start[n] | solution[n]
+// and each consumption record being
+//   name | timestep | algorithm | maxeval | deterministic | inequality constrained | linear budget constraint | global | budget | budget share |
+//   inter basket exponent | evaluations | seconds | optimized value | number of baskets m | intra basket exponent[m] | basket share factor[m] |
+//   exponent basket share factor[m] | dimension n | basket[n] | share factor[n] | exponent share factor[n] | baseline quantity[n] | price[n] |
+//   lower bounds[n] | upper bounds[n] | xtol[n] | start[n] | solution[n]
+// Strings are written as their length followed by their characters, bounds, tolerances and points are scaled by the baseline flows as seen by the
+// optimizer. Host byte order.
+enum class ProblemKind : std::uint8_t { PURCHASING = 0, CONSUMPTION = 1 };
+
+class PurchasingProblemRecord {
+  public:
+    static constexpr std::array<char, 8> MAGIC = {'A', 'C', 'C', 'P', 'R', 'B', '0', '4'};
+    // limits checked before allocating when reading, so that corrupt files are reported instead of exhausting memory
+    static constexpr std::uint64_t MAX_NAME_LENGTH = 1 << 12;
+    static constexpr std::uint64_t MAX_DIMENSION = 1 << 24;
+
+    std::string name;
+    TimeStep timestep = 0;
+    int algorithm = 0;  // local algorithm
+    int maxeval = 0;    // evaluation budget if deterministic
+    bool deterministic = false;  // whether maxeval was used as staged evaluation budget (see Optimization::evaluation_budget)
+    bool global = false;         // whether the model run used global optimization before the local one, start is then the start of the local one
+    bool batched = false;        // whether the model run solved the problem with batched purchasing instead of the local algorithm
+    FloatType desired_purchase = 0.0;
+    FloatType initial_used_flow_U_star = 0.0;  // scaling of objective and use
+    purchasing::CostParameters parameters;
+    // outcome in the model run
+    std::uint64_t evaluations = 0;
+    FloatType seconds = 0.0;
+    FloatType optimized_value = 0.0;
+    std::vector<purchasing::Supplier> suppliers;
+    std::vector<double> lower_bounds;
+    std::vector<double> upper_bounds;
+    std::vector<double> xtol_abs;
+    std::vector<double> start;
+    std::vector<double> solution;
+
+    static void write_header(std::ostream& out);
+    static bool read_header(std::istream& in);
+    static bool read_kind(std::istream& in, ProblemKind& kind);  // returns false at end of file
+    void write(std::ostream& out) const;
+    void read(std::istream& in);  // reads the record following its kind
+};
+
+// utility maximization of a consumer as seen by the optimizer, i.e. nested CES utility of baseline-relative consumption x under the budget constraint
+//   sum_i x_i baseline_quantity_i price_i / budget <= budget share  (or == if not inequality constrained)
+// with price_i multiplied by x_i in the legacy quadratic constraint, i.e. if not linear_budget_constraint
+class ConsumptionProblemRecord {
+  public:
+    static constexpr std::uint32_t NO_BASKET = std::numeric_limits<std::uint32_t>::max();  // basket of goods in no basket
+
+    std::string name;
+    TimeStep timestep = 0;
+    int algorithm = 0;  // local algorithm, the global/lagrangian stage is not replayed
+    int maxeval = 0;  // evaluation budget if deterministic
+    bool deterministic = false;  // whether maxeval was used as staged evaluation budget (see Optimization::evaluation_budget)
+    bool inequality_constrained = true;
+    bool linear_budget_constraint = false;  // see Parameters::ModelParameters::linear_budget_constraint
+    bool global = false;                    // whether the model run used global utility optimization before the local one
+    FloatType budget = 1.0;
+    FloatType budget_share = 1.0;  // (budget + not spent budget) / budget
+    FloatType inter_basket_substitution_exponent = 0.0;
+    // outcome in the model run
+    std::uint64_t evaluations = 0;
+    FloatType seconds = 0.0;
+    FloatType optimized_value = 0.0;
+    // per basket
+    std::vector<FloatType> intra_basket_substitution_exponent;
+    std::vector<FloatType> basket_share_factors;
+    std::vector<FloatType> exponent_basket_share_factors;
+    // per good
+    std::vector<std::uint32_t> baskets;  // basket of each good or NO_BASKET
+    std::vector<FloatType> share_factors;
+    std::vector<FloatType> exponent_share_factors;
+    std::vector<FloatType> baseline_quantities;  // by which consumption is scaled
+    std::vector<FloatType> prices;               // as used in the budget constraint
+    std::vector<double> lower_bounds;
+    std::vector<double> upper_bounds;
+    std::vector<double> xtol_abs;
+    std::vector<double> start;
+    std::vector<double> solution;
+
+    void write(std::ostream& out) const;
+    void read(std::istream& in);  // reads the record following its kind
+};
+
+void replay_optimization_problems(const std::string& filename, const std::vector<std::string>& algorithms);
+
+}  // namespace acclimate
+
+#endif
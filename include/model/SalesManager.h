@@ -27,6 +27,7 @@
 #include <vector>
 
 #include "acclimate.h"
+#include "model/DemandBook.h"
 #include "openmp.h"
 
 namespace acclimate {
@@ -58,12 +59,16 @@ class SalesManager final {
         Price price_cheapest_buyer_accepted_in_optimization = Price(0.0);  // Price of cheapest connection that has been considered in the profit optimization
         Flow flow_not_served_completely = Flow(0.0);
     } supply_distribution_scenario;  // to distribute production among demand requests
+    sales::DemandBook demand_book;    // of current timestep
 
   public:
     non_owning_ptr<Firm> firm;
     std::vector<std::shared_ptr<BusinessConnection>> business_connections;
 
   private:
+    std::tuple<Flow, bool> serve_demand_requests(const Flow& possible_production_X_hat_p,
+                                                 const Price& minimal_production_price,
+                                                 const Price& minimal_extension_price);
     std::tuple<Flow, Price> calc_supply_distribution_scenario(const Flow& possible_production_X_hat_p);
     std::tuple<Flow, Price> calc_expected_supply_distribution_scenario(const Flow& possible_production_X_hat_p);
     FlowValue calc_total_production_costs(const Flow& production_X, const Price& unit_production_costs_n_c) const;
@@ -75,12 +80,13 @@ class SalesManager final {
                                                          const Price& unit_production_costs_n_c,
                                                          const Price& n_min_p) const;
     Price goal_fkt_marginal_costs_minus_price(const FlowQuantity& production_quantity_X_p, const Price& unit_production_costs_n_c, const Price& price) const;
-    Flow search_root_bisec_expectation(const FlowQuantity& left,
-                                       const FlowQuantity& right,
-                                       const FlowQuantity& production_quantity_X_p,
-                                       const Price& unit_production_costs_n_c,
-                                       const Price& n_min_p,
-                                       const Price& precision_p) const;
+    FloatType goal_fkt_marginal_costs_minus_marginal_revenue_derivative(const FlowQuantity& production_quantity_X_p, const Price& n_min_p) const;
+    Flow search_root_expectation(const FlowQuantity& left,
+                                 const FlowQuantity& right,
+                                 const FlowQuantity& production_quantity_X_p,
+                                 const Price& unit_production_costs_n_c,
+                                 const Price& n_min_p,
+                                 const Price& precision_p) const;
     void print_parameters() const;
     void print_connections(std::vector<std::shared_ptr<BusinessConnection>>::const_iterator begin_equally_distributed,
                            std::vector<std::shared_ptr<BusinessConnection>>::const_iterator end_equally_distributed) const;
@@ -113,7 +119,7 @@ class SalesManager final {
 
     Model* model();
     const Model* model() const;
-    std::string name() const;
+    const std::string& name() const;
 };
 }  // namespace acclimate
 
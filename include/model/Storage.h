@@ -134,6 +134,38 @@ class Storage final {
                         [this]() {  //
                             return purchasing_manager->storage_demand();
                         })
+               && o.set(H::hash("pruned_connections"),
+                        [this]() {  //
+                            return purchasing_manager->pruned_connections_count();
+                        })
+               && o.set(H::hash("pruning_error"),
+                        [this]() {  //
+                            return purchasing_manager->pruning_error();
+                        })
+               && o.set(H::hash("reused_solution"),
+                        [this]() {  //
+                            return purchasing_manager->reused_solution();
+                        })
+               && o.set(H::hash("warm_started_solution"),
+                        [this]() {  //
+                            return purchasing_manager->warm_started_solution();
+                        })
+               && o.set(H::hash("approximated_solution"),
+                        [this]() {  //
+                            return purchasing_manager->approximated_solution();
+                        })
+               && o.set(H::hash("rejected_approximation"),
+                        [this]() {  //
+                            return purchasing_manager->rejected_approximation();
+                        })
+               && o.set(H::hash("kkt_residual"),
+                        [this]() {  //
+                            return purchasing_manager->kkt_residual();
+                        })
+               && o.set(H::hash("batched_deviation"),
+                        [this]() {  //
+                            return purchasing_manager->batched_deviation();
+                        })
                && o.set(H::hash("total_transport_penalty"),
                         [this]() {  //
                             return purchasing_manager->total_transport_penalty();
@@ -0,0 +1,37 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ACCLIMATE_NETCDFLOCK_H
+#define ACCLIMATE_NETCDFLOCK_H
+
+#include <mutex>
+
+namespace acclimate {
+
+// netCDF-C is not thread-safe, so any netCDF access that might run concurrently to the forcing prefetch thread needs to hold this lock
+inline std::mutex& netcdf_lock() {
+    static std::mutex lock;
+    return lock;
+}
+
+}  // namespace acclimate
+
+#endif
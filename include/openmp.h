@@ -21,6 +21,9 @@
 #ifndef ACCLIMATE_OPENMP_H
 #define ACCLIMATE_OPENMP_H
 
+#include <atomic>
+#include <cstddef>
+
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -65,6 +68,55 @@ inline unsigned int get_thread_count() {
 #endif
 }
 
+inline unsigned int get_thread() {
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+// index of the calling thread that is unique across all threads of the process (omp_get_thread_num is only unique within a team), assigned on
+// first call and kept for the lifetime of the thread, so indices beyond get_thread_count() can occur if the runtime starts further threads
+inline unsigned int get_global_thread() {
+    static std::atomic<unsigned int> next_index{0};
+    thread_local const unsigned int index = next_index.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+// calls f(i) for begin <= i < end; if parallel, the range is split into tasks of the current team, so that threads which have run out of
+// work (e.g. waiting at the end of the enclosing loop over agents) take over parts of the connection loop of a hub agent
+template<typename Func>
+inline void for_each_index(std::size_t begin, std::size_t end, bool parallel, const Func& f) {
+    if (parallel) {
+#pragma omp taskloop default(shared)
+        for (std::size_t i = begin; i < end; ++i) {
+            f(i);
+        }
+    } else {
+        for (std::size_t i = begin; i < end; ++i) {
+            f(i);
+        }
+    }
+}
+
+// as for_each_index, returning the sum of f(i) (added up in arbitrary order if parallel, so only meant for integral counts)
+template<typename T, typename Func>
+inline T sum_over_indices(std::size_t begin, std::size_t end, bool parallel, const Func& f) {
+    T sum = 0;
+    if (parallel) {
+#pragma omp taskloop default(shared) reduction(+ : sum)
+        for (std::size_t i = begin; i < end; ++i) {
+            sum += f(i);
+        }
+    } else {
+        for (std::size_t i = begin; i < end; ++i) {
+            sum += f(i);
+        }
+    }
+    return sum;
+}
+
 }  // namespace acclimate::openmp
 
 #endif
@@ -21,7 +21,10 @@
 #ifndef OPTIMIZATION_H
 #define OPTIMIZATION_H
 
+#include <algorithm>
+#include <array>
 #include <stdexcept>
+#include <vector>
 
 #include "nlopt.h"  // IWYU pragma: export
 #include "types.h"
@@ -126,6 +129,11 @@ class Optimization {
     nlopt_result last_result = NLOPT_SUCCESS;
     double optimized_value_m;
     unsigned int dim_m;
+    std::vector<double> xtol_m;
+    int evaluation_budget_m = 0;
+    int evaluations_m = 0;  // objective evaluations since last reset, counted here as nlopt_get_numevals needs NLopt >= 2.7
+    void* objective_handler_m = nullptr;
+    double (*objective_m)(void* handler, const double* x, double* grad) = nullptr;
 
     void check(nlopt_result result) {
         if (result < NLOPT_SUCCESS && result != NLOPT_ROUNDOFF_LIMITED) {
@@ -136,15 +144,31 @@ class Optimization {
   public:
     Optimization(nlopt_algorithm algorithm, unsigned int dim_p) : opt(nlopt_create(algorithm, dim_p)), dim_m(dim_p) {}
     ~Optimization() { nlopt_destroy(opt); }
+    Optimization(const Optimization&) = delete;  // registered as data of the objective
+    Optimization& operator=(const Optimization&) = delete;
 
     // double& xtol(std::size_t i) { return opt->xtol_abs[i]; }
     // double& lower_bounds(std::size_t i) { return opt->lb[i]; }
     // double& upper_bounds(std::size_t i) { return opt->ub[i]; }
-    void xtol(const std::vector<double>& v) { check(nlopt_set_xtol_abs(opt, &v[0])); }
+    void xtol(const std::vector<double>& v) {
+        xtol_m = v;
+        check(nlopt_set_xtol_abs(opt, &v[0]));
+    }
     void lower_bounds(const std::vector<double>& v) { check(nlopt_set_lower_bounds(opt, &v[0])); }
     void upper_bounds(const std::vector<double>& v) { check(nlopt_set_upper_bounds(opt, &v[0])); }
     void maxeval(int v) { check(nlopt_set_maxeval(opt, v)); }
     void maxtime(double v) { check(nlopt_set_maxtime(opt, v)); }  // timeout given in sec
+    // deterministic alternative to maxeval and maxtime: optimize() then tightens the tolerance stage by stage, each stage starting from the last
+    // result, as long as the given number of evaluations lasts
+    void evaluation_budget(int v) {
+        evaluation_budget_m = v;
+        check(nlopt_set_maxtime(opt, 0));
+        check(nlopt_set_maxeval(opt, v));
+    }
+
+    // seeds the generator of stochastic algorithms; it is only thread-local if NLopt was built with THREADLOCAL support (the default where the
+    // compiler provides it), otherwise parallel stochastic optimizations share it and their results still depend on scheduling
+    static void seed(unsigned long s) { nlopt_srand(s); }
 
     void set_local_algorithm(nlopt_opt local_algorithm) { nlopt_set_local_optimizer(opt, local_algorithm); }
 
@@ -162,11 +186,35 @@ class Optimization {
     const char* last_result_description() const { return get_result_description(last_result, opt); }
 
     bool optimize(std::vector<double>& x) {  // returns true for "generic success" and false otherwise (for "real" errors, an exception is thrown)
+        if (evaluation_budget_m > 0 && !xtol_m.empty()) {
+            return optimize_within_budget(x);
+        }
         last_result = nlopt_optimize(opt, &x[0], &optimized_value_m);
         check(last_result);
         return last_result == NLOPT_SUCCESS;
     }
 
+    bool optimize_within_budget(std::vector<double>& x) {
+        constexpr std::array<double, 3> tolerance_factors = {100.0, 10.0, 1.0};
+        std::vector<double> stage_xtol(xtol_m.size());
+        int budget = evaluation_budget_m;
+        for (const auto factor : tolerance_factors) {
+            std::transform(std::begin(xtol_m), std::end(xtol_m), std::begin(stage_xtol), [factor](double v) { return v * factor; });
+            check(nlopt_set_xtol_abs(opt, &stage_xtol[0]));
+            check(nlopt_set_maxeval(opt, budget));
+            evaluations_m = 0;
+            last_result = nlopt_optimize(opt, &x[0], &optimized_value_m);
+            check(last_result);
+            budget -= evaluations_m;
+            if (budget <= 0) {
+                last_result = NLOPT_MAXEVAL_REACHED;
+                break;
+            }
+        }
+        check(nlopt_set_xtol_abs(opt, &xtol_m[0]));
+        return last_result == NLOPT_SUCCESS;
+    }
+
     template<class Handler>
     void add_equality_constraint(Handler* handler, double precision = 0) {
         check(nlopt_add_equality_constraint(
@@ -182,8 +230,16 @@ class Optimization {
 
     template<class Handler>
     void add_max_objective(Handler* handler) {
+        objective_handler_m = handler;
+        objective_m = [](void* data, const double* x, double* grad) { return static_cast<Handler*>(data)->max_objective(x, grad); };
         check(nlopt_set_max_objective(
-            opt, [](unsigned /* n */, const double* x, double* grad, void* data) { return static_cast<Handler*>(data)->max_objective(x, grad); }, handler));
+            opt,
+            [](unsigned /* n */, const double* x, double* grad, void* data) {
+                auto* self = static_cast<Optimization*>(data);
+                ++self->evaluations_m;
+                return self->objective_m(self->objective_handler_m, x, grad);
+            },
+            this));
     }
 
     nlopt_opt get_optimizer() { return opt; }
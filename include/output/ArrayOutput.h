@@ -23,6 +23,7 @@
 
 #include <array>
 #include <cstddef>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -46,19 +47,38 @@ class ArrayOutput : public Output {
   public:
     using output_float_t = double;
 
+    enum class reduction_t { SUM, MEAN, WEIGHTED_MEAN };  // how values of several agents are combined when aggregating into groups
+
     struct Variable {
         std::string name;
         hash_t name_hash;  // does not include _quantity/_value prefix
         std::vector<output_float_t> data;
+        reduction_t reduction;
+
+        Variable(std::string name_p, hash_t name_hash_p, reduction_t reduction_p)
+            : name(std::move(name_p)), name_hash(name_hash_p), reduction(reduction_p) {}
+    };
 
-        Variable(std::string name_p, hash_t name_hash_p) : name(std::move(name_p)), name_hash(name_hash_p) {}
+    struct AgentGroups {
+        std::vector<std::string> names;
+        std::vector<std::vector<std::size_t>> members;  // agent indices for each group
+        std::vector<long> group_of_agent;               // -1 if agent is not in any group
     };
 
+    enum class aggregation_t { LAST, MEAN, SUM, MIN, MAX };  // MIN and MAX skip NaN samples, MEAN and SUM propagate them
+    static constexpr std::array<const char*, 5> AGGREGATION_NAMES = {"last", "mean", "sum", "min", "max"};
+
     template<std::size_t dim>
     struct Observable {
         std::array<std::vector<unsigned long long>, dim> indices;
         std::array<std::size_t, dim> sizes;
         std::vector<Variable> variables;
+        TimeStep frequency = 1;  // number of timesteps aggregated into one output value
+        aggregation_t aggregation = aggregation_t::MEAN;
+        TimeStep samples = 0;  // number of timesteps aggregated so far in current period
+        std::unique_ptr<AgentGroups> groups;  // if set, agents are aggregated into these groups instead of being output individually
+
+        bool period_complete() const { return samples == frequency; }
     };
 
     struct Event {
@@ -69,6 +89,12 @@ class ArrayOutput : public Output {
         output_float_t value = 0;
     };
 
+  private:
+    struct alignas(64) ThreadEvents {  // aligned to avoid false sharing between threads
+        std::vector<Event> events;
+        std::vector<unsigned int> counts;  // [event type][sector] followed by [event type][region]
+    };
+
   protected:
     Observable<0> obs_model;
     Observable<1> obs_firms;
@@ -78,13 +104,32 @@ class ArrayOutput : public Output {
     Observable<1> obs_locations;
     Observable<2> obs_flows;
     Observable<2> obs_storages;
-    std::vector<Event> events;
+    std::vector<Event> events;                     // events of current timestep only if only_current_timestep
+    unsigned int dropped_events = 0;               // events of current timestep beyond max_events
+    std::vector<unsigned int> event_counts_sector;  // [event type][sector] for current timestep
+    std::vector<unsigned int> event_counts_region;  // [event type][region] for current timestep
     bool include_events;
+    bool event_counters;
     bool only_current_timestep;
-    openmp::Lock event_lock;
+    std::size_t max_events = 0;  // per timestep, 0 for unlimited
+    std::vector<ThreadEvents> thread_events;  // indexed by openmp::get_global_thread(), last one shared by all further threads
+    openmp::Lock shared_thread_events_lock;   // guards thread_events.back()
 
+    template<std::size_t dim>
+    void read_aggregation(const settings::SettingsNode& obs_node, Observable<dim>& obs);
     template<std::size_t dim>
     void resize_data(Observable<dim>& obs);
+    template<std::size_t dim>
+    std::size_t begin_period(Observable<dim>& obs);
+    std::unique_ptr<AgentGroups> read_agent_groups(const settings::SettingsNode& node, bool include_firms, bool include_consumers) const;
+    template<typename Agent>
+    void aggregate_agents(Observable<1>& obs, std::size_t offset);
+    void aggregate_flows(std::size_t offset);
+    template<typename Func>
+    void with_thread_events(const Func& f);
+    void add_event(const Event& ev);
+    void count_event(EventType type, const Sector* sector, const EconomicAgent* economic_agent);
+    void collect_events();
 
   public:
     ArrayOutput(Model* model_p, const settings::SettingsNode& settings, bool only_current_timestep_p);
@@ -46,34 +46,66 @@ class Model;
 
 class NetCDFOutput final : public ArrayOutput {
   private:
-    static constexpr auto compression_level = 7;
+    struct GroupSettings {
+        int compression_level = 7;  // 0 disables deflate
+        bool shuffle = false;
+        TimeStep slab_steps = 1;          // number of output periods staged in memory before being written as one slab
+        std::vector<std::size_t> chunks;  // empty -> library default chunking
+    };
+
+    template<std::size_t dim>
+    struct Group {
+        GroupSettings settings;
+        std::vector<netCDF::Variable> variables;
+        std::unique_ptr<netCDF::Variable> time_variable;   // only for groups with own output frequency
+        std::vector<std::vector<output_float_t>> staging;  // one buffer of settings.slab_steps periods per variable
+        TimeStep periods = 0;                              // number of output periods staged so far
+        TimeStep first_period = 0;
+        TimeStep staged_periods = 0;
+    };
+
+  private:
+    GroupSettings default_settings;
+    Time last_time = Time(0.0);
     TimeStep flush_freq = 1;
     unsigned int event_cnt = 0;
     std::string filename;
 
     std::unique_ptr<netCDF::File> file;
     std::unique_ptr<netCDF::Variable> var_events;
+    std::unique_ptr<netCDF::Variable> var_dropped_events;
+    std::unique_ptr<netCDF::Variable> var_event_counts_sector;
+    std::unique_ptr<netCDF::Variable> var_event_counts_region;
     std::unique_ptr<netCDF::Variable> var_time;
 
-    std::vector<netCDF::Variable> vars_model;
-    std::vector<netCDF::Variable> vars_firms;
-    std::vector<netCDF::Variable> vars_consumers;
-    std::vector<netCDF::Variable> vars_sectors;
-    std::vector<netCDF::Variable> vars_regions;
-    std::vector<netCDF::Variable> vars_locations;
-    std::vector<netCDF::Variable> vars_storages;
-    std::vector<netCDF::Variable> vars_flows;
+    Group<0> group_model;
+    Group<1> group_firms;
+    Group<1> group_consumers;
+    Group<1> group_sectors;
+    Group<1> group_regions;
+    Group<1> group_locations;
+    Group<2> group_storages;
+    Group<2> group_flows;
 
   private:
+    static void read_group_settings(const settings::SettingsNode& node, GroupSettings& group_settings);
+
     template<std::size_t dim>
-    void write_variables(const Observable<dim>& observable, std::vector<netCDF::Variable>& nc_variables);
+    void stage_variables(const Observable<dim>& observable, Group<dim>& group, bool end_of_run);
+
+    void stage_all_variables(bool end_of_run);
+
+    template<std::size_t dim>
+    void write_staged(const Observable<dim>& observable, Group<dim>& group);
+
+    void write_all_staged();
 
     template<std::size_t dim>
     void create_group(const char* name,
                       const std::array<netCDF::Dimension, dim + 1>& default_dims,
                       const std::array<const char*, dim>& index_names,
                       const Observable<dim>& observable,
-                      std::vector<netCDF::Variable>& nc_variables);
+                      Group<dim>& group);
 
   public:
     NetCDFOutput(Model* model_p, const settings::SettingsNode& settings);
@@ -35,6 +35,7 @@ struct Parameters {
         Price transport_penalty_large = Price(0.0);
         Price transport_penalty_small = Price(0.0);
         Ratio min_storage = Ratio(0.0);
+        Ratio purchasing_pruning_threshold = Ratio(0.0);  // relative weight below which suppliers are left out of purchasing optimization (0 for never)
         bool always_extend_expected_demand_curve;  // extend incoming demand in expectation step with certain elasticity
         bool cheapest_price_range_generic_size;
         bool cheapest_price_range_preserve_seller_price;
@@ -58,6 +59,9 @@ struct Parameters {
         unsigned int utility_optimization_timeout;  // timeout in sec
         unsigned int global_optimization_timeout;   // timeout in sec
 
+        bool deterministic_optimization;             // no timeouts and restarts, optimizations are limited by evaluation budget instead
+        int optimization_evaluations_per_dimension;  // evaluation budget per optimization variable in deterministic mode
+
         int optimization_precision_adjustment;                 // factor for precision of global algorithms
         int global_optimization_precision_adjustment;          // factor for precision of global algorithms
         int utility_optimization_precision_adjustment;         // factor for precision of utility algorithms
@@ -67,6 +71,14 @@ struct Parameters {
         bool global_purchasing_optimization;
 
         bool optimization_restart_baseline;
+        bool purchasing_memoization;                   // reuse or warm-start from previous purchasing solution
+        FloatType purchasing_memoization_tolerance;    // relative change of inputs up to which previous purchasing solution is reused
+        bool purchasing_approximation;                 // first-order update of previous purchasing solution, full optimization if not optimal enough
+        FloatType purchasing_approximation_tolerance;  // relative residual of optimality conditions up to which first-order update is accepted
+        // solve purchasing problems of the same size together by bisection on their shadow prices instead of per agent with optimization_algorithm;
+        // only for local optimization, problems not converging or failing the optimality check fall back to the per-agent optimization
+        bool batched_purchasing;
+        FloatType batched_purchasing_cross_check_tolerance;  // if > 0, also solve batched problems with NLopt and warn on larger relative cost deviation
         bool start_purchasing_at_baseline;
         bool purchasing_halfway_baseline;
 
@@ -78,6 +90,25 @@ struct Parameters {
 
         bool budget_inequality_constrained;
         bool elastic_budget;
+        // expenditure in the NLOPT budget constraint linear in consumption, as accounted for and as in the analytic method, instead of the legacy
+        // quadratic one; changes results of NLOPT (and CROSS_CHECK compares like with like only with it)
+        bool linear_budget_constraint;
+
+        enum class utility_optimization_method_t { ANALYTIC, NLOPT, CROSS_CHECK };
+        utility_optimization_method_t utility_optimization_method;
+        FloatType utility_cross_check_tolerance;  // relative deviation in utility reported when cross-checking analytic and NLopt solution
+
+        // number of connections from which an agent splits its connection loops into tasks for idle threads (0 for never); flows and demand
+        // requests then arrive at their receivers in varying order, so results can differ in the last digits between runs, as with the parallel
+        // loops over agents
+        unsigned int nested_parallelization_threshold;
+        // number of purchasing connections from which each objective evaluation is split into tasks (0 for never), needs to be large as every
+        // evaluation then waits for its tasks
+        unsigned int nested_objective_parallelization_threshold;
+
+        std::string purchasing_record_file;  // file to record purchasing and consumption problems to for replay (none if empty)
+        FloatType purchasing_record_time;    // optimization time in sec from which a purchasing or consumption problem is recorded (0 for never)
+        int purchasing_record_evaluations;   // number of objective evaluations from which such a problem is recorded (0 for never)
 
         std::vector<std::string>
             debug_purchasing_steps;  // give purchasing steps where details should be printed to output, e.g. "WHOT->third_income_quintile:BFA"
@@ -46,13 +46,13 @@ class EventSeriesScenario : public ExternalScenario {
       private:
         std::vector<EconomicAgent*> agents;  // TODO remove
         std::vector<GeoLocation*> locations;
-        std::vector<Forcing> forcings;
+        std::vector<Forcing> forcings;  // defaults for entries not covered by the file
         std::size_t regions_count;
         std::size_t sectors_count;
         std::size_t sea_routes_count;
 
       private:
-        void read_data() override;
+        void read_data(std::vector<Forcing>& data) override;
 
       public:
         EventForcing(const std::string& filename, const std::string& variable_name, Model* model);
@@ -64,6 +64,7 @@ class EventSeriesScenario : public ExternalScenario {
 
   public:
     EventSeriesScenario(const settings::SettingsNode& settings_p, settings::SettingsNode scenario_node_p, Model* model_p);
+    ~EventSeriesScenario() override;
 };
 }  // namespace acclimate
 
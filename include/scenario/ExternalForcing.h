@@ -18,17 +18,45 @@
   along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #ifndef ACCLIMATE_EXTERNALFORCING_H
 #define ACCLIMATE_EXTERNALFORCING_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "acclimate.h"
 #include "netcdfpp.h"
 
 namespace acclimate {
 
+class MappedForcingFile;  // IWYU pragma: keep
+
+struct ForcingChange {
+    std::uint32_t index;
+    Forcing value;
+};
+
+// entries of a forcing timestep that changed since the previous timestep, either pointing into a memory-mapped forcing file or into buffer
+// (moving keeps begin/end valid as the buffer storage is moved along)
+class ForcingChanges {
+    friend class ExternalForcing;
+    friend class MappedForcingFile;
+
+  private:
+    std::vector<ForcingChange> buffer;
+    const ForcingChange* begin_ = nullptr;
+    const ForcingChange* end_ = nullptr;
+
+  public:
+    const ForcingChange* begin() const { return begin_; }
+    const ForcingChange* end() const { return end_; }
+    bool empty() const { return begin_ == end_; }
+};
+
 class ExternalForcing {
   protected:
     TimeStep time_index;
@@ -36,14 +64,19 @@ class ExternalForcing {
     netCDF::File file;
     std::unique_ptr<netCDF::Variable> variable;
     std::unique_ptr<netCDF::Variable> time_variable;
+    std::unique_ptr<MappedForcingFile> mapped;  // set if reading from a memory-mapped forcing file rather than netCDF
+    std::vector<Forcing> data;
+    std::vector<Forcing> previous_data;
 
   protected:
-    virtual void read_data() = 0;
+    virtual void read_data(std::vector<Forcing>& data_p) = 0;
+    bool has_labels(const std::string& name) const;
+    std::vector<std::string> labels(const std::string& name) const;
 
   public:
     ExternalForcing(std::string filename, std::string variable_name);
     virtual ~ExternalForcing();
-    int next_timestep();
+    int next_timestep(ForcingChanges& changes);
     std::string calendar_str() const;
     std::string time_units_str() const;
 };
@@ -21,10 +21,18 @@
 #ifndef ACCLIMATE_EXTERNALSCENARIO_H
 #define ACCLIMATE_EXTERNALSCENARIO_H
 
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "acclimate.h"
+#include "scenario/ExternalForcing.h"
 #include "scenario/Scenario.h"
 
 namespace settings {
@@ -33,10 +41,39 @@ class SettingsNode;
 
 namespace acclimate {
 
-class ExternalForcing;  // IWYU pragma: keep
 class Model;
 
 class ExternalScenario : public Scenario {
+  private:
+    struct ForcingStep {
+        std::shared_ptr<ExternalForcing> forcing;  // nullptr if there are no more forcing files
+        bool new_file = false;
+        std::string filename;        // only set for new_file
+        std::string calendar_str;    // only set for new_file
+        std::string time_units_str;  // only set for new_file
+        int day = -1;                // -1 if there are no more timesteps in this file
+        ForcingChanges changes;
+    };
+
+  private:
+    // state of the reading side, only accessed by the prefetch thread if prefetching is enabled
+    std::shared_ptr<ExternalForcing> reading_forcing;
+    unsigned int reading_file_index = 0;
+
+    std::size_t prefetch_size = 0;  // maximum number of timesteps read in advance, 0 to read synchronously
+    std::thread prefetch_thread;
+    std::mutex prefetch_mutex;
+    std::condition_variable prefetch_cv;
+    std::deque<ForcingStep> prefetch_queue;
+    std::exception_ptr prefetch_exception;
+    bool prefetch_stop = false;
+    bool prefetch_finished = false;
+
+  private:
+    ForcingStep read_step();
+    ForcingStep fetch_step();
+    void prefetch();
+
   protected:
     std::string forcing_file;
     std::string expression;
@@ -51,12 +88,13 @@ class ExternalScenario : public Scenario {
     Time next_time = Time(0.0);
     Time time_offset = Time(0.0);
     int time_step_width = 1;
-    std::unique_ptr<ExternalForcing> forcing;
+    std::shared_ptr<ExternalForcing> forcing;
+    ForcingChanges forcing_changes;  // entries of forcing for next_time that differ from the previously read timestep
 
   protected:
     ExternalScenario(const settings::SettingsNode& settings_p, settings::SettingsNode scenario_node_p, Model* model_p);
     bool next_forcing_file();
-    std::string fill_template(const std::string& in) const;
+    std::string fill_template(const std::string& in, unsigned int index) const;
     unsigned int get_ref_year(const std::string& filename, const std::string& time_str);
     virtual void internal_start() {}
     virtual void internal_iterate_start() {}
@@ -64,9 +102,11 @@ class ExternalScenario : public Scenario {
     virtual void iterate_first_timestep() {}
     virtual ExternalForcing* read_forcing_file(const std::string& filename, const std::string& variable_name) = 0;
     virtual void read_forcings() = 0;
+    // the prefetch thread calls read_forcing_file, so deriving classes have to call this in their destructor
+    void stop_prefetch();
 
   public:
-    virtual ~ExternalScenario() override = default;
+    virtual ~ExternalScenario() override;
     void iterate() override;
     void start() override;
     void end() override;
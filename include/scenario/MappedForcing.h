@@ -0,0 +1,89 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef ACCLIMATE_MAPPEDFORCING_H
+#define ACCLIMATE_MAPPEDFORCING_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "scenario/ExternalForcing.h"
+
+namespace acclimate {
+
+// Compact forcing format read via a memory mapping, created by convert_forcing from a netCDF forcing file:
+//   Header | strings | ForcingChange[] of all timesteps | Step[timesteps_count]
+// Strings ('\0'-terminated) are: calendar, time units, sector names, region names, sea route names.
+// Each timestep only holds the entries that changed since the previous timestep (all entries for the first timestep), indexed as
+// read by EventSeriesScenario (i.e. sector-major sector x region or sea routes). Host byte order.
+class MappedForcingFile {
+  public:
+    static constexpr std::array<char, 8> MAGIC = {'A', 'C', 'C', 'F', 'R', 'C', '0', '1'};
+
+    struct Header {
+        std::array<char, 8> magic;
+        std::uint64_t timesteps_count;
+        std::uint64_t sectors_count;
+        std::uint64_t regions_count;
+        std::uint64_t sea_routes_count;
+        std::uint64_t strings_offset;
+        std::uint64_t steps_offset;
+    };
+
+    struct Step {
+        std::int64_t day;
+        std::uint64_t changes_offset;
+        std::uint64_t changes_count;
+    };
+
+  private:
+    const char* data = nullptr;
+    std::size_t size = 0;
+    const Header* header_m = nullptr;
+    const Step* steps = nullptr;
+    std::string calendar_str_;
+    std::string time_units_str_;
+    std::vector<std::string> sectors_;
+    std::vector<std::string> regions_;
+    std::vector<std::string> sea_routes_;
+
+  public:
+    explicit MappedForcingFile(const std::string& filename);
+    ~MappedForcingFile();
+    MappedForcingFile(const MappedForcingFile&) = delete;
+    MappedForcingFile& operator=(const MappedForcingFile&) = delete;
+    static bool is_mapped_forcing(const std::string& filename);
+    std::size_t timesteps_count() const { return header_m->timesteps_count; }
+    int day(std::size_t time_index) const { return steps[time_index].day; }
+    void changes(std::size_t time_index, ForcingChanges& res) const;
+    const std::string& calendar_str() const { return calendar_str_; }
+    const std::string& time_units_str() const { return time_units_str_; }
+    const std::vector<std::string>& labels(const std::string& name) const;
+};
+
+void convert_forcing(const std::string& netcdf_filename, const std::string& variable_name, const std::string& filename);
+
+}  // namespace acclimate
+
+#endif
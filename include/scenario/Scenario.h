@@ -21,7 +21,9 @@
 #ifndef ACCLIMATE_SCENARIO_H
 #define ACCLIMATE_SCENARIO_H
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
 #include "acclimate.h"
 #include "settingsnode.h"
@@ -34,21 +36,45 @@ class GeoLocation;
 class Model;
 
 class Scenario {
+  protected:
+    struct Action {
+        enum class type_t { FIRM_FORCING, FIRM_REMAINING_CAPACITY, CONSUMER_FORCING, LOCATION_PASSAGE };
+        type_t type;
+        Firm* firm = nullptr;
+        Consumer* consumer = nullptr;
+        GeoLocation* location = nullptr;
+        Forcing value;
+
+        void apply(bool reset) const;
+    };
+
+    struct Event {
+        std::size_t index;  // position in settings, determines order of application
+        Time from;
+        Time to;
+        std::vector<Action> actions;
+    };
+
+  private:
+    std::vector<Event> timeline;  // sorted by start time
+    std::size_t next_event = 0;
+    std::vector<const Event*> active_events;  // sorted by index
+
   protected:
     settings::SettingsNode scenario_node;
     const settings::SettingsNode& settings;
     non_owning_ptr<Model> model_m;
 
   protected:
-    void set_firm_property(Firm* firm, const settings::SettingsNode& node, bool reset);
-    void set_consumer_property(Consumer* consumer, const settings::SettingsNode& node, bool reset);
-    void set_location_property(GeoLocation* location, const settings::SettingsNode& node, bool reset);
-    void apply_target(const settings::SettingsNode& node, bool reset);
+    static void compile_firm_property(Firm* firm, const settings::SettingsNode& node, std::vector<Action>& actions);
+    static void compile_consumer_property(Consumer* consumer, const settings::SettingsNode& node, std::vector<Action>& actions);
+    static void compile_location_property(GeoLocation* location, const settings::SettingsNode& node, std::vector<Action>& actions);
+    void compile_targets(const settings::SettingsNode& node, std::vector<Action>& actions);
 
   public:
     Scenario(const settings::SettingsNode& settings_p, settings::SettingsNode scenario_node_p, Model* model_p);
     virtual ~Scenario() = default;
-    virtual void start() {}
+    virtual void start();
     virtual void end() {}
     virtual void iterate();
     virtual std::string calendar_str() const { return "standard"; }
@@ -34,6 +34,7 @@
 #include "input/ModelInitializer.h"
 #include "model/EconomicAgent.h"
 #include "model/Model.h"
+#include "model/PurchasingManager.h"
 #include "model/Sector.h"
 #include "openmp.h"
 #include "output/ArrayOutput.h"
@@ -77,6 +78,26 @@ static void handle_fpe_error(int /* signal */) {
 ModelRun::ModelRun(const settings::SettingsNode& settings) {
     step(IterationStep::INITIALIZATION);
 
+    {
+        const auto& level = settings["log_level"].as<hashed_string>("info");
+        switch (level) {
+            case hash("verbose"):
+                log::set_level(log::level_t::VERBOSE);
+                break;
+            case hash("info"):
+                log::set_level(log::level_t::INFO);
+                break;
+            case hash("warning"):
+                log::set_level(log::level_t::WARNING);
+                break;
+            case hash("none"):
+                log::set_level(log::level_t::NONE);
+                break;
+            default:
+                throw log::error("Unknown log level '", level, "'");
+        }
+    }
+
     if constexpr (options::BANKERS_ROUNDING) {
         fesetround(FE_TONEAREST);
     }
@@ -195,6 +216,25 @@ void ModelRun::run() {
 
         step(IterationStep::OUTPUT);
         log::info(this, "Iteration took ", duration_m, " ms");
+        if (model_m->parameters().purchasing_memoization && log::enabled(log::level_t::INFO)) {
+            std::size_t reused = 0;
+            std::size_t warm_started = 0;
+            for (const auto& p : model_m->parallelized_storages) {
+                reused += p.first->reused_solution();
+                warm_started += p.first->warm_started_solution();
+            }
+            log::info(this, "Purchasing solutions reused: ", reused, ", warm-started: ", warm_started, " of ", model_m->parallelized_storages.size());
+        }
+        if (model_m->parameters().purchasing_approximation && log::enabled(log::level_t::INFO)) {
+            std::size_t approximated = 0;
+            std::size_t rejected = 0;
+            for (const auto& p : model_m->parallelized_storages) {
+                approximated += p.first->approximated_solution();
+                rejected += p.first->rejected_approximation();
+            }
+            log::info(this, "Purchasing solutions approximated: ", approximated, ", approximation fell back to optimization: ", rejected, " of ",
+                      model_m->parallelized_storages.size());
+        }
         for (const auto& output : outputs_m) {
             output->iterate();
         }
@@ -211,6 +251,7 @@ void ModelRun::run() {
                 for (const auto& output : outputs_m) {
                     output->checkpoint_stop();
                 }
+                log::flush();
 
                 checkpoint::write();
 
@@ -226,6 +267,7 @@ void ModelRun::run() {
         model_m->tick();
         ++time_m;
     }
+    log::flush();
 }
 
 ModelRun::~ModelRun() {
@@ -252,23 +294,27 @@ std::string ModelRun::now() const {
     return res;
 }
 
+// formats the optional event value only once the message has passed the log level filter
+static auto event_value(FloatType value) {
+    return [value]() { return std::isnan(value) ? std::string() : " = " + std::to_string(value); };
+}
+
 void ModelRun::event(EventType type, const Sector* sector, const EconomicAgent* economic_agent, FloatType value) {
-    log::info(this, EVENT_NAMES[static_cast<int>(type)], " ", sector->id, "->", economic_agent->id, std::isnan(value) ? "" : " = " + std::to_string(value));
+    log::info(this, EVENT_NAMES[static_cast<int>(type)], " ", sector->id, "->", economic_agent->id, event_value(value));
     for (const auto& output : outputs_m) {
         output->event(type, sector, economic_agent, value);
     }
 }
 
 void ModelRun::event(EventType type, const EconomicAgent* economic_agent, FloatType value) {
-    log::info(this, EVENT_NAMES[static_cast<int>(type)], " ", economic_agent->id, std::isnan(value) ? "" : " = " + std::to_string(value));
+    log::info(this, EVENT_NAMES[static_cast<int>(type)], " ", economic_agent->id, event_value(value));
     for (const auto& output : outputs_m) {
         output->event(type, economic_agent, value);
     }
 }
 
 void ModelRun::event(EventType type, const EconomicAgent* economic_agent_from, const EconomicAgent* economic_agent_to, FloatType value) {
-    log::info(this, EVENT_NAMES[static_cast<int>(type)], " ", economic_agent_from->id, "->", economic_agent_to->id,
-              std::isnan(value) ? "" : " = " + std::to_string(value));
+    log::info(this, EVENT_NAMES[static_cast<int>(type)], " ", economic_agent_from->id, "->", economic_agent_to->id, event_value(value));
     for (const auto& output : outputs_m) {
         output->event(type, economic_agent_from, economic_agent_to, value);
     }
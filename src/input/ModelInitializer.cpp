@@ -776,6 +776,7 @@ void ModelInitializer::read_transport_times_csv(const std::string& index_filenam
 void ModelInitializer::build_artificial_network() {
     const settings::SettingsNode& network = settings["network"];
     const auto closed = network["closed"].as<bool>(false);
+    const auto star = network["star"].as<bool>(false);  // SEC1:RG0 additionally supplies to and buys from every other firm
     const auto skewness = network["skewness"].as<unsigned int>();
     if (skewness < 1) {
         throw log::error(this, "Skewness must be >= 1");
@@ -817,6 +818,18 @@ void ModelInitializer::build_artificial_network() {
             }
         }
     }
+    if (star) {  // hub with connections to all firms, e.g. for testing the parallelization of large agents
+        auto* hub = model()->sectors[1]->firms[0];
+        for (std::size_t r = 0; r < regions_cnt; ++r) {
+            for (std::size_t i = 0; i < sectors_cnt; ++i) {
+                auto* firm = model()->sectors[i + 1]->firms[r];
+                if (firm != hub) {
+                    initialize_connection(hub, firm, flow);
+                    initialize_connection(firm, hub, flow);
+                }
+            }
+        }
+    }
 }
 
 void ModelInitializer::build_agent_network() {
@@ -1018,6 +1031,8 @@ void ModelInitializer::pre_initialize() {
     model()->parameters_writable().transport_penalty_large = parameters["transport_penalty_large"].as<Price>();
     model()->parameters_writable().optimization_maxiter = parameters["optimization_maxiter"].as<int>();
     model()->parameters_writable().optimization_timeout = parameters["optimization_timeout"].as<unsigned int>();
+    model()->parameters_writable().deterministic_optimization = parameters["deterministic_optimization"].as<bool>(false);
+    model()->parameters_writable().optimization_evaluations_per_dimension = parameters["optimization_evaluations_per_dimension"].as<int>(100);
     model()->parameters_writable().quadratic_transport_penalty = parameters["quadratic_transport_penalty"].as<bool>(true);
     model()->parameters_writable().maximal_decrease_reservation_price_limited_by_markup =
         parameters["maximal_decrease_reservation_price_limited_by_markup"].as<bool>(false);
@@ -1025,6 +1040,7 @@ void ModelInitializer::pre_initialize() {
     model()->parameters_writable().naive_expectations = parameters["naive_expectations"].as<bool>(true);
     model()->parameters_writable().deviation_penalty = parameters["deviation_penalty"].as<bool>(false);
     model()->parameters_writable().min_storage = parameters["min_storage"].as<Ratio>(0.0);
+    model()->parameters_writable().purchasing_pruning_threshold = parameters["purchasing_pruning_threshold"].as<Ratio>(0.0);
     model()->parameters_writable().cheapest_price_range_preserve_seller_price = parameters["cheapest_price_range_preserve_seller_price"].as<bool>(false);
     model()->parameters_writable().cheapest_price_range_generic_size = (parameters["cheapest_price_range_width"].as<std::string>() == "auto");
     if (!model()->parameters_writable().cheapest_price_range_generic_size) {
@@ -1038,13 +1054,40 @@ void ModelInitializer::pre_initialize() {
     model()->parameters_writable().global_purchasing_optimization = parameters["global_purchasing_optimization"].as<bool>(false);
     model()->parameters_writable().local_purchasing_optimization = parameters["local_purchasing_optimization"].as<bool>(true);
     model()->parameters_writable().optimization_restart_baseline = parameters["optimization_restart_baseline"].as<bool>(false);
+    model()->parameters_writable().purchasing_memoization = parameters["purchasing_memoization"].as<bool>(false);
+    model()->parameters_writable().purchasing_memoization_tolerance = parameters["purchasing_memoization_tolerance"].as<FloatType>(0.0);
+    model()->parameters_writable().purchasing_approximation = parameters["purchasing_approximation"].as<bool>(false);
+    model()->parameters_writable().purchasing_approximation_tolerance = parameters["purchasing_approximation_tolerance"].as<FloatType>(1e-3);
+    model()->parameters_writable().batched_purchasing = parameters["batched_purchasing"].as<bool>(false);
+    if (model()->parameters().batched_purchasing && (model()->parameters().global_purchasing_optimization || !model()->parameters().local_purchasing_optimization)) {
+        throw log::error(this, "batched_purchasing replaces the local purchasing optimization and requires local_purchasing_optimization without global_purchasing_optimization");
+    }
+    model()->parameters_writable().batched_purchasing_cross_check_tolerance = parameters["batched_purchasing_cross_check_tolerance"].as<FloatType>(0.0);
     model()->parameters_writable().start_purchasing_at_baseline = parameters["start_purchasing_at_baseline"].as<bool>(false);
     model()->parameters_writable().purchasing_halfway_baseline = parameters["purchasing_halfway_baseline"].as<bool>(false);
 
     model()->parameters_writable().global_utility_optimization = parameters["global_utility_optimization"].as<bool>(false);
     model()->parameters_writable().budget_inequality_constrained = parameters["budget_inequality_constrained"].as<bool>(false);
     model()->parameters_writable().elastic_budget = parameters["elastic_budget"].as<bool>(false);
+    model()->parameters_writable().linear_budget_constraint = parameters["linear_budget_constraint"].as<bool>(false);
     model()->parameters_writable().global_utility_optimization_random_points = parameters["global_sampling_points"].as<int>(64);
+    {
+        const auto& method = parameters["utility_optimization_method"].as<hashed_string>("analytic");
+        switch (method) {
+            case hash("analytic"):
+                model()->parameters_writable().utility_optimization_method = Parameters::ModelParameters::utility_optimization_method_t::ANALYTIC;
+                break;
+            case hash("nlopt"):
+                model()->parameters_writable().utility_optimization_method = Parameters::ModelParameters::utility_optimization_method_t::NLOPT;
+                break;
+            case hash("cross_check"):
+                model()->parameters_writable().utility_optimization_method = Parameters::ModelParameters::utility_optimization_method_t::CROSS_CHECK;
+                break;
+            default:
+                throw log::error(this, "Unknown utility optimization method '", method, "'");
+        }
+    }
+    model()->parameters_writable().utility_cross_check_tolerance = parameters["utility_cross_check_tolerance"].as<FloatType>(1e-6);
     model()->parameters_writable().utility_optimization_algorithm =
         optimization::get_algorithm(parameters["utility_optimization_algorithm"].as<hashed_string>("slsqp"));
     model()->parameters_writable().global_optimization_algorithm =
@@ -1075,13 +1118,39 @@ void ModelInitializer::pre_initialize() {
     model()->parameters_writable().global_optimization_timeout =
         parameters["global_optimization_timeout"].as<unsigned int>(model()->parameters_writable().optimization_timeout);
 
+    model()->parameters_writable().nested_parallelization_threshold = parameters["nested_parallelization_threshold"].as<unsigned int>(0);
+    model()->parameters_writable().nested_objective_parallelization_threshold =
+        parameters["nested_objective_parallelization_threshold"].as<unsigned int>(0);
+
     model()->parameters_writable().debug_purchasing_steps = parameters["debug_purchasing_steps"].to_vector<std::string>();
+    // purchasing problems of debug_purchasing_steps are recorded regardless of the thresholds
+    model()->parameters_writable().purchasing_record_file = parameters["purchasing_record_file"].as<std::string>("");
+    model()->parameters_writable().purchasing_record_time = parameters["purchasing_record_time"].as<FloatType>(0.0);
+    model()->parameters_writable().purchasing_record_evaluations = parameters["purchasing_record_evaluations"].as<int>(0);
 }
 
 void ModelInitializer::post_initialize() {
     for (auto& agent : model()->economic_agents) {
         agent->initialize();
     }
+
+    // resolve purchasing steps to debug once so that the purchasing step only needs to check a flag
+    const auto& debug_purchasing_steps = model()->parameters().debug_purchasing_steps;
+    if (!debug_purchasing_steps.empty()) {
+        std::size_t found = 0;
+        for (auto& agent : model()->economic_agents) {
+            for (auto& input_storage : agent->input_storages) {
+                if (std::find(std::begin(debug_purchasing_steps), std::end(debug_purchasing_steps), input_storage->name())
+                    != std::end(debug_purchasing_steps)) {
+                    input_storage->purchasing_manager->debug_distribution = true;
+                    ++found;
+                }
+            }
+        }
+        if (found < debug_purchasing_steps.size()) {
+            log::warning(this, "only ", found, " of ", debug_purchasing_steps.size(), " debug_purchasing_steps found in network");
+        }
+    }
 }
 
 }  // namespace acclimate
@@ -0,0 +1,235 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "acclimate.h"
+#include "openmp.h"
+
+namespace acclimate::log {
+
+namespace {
+
+constexpr std::size_t BUFFER_CAPACITY = 1024;  // messages per thread
+constexpr std::size_t MAX_THREADS = 256;       // threads with higher openmp::get_global_thread() drop their messages
+constexpr auto DRAIN_INTERVAL = std::chrono::milliseconds(100);
+
+// single-producer (owning thread) single-consumer (logger thread) ring buffer of preallocated message slots; producers never block or allocate,
+// if the buffer is full, messages are dropped and counted
+class RingBuffer {
+  private:
+    struct Slot {
+        detail::Message* message = nullptr;  // constructed in storage, not necessarily at its beginning
+        alignas(std::max_align_t) std::array<unsigned char, detail::MESSAGE_SLOT_SIZE> storage;
+    };
+    std::array<Slot, BUFFER_CAPACITY> slots;
+    std::atomic<std::size_t> head{0};  // only written by the producer
+    std::atomic<std::size_t> tail{0};  // only written by the consumer
+    std::atomic<std::size_t> dropped{0};
+
+  public:
+    // producer side
+
+    void* acquire() {
+        const auto h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == BUFFER_CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return slots[h % BUFFER_CAPACITY].storage.data();
+    }
+
+    // returns number of queued messages after publishing
+    std::size_t publish(detail::Message* message) {
+        const auto h = head.load(std::memory_order_relaxed);
+        slots[h % BUFFER_CAPACITY].message = message;
+        head.store(h + 1, std::memory_order_release);
+        return h + 1 - tail.load(std::memory_order_relaxed);
+    }
+
+    // consumer side
+
+    const detail::Message* front() const {
+        const auto t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return slots[t % BUFFER_CAPACITY].message;
+    }
+
+    void pop() {
+        const auto t = tail.load(std::memory_order_relaxed);
+        slots[t % BUFFER_CAPACITY].message->~Message();
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    std::size_t take_dropped() { return dropped.exchange(0, std::memory_order_relaxed); }
+};
+
+class Logger {
+  private:
+    std::mutex mutex;  // only taken by the logger thread and explicit flushes, guards next_sequence, active and writing to the output stream
+    std::condition_variable wakeup;
+    std::array<std::atomic<RingBuffer*>, MAX_THREADS> buffers{};  // indexed by openmp::get_global_thread(), owned by the logger
+    std::vector<RingBuffer*> active;                               // buffers registered so far, reused by each drain
+    std::atomic<std::size_t> dropped_unregistered{0};
+    std::atomic<std::uint64_t> sequence{0};
+    std::uint64_t next_sequence = 0;
+    bool stop = false;
+    std::thread thread;
+
+    // writes queued messages in the order they were issued across threads; each buffer is in order already, so they are merged by their
+    // first message; unless forced, stops at a gap in the sequence, i.e. at a message that is still being published by its thread
+    void drain(bool force) {
+        active.clear();
+        for (const auto& buffer : buffers) {
+            if (auto* b = buffer.load(std::memory_order_acquire); b != nullptr) {
+                active.push_back(b);
+            }
+        }
+        std::size_t dropped = dropped_unregistered.exchange(0, std::memory_order_relaxed);
+        for (auto* buffer : active) {
+            dropped += buffer->take_dropped();
+        }
+        bool written = false;
+        while (true) {
+            RingBuffer* first = nullptr;
+            for (auto* buffer : active) {
+                const auto* message = buffer->front();
+                if (message != nullptr && (first == nullptr || message->sequence < first->front()->sequence)) {
+                    first = buffer;
+                }
+            }
+            if (first == nullptr) {
+                break;
+            }
+            const auto* message = first->front();
+            if (message->sequence > next_sequence && !force) {
+                break;
+            }
+            next_sequence = std::max(next_sequence, message->sequence + 1);
+            message->write(std::cout);
+            std::cout << '\n';
+            first->pop();
+            written = true;
+        }
+        if (dropped > 0) {
+            std::cout << "Warning: " << dropped << " log messages dropped as log buffers were full\n";
+            written = true;
+        }
+        if (written) {
+            std::cout << std::flush;
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stop) {
+            wakeup.wait_for(lock, DRAIN_INTERVAL);
+            drain(false);
+        }
+        drain(true);
+    }
+
+    RingBuffer* thread_buffer() {
+        thread_local RingBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            const auto index = openmp::get_global_thread();
+            if (index >= MAX_THREADS) {
+                return nullptr;
+            }
+            buffer = new RingBuffer();  // once per thread, kept until the logger is destroyed so that it can be drained after its thread has ended
+            buffers[index].store(buffer, std::memory_order_release);
+        }
+        return buffer;
+    }
+
+  public:
+    Logger() : thread([this]() { run(); }) { active.reserve(MAX_THREADS); }
+
+    ~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wakeup.notify_one();
+        thread.join();
+        for (auto& buffer : buffers) {
+            delete buffer.load(std::memory_order_relaxed);
+        }
+    }
+
+    void* acquire_slot() {
+        auto* buffer = thread_buffer();
+        if (buffer == nullptr) {
+            dropped_unregistered.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return buffer->acquire();
+    }
+
+    void publish_slot(detail::Message* message) {
+        message->sequence = sequence.fetch_add(1, std::memory_order_relaxed);
+        if (thread_buffer()->publish(message) == BUFFER_CAPACITY / 2) {
+            wakeup.notify_one();
+        }
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        drain(true);
+    }
+
+    void write_immediately(const std::string& text) {
+        std::lock_guard<std::mutex> lock(mutex);
+        drain(true);
+        std::cout << text << '\n' << std::flush;
+    }
+};
+
+Logger& logger() {
+    static Logger instance;
+    return instance;
+}
+
+}  // namespace
+
+void* detail::acquire_slot() { return logger().acquire_slot(); }
+
+void detail::publish_slot(Message* message) { logger().publish_slot(message); }
+
+void detail::write_immediately(const std::string& text) { logger().write_immediately(text); }
+
+void flush() { logger().flush(); }
+
+}  // namespace acclimate::log
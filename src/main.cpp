@@ -27,6 +27,7 @@
 
 #include "ModelRun.h"
 #include "acclimate.h"
+#include "scenario/MappedForcing.h"
 #include "settingsnode.h"
 #include "settingsnode/inner.h"
 #include "settingsnode/yaml.h"
@@ -48,6 +49,8 @@ static void print_usage(const char* program_name) {
               << program_name
               << " (<option> | <settingsfile>)\n"
                  "Options:\n"
+                 "  -c, --convert-forcing <netcdf file> <variable> <output file>\n"
+                 "                 Convert netCDF forcing to compact memory-mapped format\n"
               << (acclimate::has_diff ? "  -d, --diff     Print git diff output from compilation\n" : "")
               << "  -h, --help     Print this help text\n"
                  "  -i, --info     Print further information\n"
@@ -56,6 +59,15 @@ static void print_usage(const char* program_name) {
 }
 
 int main(int argc, char* argv[]) {
+    if (argc == 5 && (std::string(argv[1]) == "--convert-forcing" || std::string(argv[1]) == "-c")) {
+        try {
+            acclimate::convert_forcing(argv[2], argv[3], argv[4]);
+        } catch (const std::exception& ex) {
+            std::cerr << ex.what() << std::endl;
+            return 255;
+        }
+        return 0;
+    }
     if (argc != 2) {
         print_usage(argv[0]);
         return 1;
@@ -114,8 +126,10 @@ int main(int argc, char* argv[]) {
                 acclimate.run();
             }
         } catch (const acclimate::return_after_checkpoint&) {
+            acclimate::log::flush();
             return 7;
         } catch (const std::exception& ex) {
+            acclimate::log::flush();
             std::cerr << ex.what() << std::endl;
             return 255;
         }
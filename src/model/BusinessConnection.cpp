@@ -36,7 +36,8 @@
 namespace acclimate {
 
 BusinessConnection::BusinessConnection(PurchasingManager* buyer_p, SalesManager* seller_p, const Flow& initial_flow_Z_star_p)
-    : buyer(buyer_p),
+    : id(seller_p->name() + "->" + buyer_p->storage->economic_agent->name()),
+      buyer(buyer_p),
       demand_fulfill_history_(1.0),
       initial_flow_Z_star_(initial_flow_Z_star_p),
       last_delivery_Z_(initial_flow_Z_star_p),
@@ -194,10 +195,6 @@ FloatType BusinessConnection::get_stddeviation() const {
 
 const Model* BusinessConnection::model() const { return buyer->model(); }
 
-std::string BusinessConnection::name() const {
-    return (seller.valid() ? seller->name() : "INVALID") + "->" + (buyer.valid() ? buyer->storage->economic_agent->name() : "INVALID");
-}
-
 const Flow& BusinessConnection::last_shipment_Z(const SalesManager* caller) const {
     if constexpr (options::DEBUGGING) {
         if (caller != seller) {
@@ -48,7 +48,7 @@ void CapacityManager::calc_possible_and_desired_production() {
 
 const Model* CapacityManager::model() const { return firm->model(); }
 
-std::string CapacityManager::name() const { return firm->name(); }
+const std::string& CapacityManager::name() const { return firm->name(); }
 
 void CapacityManager::debug_print_inputs() const {
     if constexpr (options::DEBUGGING) {
@@ -83,9 +83,9 @@ Flow CapacityManager::get_possible_production_X_hat_intern(bool consider_transpo
         }
         if (consider_transport_in_production_costs) {
             Flow transport_flow = input_storage->purchasing_manager->get_transport_flow();
-            unit_commodity_costs += (possible_use_U_hat + transport_flow).get_price() * input_storage->get_technology_coefficient_a();
+            unit_commodity_costs += (possible_use_U_hat + transport_flow).get_price() * firm->technology_coefficient_a(input_storage.get());
         } else {
-            unit_commodity_costs += possible_use_U_hat.get_price() * input_storage->get_technology_coefficient_a();
+            unit_commodity_costs += possible_use_U_hat.get_price() * firm->technology_coefficient_a(input_storage.get());
         }
         Ratio tmp = possible_use_U_hat / input_storage->initial_used_flow_U_star();
         if (tmp < possible_production_capacity_p_hat) {
@@ -96,7 +96,7 @@ Flow CapacityManager::get_possible_production_X_hat_intern(bool consider_transpo
     Flow result = round(firm->initial_production_X_star() * possible_production_capacity_p_hat);
     // note: if result.get_quantity() == 0.0 price is NAN
     if (result.get_quantity() > 0.0) {
-        result.set_price(round(unit_commodity_costs + firm->sales_manager->get_initial_unit_variable_production_costs()));
+        result.set_price(round(unit_commodity_costs + firm->initial_unit_variable_production_costs()));
     }
     return result;
 }
@@ -21,14 +21,21 @@
 #include "model/Consumer.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
 #include <memory>
+#include <sstream>
 #include <utility>
 
 #include "ModelRun.h"
 #include "acclimate.h"
-#include "autodiff.h"
+#include "model/ConsumptionUtility.h"
 #include "model/Model.h"
+#include "model/PurchasingProblemRecord.h"
 #include "model/Region.h"
 #include "model/Storage.h"
 #include "optimization.h"
@@ -58,12 +65,6 @@ Consumer::Consumer(id_t id_p,
 void Consumer::initialize() {
     debug::assertstep(this, IterationStep::INITIALIZATION);
 
-    autodiffutility = {input_storages.size(), 0.0};
-    autodiff_basket_consumption_utility = {input_storages.size(), 0.0};
-    autodiff_consumption_utility = {input_storages.size(), 0.0};
-
-    var_optimizer_consumption = autodiff::Variable<FloatType>(input_storages.size(), 0.0);
-
     share_factors = std::vector<FloatType>(input_storages.size());
     exponent_share_factors = std::vector<FloatType>(input_storages.size());
     previous_consumption.reserve(input_storages.size());
@@ -79,13 +80,15 @@ void Consumer::initialize() {
     }
 
     if constexpr (VERBOSE_CONSUMER) {
-        log::info("budget: ", consumption_budget);
+        log::debug(this, "budget: ", consumption_budget);
     }
 
     intra_basket_substitution_coefficient = std::vector<FloatType>(consumer_baskets.size(), 0);
     intra_basket_substitution_exponent = std::vector<FloatType>(consumer_baskets.size(), 0);
     basket_share_factors = std::vector<FloatType>(consumer_baskets.size(), 0);
     exponent_basket_share_factors = std::vector<FloatType>(consumer_baskets.size(), 0);
+    basket_sums = std::vector<FloatType>(consumer_baskets.size(), 0);
+    basket_utilities = std::vector<FloatType>(consumer_baskets.size(), 0);
     consumer_basket_indizes = std::vector<std::vector<int>>(consumer_baskets.size());
     for (int basket = 0; basket < int(consumer_baskets.size()); ++basket) {
         intra_basket_substitution_coefficient[basket] = (consumer_baskets[basket].second);
@@ -163,27 +166,15 @@ void Consumer::initialize() {
 
 // TODO: more sophisticated scaling than normalizing with baseline utility might improve optimization?!
 /**
- * nested CES utility function using automatic differentiation to enable fast gradient calculation
- * @param consumption vector of consumed quantity of each good
- * @return auto-differentiable value of the utility function
+ * nested CES utility function with gradient, see consumption::nested_CES_utility
+ * @param baseline_relative_consumption NLOpt convention of a c-style vector of consumed quantity of each good relative to baseline
+ * @param grad gradient vector (may be nullptr)
+ * @return value of the utility function
  */
-autodiff::Value<FloatType> Consumer::autodiff_nested_CES_utility_function(const autodiff::Variable<FloatType>& baseline_relative_consumption) {
-    autodiff_consumption_utility = {input_storages.size(), 0.0};  // reset to 0 without new call
-    for (int basket = 0; basket < int(consumer_baskets.size()); ++basket) {
-        autodiff_basket_consumption_utility = {input_storages.size(), 0.0};
-        for (auto& index : consumer_basket_indizes[basket]) {
-            auto consumption_quantity = baseline_relative_consumption[index] * share_factors[index];
-            autodiff_basket_consumption_utility += std::pow(consumption_quantity, intra_basket_substitution_exponent[basket]) * exponent_share_factors[index];
-        }
-        autodiff_basket_consumption_utility =
-            std::pow(autodiff_basket_consumption_utility, 1 / intra_basket_substitution_exponent[basket]) * basket_share_factors[basket];
-
-        autodiff_consumption_utility +=
-            std::pow(autodiff_basket_consumption_utility, inter_basket_substitution_exponent) * exponent_basket_share_factors[basket];
-    }
-    autodiff_consumption_utility = std::pow(autodiff_consumption_utility, 1 / inter_basket_substitution_exponent);
-
-    return autodiff_consumption_utility;
+FloatType Consumer::nested_CES_utility_function(const double* baseline_relative_consumption, double* grad) {
+    return consumption::nested_CES_utility(baseline_relative_consumption, grad, input_storages.size(), consumer_basket_indizes, share_factors,
+                                           exponent_share_factors, intra_basket_substitution_exponent, basket_share_factors, exponent_basket_share_factors,
+                                           inter_basket_substitution_exponent, basket_sums, basket_utilities);
 }
 
 // TODO: more complex budget function might be useful, e.g. opportunity for saving etc.
@@ -196,25 +187,23 @@ autodiff::Value<FloatType> Consumer::autodiff_nested_CES_utility_function(const
 FloatType Consumer::equality_constraint(const double* x, double* grad) { return inequality_constraint(x, grad); }
 /**
  * inequality constraint should be sufficient for utility optimization, since more spending -> more consumption should be induced by the objective anyways
+ * expenditure is linear in consumption (quantity times price, as accounted for in consume_optimisation_result) only with linear_budget_constraint
  * @param x NLOpt convention of a c-style vector of consumption
  * @param grad gradient vector
  * @return value of the constraint, which is targeted to be <=0 by NLOpt optimizers
  */
 FloatType Consumer::inequality_constraint(const double* x, double* grad) {
-    double scaled_budget = (consumption_budget + not_spent_budget) / consumption_budget;
-    for (auto& input_storage : input_storages) {
-        int index = input_storage->id.index();
-        assert(!std::isnan(x[index]));
-        double price;
-        if (model()->parameters().elastic_budget) {
-            price = x[index] * std::pow(to_float(consumption_prices[index]), -1 * input_storage->parameters().consumption_price_elasticity);
-        } else {
-            price = x[index] * to_float(consumption_prices[index]);
+    if constexpr (options::DEBUGGING) {
+        for (auto& input_storage : input_storages) {
+            assert(!std::isnan(x[input_storage->id.index()]));
         }
-        scaled_budget -= invert_scaling_double_to_double(x[index], baseline_consumption[index].get_quantity()) * price / to_float(consumption_budget);
+    }
+    const FloatType res = consumption::budget_constraint(x, grad, input_storages.size(), budget_baseline_quantities, budget_prices,
+                                                         to_float(consumption_budget), (consumption_budget + not_spent_budget) / consumption_budget,
+                                                         model()->parameters().linear_budget_constraint);
+    if constexpr (options::OPTIMIZATION_WARNINGS) {
         if (grad != nullptr) {
-            grad[index] = invert_scaling_double_to_double(x[index], baseline_consumption[index].get_quantity()) * price / to_float(consumption_budget);
-            if constexpr (options::OPTIMIZATION_WARNINGS) {
+            for (std::size_t index = 0; index < input_storages.size(); ++index) {
                 assert(!std::isnan(grad[index]));
                 if (grad[index] > MAX_GRADIENT) {
                     log::warning(this, ": large gradient of ", grad[index]);
@@ -222,7 +211,7 @@ FloatType Consumer::inequality_constraint(const double* x, double* grad) {
             }
         }
     }
-    return -scaled_budget;  // since inequality constraint checks for <=0, we need to switch the sign
+    return res;
 }
 /**
  * objective function for utility maximisation, using automatic-differentiable utility function
@@ -231,14 +220,14 @@ FloatType Consumer::inequality_constraint(const double* x, double* grad) {
  * @return value of the objective function, which is maximized
  */
 FloatType Consumer::max_objective(const double* x, double* grad) {
-    for (auto& input_storage : input_storages) {
-        int index = input_storage->id.index();
-        assert(!std::isnan(x[index]));
-        var_optimizer_consumption.value()[index] = x[index];
+    if constexpr (options::DEBUGGING) {
+        for (auto& input_storage : input_storages) {
+            assert(!std::isnan(x[input_storage->id.index()]));
+        }
     }
-    autodiffutility = autodiff_nested_CES_utility_function(var_optimizer_consumption);
+    ++objective_evaluations;
+    const FloatType res = nested_CES_utility_function(x, grad);
     if (grad != nullptr) {
-        std::copy(std::begin(autodiffutility.derivative()), std::end(autodiffutility.derivative()), grad);
         if constexpr (options::OPTIMIZATION_WARNINGS) {
             for (auto& input_storage : input_storages) {
                 int index = input_storage->id.index();
@@ -249,7 +238,7 @@ FloatType Consumer::max_objective(const double* x, double* grad) {
             }
         }
     }
-    return autodiffutility.value();
+    return res;
 }
 
 void Consumer::iterate_consumption_and_production() {
@@ -263,11 +252,15 @@ void Consumer::iterate_consumption_and_production() {
         consume_optimisation_result(consumption);
         local_optimal_utility = optimization_result.second;  // just making sure the field has data, identical to utility in this case
     } else {
-        // calculate local optimal utility consumption for comparison:
-        if constexpr (VERBOSE_CONSUMER) {
-            log::info(this, "local utilitarian consumption optimization:");
+        // calculate local optimal utility consumption for comparison (only if needed for output, as this is a full optimization):
+        if (local_optimal_utility_requested) {
+            if constexpr (VERBOSE_CONSUMER) {
+                log::debug(this, "local utilitarian consumption optimization:");
+            }
+            local_optimal_utility = utilitarian_consumption_optimization().second;
+        } else {
+            local_optimal_utility = std::numeric_limits<FloatType>::quiet_NaN();
         }
-        local_optimal_utility = utilitarian_consumption_optimization().second;
         // old consumer to be used for comparison
         previous_consumption.clear();
         previous_consumption.reserve(input_storages.size());
@@ -306,7 +299,7 @@ void Consumer::iterate_consumption_and_production() {
 }
 
 /**
- * NLOpt based optimization of consumption with respect to utility function
+ * optimization of consumption with respect to utility function, analytically or NLOpt based
  * @return vector of utility maximising consumption flows
  */
 std::pair<std::vector<Flow>, FloatType> Consumer::utilitarian_consumption_optimization() {
@@ -314,10 +307,6 @@ std::pair<std::vector<Flow>, FloatType> Consumer::utilitarian_consumption_optimi
     std::vector<FlowQuantity> starting_value_quantity(input_storages.size());
     std::vector<FloatType> scaled_starting_value = std::vector<FloatType>(input_storages.size());
 
-    // optimization parameters
-    std::vector<FloatType> xtol_abs(input_storages.size(), FlowQuantity::precision * model()->parameters().utility_optimization_precision_adjustment);
-    std::vector<FloatType> xtol_abs_global(input_storages.size(),
-                                           FlowQuantity::precision * model()->parameters().global_utility_optimization_precision_adjustment);
     std::vector<FloatType> lower_bounds(input_storages.size());
     std::vector<FloatType> upper_bounds = std::vector<FloatType>(input_storages.size());
 
@@ -361,19 +350,245 @@ std::pair<std::vector<Flow>, FloatType> Consumer::utilitarian_consumption_optimi
         }
     }
     // utility optimization
-    // set parameters
+    const auto method = model()->parameters().utility_optimization_method;
+    bool solved = false;
+    if (method != Parameters::ModelParameters::utility_optimization_method_t::NLOPT) {
+        solved = analytic_consumption_optimization(lower_bounds, upper_bounds);
+        if (solved) {
+            optimized_utility = nested_CES_utility_function(&optimizer_consumption[0], nullptr);
+        } else {
+            log::warning(this, "analytic utility optimization not applicable, using NLopt instead");
+        }
+    }
+    if (!solved) {
+        optimized_utility = nlopt_consumption_optimization(scaled_starting_value, lower_bounds, upper_bounds);
+    } else if (method == Parameters::ModelParameters::utility_optimization_method_t::CROSS_CHECK) {
+        const std::vector<double> analytic_consumption = optimizer_consumption;
+        const FloatType nlopt_utility = nlopt_consumption_optimization(scaled_starting_value, lower_bounds, upper_bounds);
+        if (std::abs(optimized_utility - nlopt_utility) > model()->parameters().utility_cross_check_tolerance * std::abs(nlopt_utility)) {
+            log::warning(this, "analytic utility optimization deviates from NLopt: utility ", optimized_utility, " vs. ", nlopt_utility);
+            if constexpr (options::DEBUGGING) {
+                for (auto& input_storage : input_storages) {
+                    const int index = input_storage->id.index();
+                    log::info(input_storage->name(), " analytic consumption: ", analytic_consumption[index], " NLopt consumption: ", optimizer_consumption[index]);
+                }
+            }
+        }
+        optimizer_consumption = analytic_consumption;
+    }
+    std::vector<Flow> consumption;
+    consumption.reserve(input_storages.size());
+    for (auto& input_storage : input_storages) {
+        int index = input_storage->id.index();
+        consumption.emplace_back(invert_scaling_double_to_quantity(optimizer_consumption[index], baseline_consumption[index].get_quantity()),
+                                 consumption_prices[index]);
+    }
+    return std::pair<std::vector<Flow>, FloatType>(consumption, optimized_utility);
+}
+
+/**
+ * analytic optimization of consumption with respect to nested CES utility function under linear budget constraint
+ *
+ * Within basket b with substitution coefficient s_b the optimal baseline-relative consumption of good i is x_i = (a_i / (mu_b c_i))^s_b for share
+ * factor a_i, unit costs c_i and basket multiplier mu_b. Across baskets, the marginal utility of spending K_b A_b^(r - r_b) mu_b has to be the same
+ * multiplier lambda for all baskets (A_b being the basket aggregate, r and r_b the substitution exponents). Without binding bounds this has a
+ * closed form. Otherwise, goods are clamped to their bounds (active set) and mu_b and lambda are found by bisection, which is exact as all
+ * expenditures are monotonous in the multipliers.
+ * @param lower_bounds lower bounds of baseline-relative consumption
+ * @param upper_bounds upper bounds of baseline-relative consumption
+ * @return false if not applicable, otherwise consumption is stored in optimizer_consumption
+ */
+bool Consumer::analytic_consumption_optimization(const std::vector<FloatType>& lower_bounds, const std::vector<FloatType>& upper_bounds) {
+    static constexpr int MAX_BISECTION_STEPS = 200;
+    static constexpr FloatType BISECTION_PRECISION = 1e-14;
+
+    const FloatType inter_exponent = inter_basket_substitution_exponent;
+    if (inter_exponent == 0.0 || !std::isfinite(inter_exponent)) {
+        return false;  // Cobb-Douglas case not covered by utility function
+    }
+
+    // goods not in any basket do not add to utility and stay at their lower bounds
+    optimizer_consumption = lower_bounds;
+    consumption_costs.resize(input_storages.size());
+    FloatType budget = to_float(consumption_budget + not_spent_budget);
+    for (auto& input_storage : input_storages) {
+        const int index = input_storage->id.index();
+        FloatType price;
+        if (model()->parameters().elastic_budget) {
+            price = std::pow(to_float(consumption_prices[index]), -1 * input_storage->parameters().consumption_price_elasticity);
+        } else {
+            price = to_float(consumption_prices[index]);
+        }
+        consumption_costs[index] = invert_scaling_double_to_double(1.0, baseline_consumption[index].get_quantity()) * price;
+        budget -= consumption_costs[index] * lower_bounds[index];
+    }
+
+    FloatType lower_expenditure = 0.0;  // expenditure for goods in baskets if all are at their lower bounds
+    FloatType upper_expenditure = 0.0;  // expenditure for goods in baskets if all are at their upper bounds
+    for (int basket = 0; basket < int(consumer_baskets.size()); ++basket) {
+        if (intra_basket_substitution_exponent[basket] == 0.0 || !std::isfinite(intra_basket_substitution_exponent[basket])) {
+            return false;
+        }
+        for (auto& index : consumer_basket_indizes[basket]) {
+            if (upper_bounds[index] > 0.0 && (!(consumption_costs[index] > 0.0) || !(share_factors[index] > 0.0))) {
+                return false;
+            }
+            lower_expenditure += consumption_costs[index] * lower_bounds[index];
+            upper_expenditure += consumption_costs[index] * upper_bounds[index];
+        }
+    }
+    budget += lower_expenditure;  // budget left for goods in baskets
+    if (upper_expenditure <= budget || lower_expenditure >= budget) {  // budget does not bind or cannot be met at all
+        for (int basket = 0; basket < int(consumer_baskets.size()); ++basket) {
+            for (auto& index : consumer_basket_indizes[basket]) {
+                optimizer_consumption[index] = upper_expenditure <= budget ? upper_bounds[index] : lower_bounds[index];
+            }
+        }
+        return true;
+    }
+
+    bool clamped = false;
+    // set demand in basket for basket multiplier mu (clamped to bounds), returns basket aggregate A_b
+    const auto basket_demand = [&](int basket, FloatType mu) {
+        const FloatType coefficient = intra_basket_substitution_coefficient[basket];
+        const FloatType exponent = intra_basket_substitution_exponent[basket];
+        FloatType aggregate = 0.0;
+        for (auto& index : consumer_basket_indizes[basket]) {
+            if (upper_bounds[index] <= 0.0) {
+                optimizer_consumption[index] = 0.0;
+                continue;
+            }
+            const FloatType x = std::pow(share_factors[index] / (mu * consumption_costs[index]), coefficient);
+            optimizer_consumption[index] = std::min(std::max(x, lower_bounds[index]), upper_bounds[index]);
+            clamped = clamped || optimizer_consumption[index] != x;
+            aggregate += share_factors[index] * std::pow(optimizer_consumption[index], exponent);
+        }
+        return std::pow(aggregate, 1 / exponent);
+    };
+    // marginal utility of spending in basket (up to the factor U^(1-r) common to all baskets)
+    const auto marginal_utility = [&](int basket, FloatType mu) {
+        return exponent_basket_share_factors[basket] * std::pow(basket_share_factors[basket], inter_exponent)
+               * std::pow(basket_demand(basket, mu), inter_exponent - intra_basket_substitution_exponent[basket]) * mu;
+    };
+    // set demand in basket for marginal utility of spending lambda, returns expenditure
+    const auto basket_expenditure = [&](int basket, FloatType lambda) {
+        const FloatType coefficient = intra_basket_substitution_coefficient[basket];
+        const FloatType exponent = intra_basket_substitution_exponent[basket];
+        FloatType mu_min = std::numeric_limits<FloatType>::infinity();  // all goods at their upper bounds for smaller mu
+        FloatType mu_max = 0.0;                                         // all goods at their lower bounds for larger mu
+        FloatType unbounded_sum = 0.0;
+        for (auto& index : consumer_basket_indizes[basket]) {
+            if (upper_bounds[index] > 0.0) {
+                const FloatType ratio = share_factors[index] / consumption_costs[index];
+                mu_min = std::min(mu_min, ratio / std::pow(upper_bounds[index], 1 / coefficient));
+                mu_max = std::max(mu_max, ratio / std::pow(lower_bounds[index], 1 / coefficient));
+                unbounded_sum += std::pow(share_factors[index], coefficient) * std::pow(consumption_costs[index], 1 - coefficient);
+            }
+        }
+        if (unbounded_sum > 0.0) {
+            // closed form if no bounds are binding
+            FloatType mu = std::pow(lambda
+                                        / (exponent_basket_share_factors[basket] * std::pow(basket_share_factors[basket], inter_exponent)
+                                           * std::pow(unbounded_sum, (inter_exponent - exponent) / exponent)),
+                                    inter_basket_substitution_coefficient / coefficient);
+            clamped = false;
+            basket_demand(basket, mu);
+            if (clamped) {
+                if (marginal_utility(basket, mu_min) >= lambda) {
+                    mu = mu_min;
+                } else if (marginal_utility(basket, mu_max) <= lambda) {
+                    mu = mu_max;
+                } else {
+                    FloatType lower = mu_min;
+                    FloatType upper = mu_max;
+                    for (int i = 0; i < MAX_BISECTION_STEPS && upper - lower > BISECTION_PRECISION * upper; ++i) {
+                        mu = std::sqrt(lower * upper);
+                        if (marginal_utility(basket, mu) < lambda) {
+                            lower = mu;
+                        } else {
+                            upper = mu;
+                        }
+                    }
+                    mu = upper;
+                }
+                basket_demand(basket, mu);
+            }
+        }
+        FloatType expenditure = 0.0;
+        for (auto& index : consumer_basket_indizes[basket]) {
+            expenditure += consumption_costs[index] * optimizer_consumption[index];
+        }
+        return expenditure;
+    };
+    const auto total_expenditure = [&](FloatType lambda) {
+        FloatType res = 0.0;
+        for (int basket = 0; basket < int(consumer_baskets.size()); ++basket) {
+            res += basket_expenditure(basket, lambda);
+        }
+        return res;
+    };
+
+    // without binding bounds, expenditure is proportional to lambda^(-s), which gives lambda in closed form
+    FloatType lambda = std::pow(total_expenditure(1.0) / budget, 1 / inter_basket_substitution_coefficient);
+    FloatType expenditure = total_expenditure(lambda);
+    if (std::abs(expenditure - budget) > 1e3 * BISECTION_PRECISION * budget) {
+        // bounds are binding, bracket lambda and bisect (expenditure is decreasing in lambda)
+        FloatType lower = lambda;
+        FloatType upper = lambda;
+        for (int i = 0; i < MAX_BISECTION_STEPS && total_expenditure(lower) < budget; ++i) {
+            lower /= 2;
+        }
+        for (int i = 0; i < MAX_BISECTION_STEPS && total_expenditure(upper) > budget; ++i) {
+            upper *= 2;
+        }
+        for (int i = 0; i < MAX_BISECTION_STEPS && upper - lower > BISECTION_PRECISION * upper; ++i) {
+            lambda = std::sqrt(lower * upper);
+            if (total_expenditure(lambda) > budget) {
+                lower = lambda;
+            } else {
+                upper = lambda;
+            }
+        }
+        expenditure = total_expenditure(upper);  // stay within budget
+    }
+    return std::isfinite(expenditure);
+}
+
+/**
+ * NLOpt based optimization of consumption with respect to utility function
+ * @param scaled_starting_value baseline-relative consumption to start optimization from
+ * @param lower_bounds lower bounds of baseline-relative consumption
+ * @param upper_bounds upper bounds of baseline-relative consumption
+ * @return optimized utility, consumption is stored in optimizer_consumption
+ */
+FloatType Consumer::nlopt_consumption_optimization(const std::vector<FloatType>& scaled_starting_value,
+                                                   const std::vector<FloatType>& lower_bounds,
+                                                   const std::vector<FloatType>& upper_bounds) {
+    // optimization parameters
+    std::vector<FloatType> xtol_abs(input_storages.size(), FlowQuantity::precision * model()->parameters().utility_optimization_precision_adjustment);
+    std::vector<FloatType> xtol_abs_global(input_storages.size(),
+                                           FlowQuantity::precision * model()->parameters().global_utility_optimization_precision_adjustment);
+
     optimizer_consumption = std::vector<double>(input_storages.size());  // use normalized variable for optimization to improve?! performance
+    budget_baseline_quantities.resize(input_storages.size());
+    budget_prices.resize(input_storages.size());
     // scale xtol_abs
     for (auto& input_storage : input_storages) {
         int index = input_storage->id.index();
+        budget_baseline_quantities[index] = to_float(baseline_consumption[index].get_quantity());
+        budget_prices[index] = model()->parameters().elastic_budget
+                                   ? std::pow(to_float(consumption_prices[index]), -1 * input_storage->parameters().consumption_price_elasticity)
+                                   : to_float(consumption_prices[index]);
         xtol_abs[index] = scale_double_to_double(xtol_abs[index], baseline_consumption[index].get_quantity());
         xtol_abs_global[index] = scale_double_to_double(xtol_abs_global[index], baseline_consumption[index].get_quantity());
         optimizer_consumption[index] = std::min(scaled_starting_value[index], upper_bounds[index]);
     }
     if constexpr (VERBOSE_CONSUMER) {
-        log::info(this, "upper bounds");
-        for (auto& input_storage : input_storages) {
-            log::info(input_storage->name(), "upper bound: ", upper_bounds[input_storage->id.index()]);
+        if (log::enabled(log::level_t::VERBOSE)) {
+            log::debug(this, "upper bounds");
+            for (auto& input_storage : input_storages) {
+                log::debug(input_storage->name(), "upper bound: ", upper_bounds[input_storage->id.index()]);
+            }
         }
     }
 
@@ -381,8 +596,14 @@ std::pair<std::vector<Flow>, FloatType> Consumer::utilitarian_consumption_optimi
     optimization::Optimization local_optimizer(static_cast<nlopt_algorithm>(model()->parameters().utility_optimization_algorithm),
                                                input_storages.size());  // TODO keep and only recreate when resize is needed
     local_optimizer.xtol(xtol_abs);
-    local_optimizer.maxeval(model()->parameters().utility_optimization_maxiter);
-    local_optimizer.maxtime(model()->parameters().utility_optimization_timeout);
+    // in deterministic mode only evaluation counts limit the optimization, so that results do not depend on machine load
+    const bool deterministic = model()->parameters().deterministic_optimization;
+    if (deterministic) {
+        local_optimizer.evaluation_budget(model()->parameters().optimization_evaluations_per_dimension * static_cast<int>(input_storages.size()));
+    } else {
+        local_optimizer.maxeval(model()->parameters().utility_optimization_maxiter);
+        local_optimizer.maxtime(model()->parameters().utility_optimization_timeout);
+    }
     if (model()->parameters().budget_inequality_constrained) {
         local_optimizer.add_inequality_constraint(this, FlowValue::precision);
     } else {
@@ -392,6 +613,15 @@ std::pair<std::vector<Flow>, FloatType> Consumer::utilitarian_consumption_optimi
     local_optimizer.lower_bounds(lower_bounds);
     local_optimizer.upper_bounds(upper_bounds);
 
+    const bool recording = !model()->parameters().purchasing_record_file.empty();
+    std::vector<double> start;
+    if (recording) {
+        start = optimizer_consumption;
+    }
+    objective_evaluations = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    FloatType optimized_value;
+
     if (model()->parameters().global_utility_optimization) {
         // define  lagrangian optimizer to pass (in)equality constraints to global algorithm which cannot use it directly:
         optimization::Optimization lagrangian_optimizer(static_cast<nlopt_algorithm>(model()->parameters().lagrangian_algorithm),
@@ -406,7 +636,7 @@ std::pair<std::vector<Flow>, FloatType> Consumer::utilitarian_consumption_optimi
         lagrangian_optimizer.upper_bounds(upper_bounds);
         lagrangian_optimizer.xtol(xtol_abs_global);
         lagrangian_optimizer.maxeval(model()->parameters().global_optimization_maxiter);
-        lagrangian_optimizer.maxtime(model()->parameters().optimization_timeout);
+        lagrangian_optimizer.maxtime(deterministic ? 0 : model()->parameters().optimization_timeout);
 
         // define global optimizer to use random sampling MLSL algorithm as global search, before local optimization via local_optimizer:
         optimization::Optimization global_optimizer(static_cast<nlopt_algorithm>(model()->parameters().global_utility_optimization_algorithm),
@@ -414,7 +644,7 @@ std::pair<std::vector<Flow>, FloatType> Consumer::utilitarian_consumption_optimi
 
         global_optimizer.xtol(xtol_abs_global);
         global_optimizer.maxeval(model()->parameters().global_utility_optimization_maxiter);
-        global_optimizer.maxtime(model()->parameters().global_utility_optimization_timeout);
+        global_optimizer.maxtime(deterministic ? 0 : model()->parameters().global_utility_optimization_timeout);
         global_optimizer.lower_bounds(lower_bounds);
         global_optimizer.upper_bounds(upper_bounds);
         global_optimizer.set_local_algorithm(local_optimizer.get_optimizer());
@@ -426,20 +656,69 @@ std::pair<std::vector<Flow>, FloatType> Consumer::utilitarian_consumption_optimi
                                                                                // dimension of the problem
         // start combined global local optimizer optimizer
         lagrangian_optimizer.set_local_algorithm(global_optimizer.get_optimizer());
+        if (deterministic) {
+            optimization::Optimization::seed(0);
+        }
         consumption_optimize(lagrangian_optimizer);
-        optimized_utility = lagrangian_optimizer.optimized_value();
+        optimized_value = lagrangian_optimizer.optimized_value();
     } else {
         consumption_optimize(local_optimizer);
-        optimized_utility = local_optimizer.optimized_value();
+        optimized_value = local_optimizer.optimized_value();
     }
-    std::vector<Flow> consumption;
-    consumption.reserve(input_storages.size());
-    for (auto& input_storage : input_storages) {
-        int index = input_storage->id.index();
-        consumption.emplace_back(invert_scaling_double_to_quantity(optimizer_consumption[index], baseline_consumption[index].get_quantity()),
-                                 consumption_prices[index]);
+    if (recording) {
+        record_problem(lower_bounds, upper_bounds, xtol_abs, std::move(start), optimized_value,
+                       std::chrono::duration<FloatType>(std::chrono::steady_clock::now() - t0).count());
     }
-    return std::pair<std::vector<Flow>, FloatType>(consumption, optimized_utility);
+    return optimized_value;
+}
+
+void Consumer::record_problem(const std::vector<FloatType>& lower_bounds,
+                              const std::vector<FloatType>& upper_bounds,
+                              const std::vector<FloatType>& xtol_abs,
+                              std::vector<double> start,
+                              FloatType optimized_value,
+                              FloatType seconds) {
+    const auto& parameters = model()->parameters();
+    const bool slow = parameters.purchasing_record_time > 0.0 && seconds >= parameters.purchasing_record_time;
+    const bool expensive = parameters.purchasing_record_evaluations > 0 && objective_evaluations >= static_cast<std::uint64_t>(parameters.purchasing_record_evaluations);
+    if (!slow && !expensive) {
+        return;
+    }
+    ConsumptionProblemRecord record;
+    record.name = name();
+    record.timestep = model()->timestep();
+    record.algorithm = parameters.utility_optimization_algorithm;
+    record.maxeval = parameters.deterministic_optimization ? parameters.optimization_evaluations_per_dimension * static_cast<int>(input_storages.size())
+                                                           : parameters.utility_optimization_maxiter;
+    record.deterministic = parameters.deterministic_optimization;
+    record.inequality_constrained = parameters.budget_inequality_constrained;
+    record.linear_budget_constraint = parameters.linear_budget_constraint;
+    record.global = parameters.global_utility_optimization;
+    record.budget = to_float(consumption_budget);
+    record.budget_share = (consumption_budget + not_spent_budget) / consumption_budget;
+    record.inter_basket_substitution_exponent = inter_basket_substitution_exponent;
+    record.evaluations = objective_evaluations;
+    record.seconds = seconds;
+    record.optimized_value = optimized_value;
+    record.intra_basket_substitution_exponent = intra_basket_substitution_exponent;
+    record.basket_share_factors = basket_share_factors;
+    record.exponent_basket_share_factors = exponent_basket_share_factors;
+    record.baskets.assign(input_storages.size(), ConsumptionProblemRecord::NO_BASKET);
+    for (std::size_t basket = 0; basket < consumer_basket_indizes.size(); ++basket) {
+        for (const auto index : consumer_basket_indizes[basket]) {
+            record.baskets[index] = basket;
+        }
+    }
+    record.share_factors = share_factors;
+    record.exponent_share_factors = exponent_share_factors;
+    record.baseline_quantities = budget_baseline_quantities;
+    record.prices = budget_prices;
+    record.lower_bounds = lower_bounds;
+    record.upper_bounds = upper_bounds;
+    record.xtol_abs = xtol_abs;
+    record.start = std::move(start);
+    record.solution = optimizer_consumption;
+    model()->record_consumption_problem(record);
 }
 
 /**
@@ -449,22 +728,26 @@ std::pair<std::vector<Flow>, FloatType> Consumer::utilitarian_consumption_optimi
 void Consumer::consumption_optimize(optimization::Optimization& optimizer) {
     try {
         if constexpr (VERBOSE_CONSUMER) {
-            log::info(this, " distribution before optimization");
-            for (auto& input_storage : input_storages) {
-                log::info(input_storage->name(), " target consumption: ", optimizer_consumption[input_storage->id.index()]);
-                log::info(input_storage->name(), " rounded target consumption: ",
-                          invert_scaling_double_to_double(optimizer_consumption[input_storage->id.index()],
-                                                          baseline_consumption[input_storage->id.index()].get_quantity()));
+            if (log::enabled(log::level_t::VERBOSE)) {
+                log::debug(this, " distribution before optimization");
+                for (auto& input_storage : input_storages) {
+                    log::debug(input_storage->name(), " target consumption: ", optimizer_consumption[input_storage->id.index()]);
+                    log::debug(input_storage->name(), " rounded target consumption: ",
+                               invert_scaling_double_to_double(optimizer_consumption[input_storage->id.index()],
+                                                               baseline_consumption[input_storage->id.index()].get_quantity()));
+                }
             }
         }
         const auto res = optimizer.optimize(optimizer_consumption);
         if constexpr (VERBOSE_CONSUMER) {
-            log::info(this, " distribution after optimization");
-            for (auto& input_storage : input_storages) {
-                log::info(input_storage->name(), " optimized consumption: ", optimizer_consumption[input_storage->id.index()]);
-                log::info(input_storage->name(), " rounded optimized consumption: ",
-                          invert_scaling_double_to_double(optimizer_consumption[input_storage->id.index()],
-                                                          baseline_consumption[input_storage->id.index()].get_quantity()));
+            if (log::enabled(log::level_t::VERBOSE)) {
+                log::debug(this, " distribution after optimization");
+                for (auto& input_storage : input_storages) {
+                    log::debug(input_storage->name(), " optimized consumption: ", optimizer_consumption[input_storage->id.index()]);
+                    log::debug(input_storage->name(), " rounded optimized consumption: ",
+                               invert_scaling_double_to_double(optimizer_consumption[input_storage->id.index()],
+                                                               baseline_consumption[input_storage->id.index()].get_quantity()));
+                }
             }
         }
 
@@ -557,39 +840,37 @@ void Consumer::debug_print_details() const {
 }
 
 template<typename T1, typename T2>
-static void print_row(T1 a, T2 b) {
-    std::cout << "      " << std::setw(24) << a << " = " << std::setw(14) << b << '\n';
+static void print_row(std::ostream& os, T1 a, T2 b) {
+    os << "      " << std::setw(24) << a << " = " << std::setw(14) << b << '\n';
 }
 
 void Consumer::debug_print_distribution() {
     if constexpr (options::DEBUGGING) {
-#pragma omp critical(output)
-        {
-            std::vector<double> grad_constraint(input_storages.size());
-            std::vector<double> grad_objective(input_storages.size());
-
-            std::cout << model()->run()->timeinfo() << ", " << name() << ": demand distribution for " << input_storages.size() << " inputs :\n";
-            print_row("inequality value", inequality_constraint(&optimizer_consumption[0], &grad_constraint[0]));
-            print_row("objective value", max_objective(&optimizer_consumption[0], &grad_objective[0]));
-            print_row("current utility", utility);
-            print_row("current total budget", consumption_budget);
-            print_row("substitution coefficient", inter_basket_substitution_coefficient);
-            std::cout << '\n';
+        std::vector<double> grad_constraint(input_storages.size());
+        std::vector<double> grad_objective(input_storages.size());
 
-            for (auto& input_storage : input_storages) {
-                int r = input_storage->id.index();
-                std::cout << "    " << input_storage->name() << " :\n";
-                print_row("grad (constraint)", grad_constraint[r]);
-                print_row("grad (objective)", grad_objective[r]);
-                print_row("share factor", share_factors[r]);
-                print_row("consumption quantity", invert_scaling_double_to_quantity(optimizer_consumption[r], baseline_consumption[r].get_quantity()));
-                print_row("share of start cons. qty(%)", optimizer_consumption[r]);
-                print_row("consumption price", consumption_prices[r]);
-                print_row("consumption value",
-                          invert_scaling_double_to_quantity(optimizer_consumption[r], baseline_consumption[r].get_quantity()) * consumption_prices[r]);
-                std::cout << '\n';
-            }
+        std::ostringstream ss;
+        print_row(ss, "inequality value", inequality_constraint(&optimizer_consumption[0], &grad_constraint[0]));
+        print_row(ss, "objective value", max_objective(&optimizer_consumption[0], &grad_objective[0]));
+        print_row(ss, "current utility", utility);
+        print_row(ss, "current total budget", consumption_budget);
+        print_row(ss, "substitution coefficient", inter_basket_substitution_coefficient);
+        ss << '\n';
+
+        for (auto& input_storage : input_storages) {
+            int r = input_storage->id.index();
+            ss << "    " << input_storage->name() << " :\n";
+            print_row(ss, "grad (constraint)", grad_constraint[r]);
+            print_row(ss, "grad (objective)", grad_objective[r]);
+            print_row(ss, "share factor", share_factors[r]);
+            print_row(ss, "consumption quantity", invert_scaling_double_to_quantity(optimizer_consumption[r], baseline_consumption[r].get_quantity()));
+            print_row(ss, "share of start cons. qty(%)", optimizer_consumption[r]);
+            print_row(ss, "consumption price", consumption_prices[r]);
+            print_row(ss, "consumption value",
+                      invert_scaling_double_to_quantity(optimizer_consumption[r], baseline_consumption[r].get_quantity()) * consumption_prices[r]);
+            ss << '\n';
         }
+        log::print(this, "demand distribution for ", input_storages.size(), " inputs :\n", ss.str());
     }
 }
 
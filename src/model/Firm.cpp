@@ -39,7 +39,32 @@ Firm::Firm(id_t id_p, Sector* sector_p, Region* region_p, const Ratio& possible_
       capacity_manager(new CapacityManager(this, possible_overcapacity_ratio_beta_p)),
       sales_manager(new SalesManager(this)) {}
 
-void Firm::initialize() { sales_manager->initialize(); }
+void Firm::initialize() {
+    step_intermediates_.valid = false;
+    sales_manager->initialize();
+}
+
+void Firm::set_forcing(const Forcing& forcing_p) {
+    EconomicAgent::set_forcing(forcing_p);
+    step_intermediates_.valid = false;
+}
+
+void Firm::update_step_intermediates() {
+    debug::assertstep(this, IterationStep::CONSUMPTION_AND_PRODUCTION);
+    if (step_intermediates_.valid) {
+        return;
+    }
+    step_intermediates_.forced_initial_production_quantity_lambda_X_star = round(initial_production_X_star_.get_quantity() * forcing_m);
+    step_intermediates_.forced_initial_production_quantity_lambda_X_star_float = to_float(initial_production_X_star_.get_quantity() * forcing_m);
+    step_intermediates_.forced_maximal_production_quantity_lambda_beta_X_star =
+        round(initial_production_X_star_.get_quantity() * (capacity_manager->possible_overcapacity_ratio_beta * forcing_m));
+    step_intermediates_.initial_unit_variable_production_costs = sales_manager->get_initial_unit_variable_production_costs();
+    step_intermediates_.technology_coefficients_a.resize(input_storages.size());
+    for (const auto& is : input_storages) {
+        step_intermediates_.technology_coefficients_a[is->id.index()] = is->get_technology_coefficient_a();
+    }
+    step_intermediates_.valid = true;
+}
 
 void Firm::produce_X() {
     debug::assertstep(this, IterationStep::CONSUMPTION_AND_PRODUCTION);
@@ -50,9 +75,10 @@ void Firm::produce_X() {
 
 void Firm::iterate_consumption_and_production() {
     debug::assertstep(this, IterationStep::CONSUMPTION_AND_PRODUCTION);
+    update_step_intermediates();
     produce_X();
     for (const auto& is : input_storages) {
-        Flow used_flow_U_current = round(production_X_ * is->get_technology_coefficient_a());
+        Flow used_flow_U_current = round(production_X_ * technology_coefficient_a(is.get()));
         if (production_X_.get_quantity() > 0.0) {
             used_flow_U_current.set_price(is->get_possible_use_U_hat().get_price());
         }
@@ -65,16 +91,17 @@ void Firm::iterate_consumption_and_production() {
 void Firm::iterate_expectation() {
     debug::assertstep(this, IterationStep::EXPECTATION);
     sales_manager->iterate_expectation();
+    const FlowQuantity desired_production =
+        std::max(sales_manager->communicated_parameters().expected_production_X.get_quantity(), sales_manager->sum_demand_requests_D().get_quantity());
     for (const auto& is : input_storages) {
-        const FlowQuantity& desired_production =
-            std::max(sales_manager->communicated_parameters().expected_production_X.get_quantity(), sales_manager->sum_demand_requests_D().get_quantity());
-        is->set_desired_used_flow_U_tilde(round(desired_production * is->get_technology_coefficient_a()));
+        is->set_desired_used_flow_U_tilde(round(desired_production * technology_coefficient_a(is.get())));
     }
 }
 
 void Firm::add_initial_production_X_star(const Flow& initial_production_flow_X_star) {
     debug::assertstep(this, IterationStep::INITIALIZATION);
     initial_production_X_star_ += initial_production_flow_X_star;
+    step_intermediates_.valid = false;
     production_X_ += initial_production_flow_X_star;
     sales_manager->add_initial_demand_request_D_star(initial_production_flow_X_star);
     sector->add_initial_production_X(initial_production_flow_X_star);
@@ -83,6 +110,7 @@ void Firm::add_initial_production_X_star(const Flow& initial_production_flow_X_s
 void Firm::subtract_initial_production_X_star(const Flow& initial_production_flow_X_star) {
     debug::assertstep(this, IterationStep::INITIALIZATION);
     initial_production_X_star_ -= initial_production_flow_X_star;
+    step_intermediates_.valid = false;
     production_X_ -= initial_production_flow_X_star;
     sales_manager->subtract_initial_demand_request_D_star(initial_production_flow_X_star);
     sector->subtract_initial_production_X(initial_production_flow_X_star);
@@ -91,10 +119,12 @@ void Firm::subtract_initial_production_X_star(const Flow& initial_production_flo
 void Firm::add_initial_total_use_U_star(const Flow& initial_use_flow_U_star) {
     debug::assertstep(this, IterationStep::INITIALIZATION);
     initial_total_use_U_star_ += initial_use_flow_U_star;
+    step_intermediates_.valid = false;
 }
 
 void Firm::subtract_initial_total_use_U_star(const Flow& initial_use_flow_U_star) {
     debug::assertstep(this, IterationStep::INITIALIZATION);
+    step_intermediates_.valid = false;
     if (initial_total_use_U_star_.get_quantity() > initial_use_flow_U_star.get_quantity()) {
         initial_total_use_U_star_ -= initial_use_flow_U_star;
     } else {
@@ -119,9 +149,26 @@ void Firm::iterate_investment() {
 Flow Firm::maximal_production_beta_X_star() const { return round(initial_production_X_star_ * capacity_manager->possible_overcapacity_ratio_beta); }
 
 FlowQuantity Firm::forced_maximal_production_quantity_lambda_beta_X_star() const {
+    if (step_intermediates_.valid) {
+        return step_intermediates_.forced_maximal_production_quantity_lambda_beta_X_star;
+    }
     return round(initial_production_X_star_.get_quantity() * (capacity_manager->possible_overcapacity_ratio_beta * forcing_m));
 }
 
+Ratio Firm::technology_coefficient_a(const Storage* input_storage) const {
+    if (step_intermediates_.valid) {
+        return step_intermediates_.technology_coefficients_a[input_storage->id.index()];
+    }
+    return input_storage->get_technology_coefficient_a();
+}
+
+Price Firm::initial_unit_variable_production_costs() const {
+    if (step_intermediates_.valid) {
+        return step_intermediates_.initial_unit_variable_production_costs;
+    }
+    return sales_manager->get_initial_unit_variable_production_costs();
+}
+
 const BusinessConnection* Firm::self_supply_connection() const {
     debug::assertstepnot(this, IterationStep::CONSUMPTION_AND_PRODUCTION);
     return self_supply_connection_.get();
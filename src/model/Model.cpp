@@ -22,15 +22,19 @@
 
 #include <algorithm>
 #include <chrono>
+#include <fstream>
 #include <iterator>
+#include <map>
 #include <memory>
 #include <random>
+#include <vector>
 
 #include "ModelRun.h"
 #include "acclimate.h"
 #include "model/EconomicAgent.h"
 #include "model/GeoLocation.h"
 #include "model/PurchasingManager.h"
+#include "model/PurchasingProblemRecord.h"
 #include "model/Region.h"
 #include "model/Sector.h"
 #include "model/Storage.h"  // IWYU pragma: keep
@@ -55,6 +59,23 @@ void Model::start() {
         std::shuffle(std::begin(parallelized_storages), std::end(parallelized_storages), g);
         std::shuffle(std::begin(parallelized_agents), std::end(parallelized_agents), g);
     }
+    if (!parameters_m.purchasing_record_file.empty()) {
+        purchasing_record_stream = std::make_unique<std::ofstream>(parameters_m.purchasing_record_file, std::ios::binary | std::ios::trunc);
+        if (!*purchasing_record_stream) {
+            throw log::error(this, "Could not open ", parameters_m.purchasing_record_file);
+        }
+        PurchasingProblemRecord::write_header(*purchasing_record_stream);
+    }
+}
+
+void Model::record_purchasing_problem(const PurchasingProblemRecord& record) {
+#pragma omp critical(purchasing_record)
+    { record.write(*purchasing_record_stream); }
+}
+
+void Model::record_consumption_problem(const ConsumptionProblemRecord& record) {
+#pragma omp critical(purchasing_record)
+    { record.write(*purchasing_record_stream); }
 }
 
 void Model::iterate_consumption_and_production() {
@@ -102,6 +123,10 @@ void Model::iterate_purchase() {
     for (std::size_t i = 0; i < regions.size(); ++i) {  // NOLINT(modernize-loop-convert)
         regions[i]->iterate_purchase();
     }
+    if (parameters_m.batched_purchasing) {
+        iterate_purchase_batched();
+        return;
+    }
 #pragma omp parallel for default(shared) schedule(guided)
     for (std::size_t i = 0; i < parallelized_storages.size(); ++i) {  // NOLINT(modernize-loop-convert)
         auto t1 = std::chrono::high_resolution_clock::now();
@@ -116,6 +141,57 @@ void Model::iterate_purchase() {
     }
 }
 
+void Model::iterate_purchase_batched() {
+    static constexpr std::size_t BATCH_SIZE = 64;  // problems solved together per thread
+    // timings are kept per storage as in iterate_purchase, batched problems get an equal share of their batch's time
+    std::vector<PurchasingManager::purchase_phase_t> phases(parallelized_storages.size());
+#pragma omp parallel for default(shared) schedule(guided)
+    for (std::size_t i = 0; i < parallelized_storages.size(); ++i) {
+        auto t1 = std::chrono::high_resolution_clock::now();
+        phases[i] = parallelized_storages[i].first->prepare_purchase();
+        auto t2 = std::chrono::high_resolution_clock::now();
+        parallelized_storages[i].second = (t2 - t1).count();
+    }
+    std::map<std::size_t, std::vector<std::size_t>> problems_by_dimension;  // indices in parallelized_storages
+    for (std::size_t i = 0; i < parallelized_storages.size(); ++i) {
+        if (phases[i] == PurchasingManager::purchase_phase_t::OPTIMIZE) {
+            problems_by_dimension[parallelized_storages[i].first->optimization_dimension()].push_back(i);
+        }
+    }
+    std::vector<std::vector<std::size_t>> batches;
+    for (const auto& problems : problems_by_dimension) {
+        for (auto it = std::begin(problems.second); it != std::end(problems.second);) {
+            const auto end = std::next(it, std::min<std::ptrdiff_t>(BATCH_SIZE, std::distance(it, std::end(problems.second))));
+            batches.emplace_back(it, end);
+            it = end;
+        }
+    }
+#pragma omp parallel for default(shared) schedule(dynamic)
+    for (std::size_t i = 0; i < batches.size(); ++i) {  // NOLINT(modernize-loop-convert)
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::vector<PurchasingManager*> batch(batches[i].size());
+        std::transform(std::begin(batches[i]), std::end(batches[i]), std::begin(batch), [this](std::size_t j) { return parallelized_storages[j].first; });
+        PurchasingManager::optimize_purchase_batch(batch);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        for (const auto j : batches[i]) {
+            parallelized_storages[j].second += (t2 - t1).count() / batches[i].size();
+        }
+    }
+#pragma omp parallel for default(shared) schedule(guided)
+    for (std::size_t i = 0; i < parallelized_storages.size(); ++i) {
+        if (phases[i] != PurchasingManager::purchase_phase_t::DONE) {
+            auto t1 = std::chrono::high_resolution_clock::now();
+            parallelized_storages[i].first->distribute_purchase();
+            auto t2 = std::chrono::high_resolution_clock::now();
+            parallelized_storages[i].second += (t2 - t1).count();
+        }
+    }
+    if constexpr (options::PARALLELIZATION) {
+        std::sort(std::begin(parallelized_storages), std::end(parallelized_storages),
+                  [](const std::pair<PurchasingManager*, std::size_t>& a, const std::pair<PurchasingManager*, std::size_t>& b) { return b.second > a.second; });
+    }
+}
+
 void Model::iterate_investment() {
     debug::assertstep(this, IterationStep::INVESTMENT);
 #pragma omp parallel for default(shared) schedule(guided)
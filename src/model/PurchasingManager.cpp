@@ -21,12 +21,14 @@
 #include "model/PurchasingManager.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <iomanip>
-#include <iostream>
 #include <iterator>
+#include <limits>
 #include <numeric>
+#include <sstream>
 #include <utility>
 
 #include "ModelRun.h"
@@ -35,9 +37,11 @@
 #include "model/EconomicAgent.h"
 #include "model/Firm.h"
 #include "model/Model.h"
+#include "model/PurchasingProblemRecord.h"
 #include "model/SalesManager.h"
 #include "model/Sector.h"
 #include "model/Storage.h"
+#include "openmp.h"
 #include "optimization.h"
 #include "parameters.h"
 
@@ -57,6 +61,7 @@ bool PurchasingManager::remove_business_connection(const BusinessConnection* bus
         throw log::error(this, "Business connection ", business_connection->name(), " not found");
     }
     business_connections.erase(it);
+    memo.connections.clear();
     if (business_connections.empty()) {
         storage->economic_agent->input_storages.remove(storage);
         return true;
@@ -115,7 +120,7 @@ const Demand& PurchasingManager::demand_D(const EconomicAgent* caller) const {
 const Model* PurchasingManager::model() const { return storage->model(); }
 Model* PurchasingManager::model() { return storage->model(); }
 
-std::string PurchasingManager::name() const { return storage->sector->name() + "->" + storage->economic_agent->name(); }
+const std::string& PurchasingManager::name() const { return storage->name(); }
 
 FloatType PurchasingManager::optimized_value() const {
     debug::assertstepnot(this, IterationStep::PURCHASE);
@@ -137,48 +142,53 @@ const FlowValue& PurchasingManager::total_transport_penalty() const {
     return total_transport_penalty_;
 }
 
-const FlowValue& PurchasingManager::expected_costs(const EconomicAgent* caller) const {
-    if constexpr (options::DEBUGGING) {
-        if (caller != storage->economic_agent) {
-            debug::assertstepnot(this, IterationStep::PURCHASE);
-        }
-    }
-    return expected_costs_;
+std::size_t PurchasingManager::pruned_connections_count() const {
+    debug::assertstepnot(this, IterationStep::PURCHASE);
+    return pruned_connections.size();
 }
 
-FloatType PurchasingManager::estimate_production_extension_penalty(const BusinessConnection* bc, FloatType production_quantity_X) const {
-    assert(production_quantity_X >= 0.0);
-    if (production_quantity_X <= bc->seller->firm->forced_initial_production_quantity_lambda_X_star_float()) {  // not in production extension
-        return 0.0;
-    }
-    // in production extension
-    return std::max(0.0, to_float(bc->seller->firm->sector->parameters().estimated_price_increase_production_extension)
-                             / (2 * bc->seller->firm->forced_initial_production_quantity_lambda_X_star_float())
-                             * (production_quantity_X - bc->seller->firm->forced_initial_production_quantity_lambda_X_star_float())
-                             * (production_quantity_X - bc->seller->firm->forced_initial_production_quantity_lambda_X_star_float()));
+const FlowValue& PurchasingManager::pruning_error() const {
+    debug::assertstepnot(this, IterationStep::PURCHASE);
+    return pruning_error_;
 }
 
-FloatType PurchasingManager::estimate_marginal_production_costs(const BusinessConnection* bc,
-                                                                FloatType production_quantity_X,
-                                                                FloatType unit_production_costs_n_c) const {
-    assert(production_quantity_X >= 0.0);
-    assert(!std::isnan(unit_production_costs_n_c));
-    if (production_quantity_X <= bc->seller->firm->forced_initial_production_quantity_lambda_X_star_float()) {  // not in production extension
-        return unit_production_costs_n_c;
-    }
-    // in production extension
-    return unit_production_costs_n_c + estimate_marginal_production_extension_penalty(bc, production_quantity_X);
+std::size_t PurchasingManager::reused_solution() const {
+    debug::assertstepnot(this, IterationStep::PURCHASE);
+    return last_solution_ == solution_t::REUSED ? 1 : 0;
+}
+
+std::size_t PurchasingManager::warm_started_solution() const {
+    debug::assertstepnot(this, IterationStep::PURCHASE);
+    return last_solution_ == solution_t::WARM_STARTED ? 1 : 0;
+}
+
+std::size_t PurchasingManager::approximated_solution() const {
+    debug::assertstepnot(this, IterationStep::PURCHASE);
+    return last_solution_ == solution_t::APPROXIMATED ? 1 : 0;
+}
+
+std::size_t PurchasingManager::rejected_approximation() const {
+    debug::assertstepnot(this, IterationStep::PURCHASE);
+    return approximation_rejected_ ? 1 : 0;
+}
+
+FloatType PurchasingManager::kkt_residual() const {
+    debug::assertstepnot(this, IterationStep::PURCHASE);
+    return kkt_residual_;
 }
 
-FloatType PurchasingManager::estimate_marginal_production_extension_penalty(const BusinessConnection* bc, FloatType production_quantity_X) const {
-    assert(production_quantity_X >= 0.0);
-    if (production_quantity_X <= bc->seller->firm->forced_initial_production_quantity_lambda_X_star_float()) {  // not in production extension
-        return 0.0;
+FloatType PurchasingManager::batched_deviation() const {
+    debug::assertstepnot(this, IterationStep::PURCHASE);
+    return batched_deviation_;
+}
+
+const FlowValue& PurchasingManager::expected_costs(const EconomicAgent* caller) const {
+    if constexpr (options::DEBUGGING) {
+        if (caller != storage->economic_agent) {
+            debug::assertstepnot(this, IterationStep::PURCHASE);
+        }
     }
-    // in production extension
-    return to_float(bc->seller->firm->sector->parameters().estimated_price_increase_production_extension)
-           / bc->seller->firm->forced_initial_production_quantity_lambda_X_star_float()
-           * (production_quantity_X - bc->seller->firm->forced_initial_production_quantity_lambda_X_star_float());
+    return expected_costs_;
 }
 
 inline FloatType PurchasingManager::scaled_D_r(FloatType D_r, const BusinessConnection* bc) const { return D_r / partial_D_r_scaled_D_r(bc); }
@@ -191,13 +201,13 @@ inline FloatType PurchasingManager::scaled_objective(FloatType obj) const { retu
 
 inline FloatType PurchasingManager::unscaled_objective(FloatType x) const { return x * partial_objective_scaled_objective(); }
 
-inline FloatType PurchasingManager::partial_objective_scaled_objective() const { return to_float(storage->initial_used_flow_U_star().get_quantity()); }
+inline FloatType PurchasingManager::partial_objective_scaled_objective() const { return invariant_parameters.initial_used_flow_U_star; }
 
 inline FloatType PurchasingManager::scaled_use(FloatType use) const { return use / partial_use_scaled_use(); }
 
 inline FloatType PurchasingManager::unscaled_use(FloatType x) const { return x * partial_use_scaled_use(); }
 
-inline FloatType PurchasingManager::partial_use_scaled_use() const { return to_float(storage->initial_used_flow_U_star().get_quantity()); }
+inline FloatType PurchasingManager::partial_use_scaled_use() const { return invariant_parameters.initial_used_flow_U_star; }
 
 FloatType PurchasingManager::equality_constraint(const double* x, double* grad) const {
     FloatType use = 0.0;
@@ -218,17 +228,14 @@ FloatType PurchasingManager::equality_constraint(const double* x, double* grad)
 }
 
 FloatType PurchasingManager::max_objective(const double* x, double* grad) const {
-    FloatType costs = 0.0;
-    FloatType purchase = 0.0;
-    for (std::size_t r = 0; r < purchasing_connections.size(); ++r) {
+    ++objective_evaluations;
+    connection_costs.resize(purchasing_connections.size());
+    openmp::for_each_index(0, purchasing_connections.size(), parallel_objective, [&](std::size_t r) {
         const auto D_r = unscaled_D_r(x[r], purchasing_connections[r]);
         assert(!std::isnan(D_r));
-        costs += n_r(D_r, purchasing_connections[r]) * D_r + transport_penalty(D_r, purchasing_connections[r]);
-        purchase += D_r;
+        connection_costs[r] = n_r(D_r, suppliers[r]) * D_r + transport_penalty(D_r, suppliers[r]);
         if (grad != nullptr) {
-            grad[r] = -partial_D_r_scaled_D_r(purchasing_connections[r])
-                      * (grad_n_r(D_r, purchasing_connections[r]) * D_r + n_r(D_r, purchasing_connections[r])
-                         + partial_D_r_transport_penalty(D_r, purchasing_connections[r]))
+            grad[r] = -partial_D_r_scaled_D_r(purchasing_connections[r]) * marginal_costs_m_r(D_r, suppliers[r])
                       / partial_objective_scaled_objective();
             if constexpr (options::OPTIMIZATION_WARNINGS) {
                 if (grad[r] > MAX_GRADIENT) {
@@ -236,236 +243,199 @@ FloatType PurchasingManager::max_objective(const double* x, double* grad) const
                 }
             }
         }
-    }
+    });
+    // summing up in fixed order keeps the objective independent of the thread count for a given problem
+    const auto costs = std::accumulate(std::begin(connection_costs), std::end(connection_costs), FloatType(0.0));
     return scaled_objective(-costs);
 }
 
-FloatType PurchasingManager::expected_average_price_E_n_r(FloatType D_r, const BusinessConnection* business_connection) const {
-    const auto X_expected = expected_production(business_connection);
-    auto X_new = D_r + expected_additional_production(business_connection);
-    assert(round(FlowQuantity(X_new)) <= business_connection->seller->communicated_parameters().possible_production_X_hat.get_quantity());
-    if (X_new > to_float(business_connection->seller->communicated_parameters().possible_production_X_hat.get_quantity())) {
-        if constexpr (options::OPTIMIZATION_WARNINGS) {
-            log::warning(this, "X_new > X_hat: X_new = ", FlowQuantity(X_new),
-                         " X_hat = ", business_connection->seller->communicated_parameters().possible_production_X_hat.get_quantity());
-        }
-        X_new = to_float(business_connection->seller->communicated_parameters().possible_production_X_hat.get_quantity());
-    }
-
-    FloatType new_price_demand_request = 0.0;
-    if (X_expected <= 0.0 && X_new <= 0.0) {  // no production in last timestep
-        new_price_demand_request = to_float(business_connection->seller->communicated_parameters().offer_price_n_bar);
-    } else if (X_expected <= 0.0 && X_new > 0.0) {
-        new_price_demand_request = to_float(business_connection->seller->communicated_parameters().offer_price_n_bar)
-                                   + estimate_production_extension_penalty(business_connection, X_new) / X_new;
-    } else if (X_expected > 0.0 && X_new <= 0.0) {
-        assert(estimate_production_extension_penalty(business_connection, X_expected) / X_expected
-               < to_float(business_connection->seller->communicated_parameters().offer_price_n_bar));
-        new_price_demand_request = to_float(business_connection->seller->communicated_parameters().offer_price_n_bar)
-                                   - estimate_production_extension_penalty(business_connection, X_expected) / X_expected;
-        assert(new_price_demand_request > 0.0);
-    } else {  // regular case
-        new_price_demand_request = to_float(business_connection->seller->communicated_parameters().offer_price_n_bar)
-                                   - estimate_production_extension_penalty(business_connection, X_expected) / X_expected
-                                   + estimate_production_extension_penalty(business_connection, X_new) / X_new;
-    }
-    assert(!std::isnan(new_price_demand_request));
-    assert(new_price_demand_request > 0.0);
-    return new_price_demand_request;
-}
-
-FloatType PurchasingManager::n_r(FloatType D_r, const BusinessConnection* business_connection) const {
-    assert(D_r >= 0.0);
-    const auto n_bar = to_float(business_connection->seller->communicated_parameters().offer_price_n_bar);
-    const auto X_expected = expected_production(business_connection);
-    const auto additional_X_expected = expected_additional_production(business_connection);
-    const auto E_n_r = expected_average_price_E_n_r(D_r, business_connection);
-    const auto D_r_min = std::max(0.0, business_connection->seller->firm->forced_initial_production_quantity_lambda_X_star_float() - additional_X_expected);
-    const auto X_new_min = D_r_min + additional_X_expected;
-    assert(X_new_min > 0.0);
-    const auto npe_at_X_expected = (X_expected > 0.0) ? estimate_production_extension_penalty(business_connection, X_expected) / X_expected : 0.0;
-    const auto npe_at_X_new_min = (X_new_min > 0.0) ? estimate_production_extension_penalty(business_connection, X_new_min) / X_new_min : 0.0;
-    const auto n_bar_min = n_bar - npe_at_X_expected + npe_at_X_new_min;
-    const auto n_co = calc_n_co(n_bar_min, D_r_min, business_connection);
-    if (n_co <= n_bar_min) {  // in linear regime of E_n(D) curve
-        if (D_r < D_r_min) {  // note: D_r_min == 0 cannot occur
-            assert(D_r_min > 0.0);
-            return n_co + (n_bar_min - n_co) / D_r_min * D_r;
-        }
-        // in production extension of E_n(D) curve
-        return E_n_r;
-    }
-    // E_n(D) curved cropped from below with n_co
-    if (E_n_r <= n_co) {
-        return n_co;
-    }
-    return E_n_r;
-}
-
-FloatType PurchasingManager::grad_expected_average_price_E_n_r(FloatType D_r, const BusinessConnection* business_connection) const {
-    auto X_new = D_r + expected_additional_production(business_connection);
-    assert(round(FlowQuantity(X_new)) <= business_connection->seller->communicated_parameters().possible_production_X_hat.get_quantity());
-    if (X_new > to_float(business_connection->seller->communicated_parameters().possible_production_X_hat.get_quantity())) {
-        if constexpr (options::OPTIMIZATION_WARNINGS) {
-            log::warning(this, "X_new > X_hat: X_new = ", FlowQuantity(X_new),
-                         " X_hat = ", business_connection->seller->communicated_parameters().possible_production_X_hat.get_quantity());
-        }
-        X_new = to_float(business_connection->seller->communicated_parameters().possible_production_X_hat.get_quantity());
-    }
-    if (X_new <= 0.0) {
-        return 0.0;
+purchasing::Supplier PurchasingManager::supplier(const BusinessConnection* bc) const {
+    const auto& seller_parameters = bc->seller->communicated_parameters();
+    purchasing::Supplier s;
+    s.offer_price_n_bar = to_float(seller_parameters.offer_price_n_bar);
+    s.production_X = to_float(seller_parameters.production_X.get_quantity());
+    s.expected_production_X = to_float(seller_parameters.expected_production_X.get_quantity());
+    if constexpr (options::USE_MIN_PASSAGE_IN_EXPECTATION) {
+        s.expected_production_X *= bc->get_minimum_passage();
     }
-    // regular case
-    return estimate_marginal_production_extension_penalty(business_connection, X_new) / X_new
-           - estimate_production_extension_penalty(business_connection, X_new) / X_new / X_new;
+    s.possible_production_X_hat = to_float(seller_parameters.possible_production_X_hat.get_quantity());
+    s.unit_production_costs_n_c = seller_parameters.possible_production_X_hat.get_price_float();
+    s.last_shipment_Z = to_float(bc->last_shipment_Z().get_quantity());
+    s.forced_initial_production_lambda_X_star = bc->seller->firm->forced_initial_production_quantity_lambda_X_star_float();
+    s.estimated_price_increase_production_extension = to_float(bc->seller->firm->sector->parameters().estimated_price_increase_production_extension);
+    s.initial_flow_Z_star = to_float(bc->initial_flow_Z_star().get_quantity());
+    s.transport_penalty_target =
+        invariant_parameters.deviation_penalty ? to_float(bc->last_demand_request_D(this).get_quantity()) : s.initial_flow_Z_star;
+    return s;
 }
 
-FloatType PurchasingManager::calc_n_co(FloatType n_bar_min, FloatType D_r_min, const BusinessConnection* business_connection) const {
-    const auto n_co =
-        estimate_marginal_production_costs(business_connection, to_float(business_connection->seller->communicated_parameters().production_X.get_quantity()),
-                                           business_connection->seller->communicated_parameters().possible_production_X_hat.get_price_float());
-    if (model()->parameters().maximal_decrease_reservation_price_limited_by_markup) {
-        const auto n_crit = n_bar_min - to_float(storage->sector->parameters().initial_markup) * D_r_min;
-        return std::max(n_co, n_crit);
-    }
-    return n_co;
+FloatType PurchasingManager::n_r(FloatType D_r, const purchasing::PreparedSupplier& s) const {
+    return purchasing::n_r(D_r, s, invariant_parameters);
 }
 
-inline FloatType PurchasingManager::expected_production(const BusinessConnection* business_connection) {
-    const auto X_expected = to_float(business_connection->seller->communicated_parameters().expected_production_X.get_quantity());
-    if constexpr (options::USE_MIN_PASSAGE_IN_EXPECTATION) {
-        return business_connection->get_minimum_passage() * X_expected;
-    } else {
-        return X_expected;
-    }
-}
-
-inline FloatType PurchasingManager::expected_additional_production(const BusinessConnection* business_connection) {
-    const auto X = to_float(business_connection->seller->communicated_parameters().production_X.get_quantity());
-    const auto X_expected = expected_production(business_connection);
-    const auto Z_last = to_float(business_connection->last_shipment_Z().get_quantity());
-    const Ratio ratio_X_expected_to_X = (X > 0.0) ? X_expected / X : 0.0;
-    return ratio_X_expected_to_X * (X - Z_last);
-}
-
-FloatType PurchasingManager::grad_n_r(FloatType D_r, const BusinessConnection* business_connection) const {
-    const auto n_bar = to_float(business_connection->seller->communicated_parameters().offer_price_n_bar);
-    const auto X_expected = expected_production(business_connection);
-    const auto additional_X_expected = expected_additional_production(business_connection);
-    const auto grad_E_n_r = grad_expected_average_price_E_n_r(D_r, business_connection);
-    const auto E_n_r = expected_average_price_E_n_r(D_r, business_connection);
-    const auto D_r_min = std::max(0.0,
-                                  business_connection->seller->firm->forced_initial_production_quantity_lambda_X_star_float()
-                                      - additional_X_expected);  // note: D_r_star is the demand request for X_new=lambda * X_star
-    assert(D_r_min >= 0.0);
-    const auto X_new_min = D_r_min + additional_X_expected;
-    assert(X_new_min > 0.0);
-    const auto npe_at_X_expected = (X_expected > 0.0) ? estimate_production_extension_penalty(business_connection, X_expected) / X_expected : 0.0;
-    const auto npe_at_X_new_min = (X_new_min > 0.0) ? estimate_production_extension_penalty(business_connection, X_new_min) / X_new_min : 0.0;
-    const auto n_bar_min = n_bar - npe_at_X_expected + npe_at_X_new_min;
-    const auto n_co = calc_n_co(n_bar_min, D_r_min, business_connection);
-    if (n_co <= n_bar_min) {  // in linear regime of E_n(D) curve
-        if (D_r < D_r_min && D_r_min > 0.0) {
-            return (n_bar_min - n_co) / D_r_min;
-        }
-        // in production extension of E_n(D) curve
-        return grad_E_n_r;
-    }
-    // E_n(D) curved cropped from below with n_co
-    if (E_n_r <= n_co) {
-        return 0.0;
-    }
-    return grad_E_n_r;
-}
-
-FloatType PurchasingManager::transport_penalty(FloatType D_r, const BusinessConnection* business_connection) const {
-    FloatType target = 0.0;
-    if (model()->parameters().deviation_penalty) {
-        target = to_float(business_connection->last_demand_request_D(this).get_quantity());
-    } else {
-        target = to_float(business_connection->initial_flow_Z_star().get_quantity());
-    }
-    if (model()->parameters().quadratic_transport_penalty) {
-        FloatType marg_penalty = 0.0;
-        if (D_r < target) {
-            marg_penalty = -to_float(storage->sector->parameters().initial_markup);
-        } else if (D_r > target) {
-            marg_penalty = to_float(storage->sector->parameters().initial_markup);
-        } else {
-            marg_penalty = 0.0;
-        }
-        if (model()->parameters().relative_transport_penalty) {
-            if (target > FlowQuantity::precision) {
-                return (D_r - target) * ((D_r - target) * to_float(model()->parameters().transport_penalty_large) / (target * target) / 2 + marg_penalty);
-            }
-            return D_r * D_r * to_float(model()->parameters().transport_penalty_large / 2 + Price(marg_penalty));
+FloatType PurchasingManager::grad_n_r(FloatType D_r, const purchasing::PreparedSupplier& s) const {
+    return purchasing::grad_n_r(D_r, s, invariant_parameters);
+}
+
+FloatType PurchasingManager::transport_penalty(FloatType D_r, const purchasing::PreparedSupplier& s) const {
+    return purchasing::transport_penalty(D_r, s, invariant_parameters);
+}
+
+FloatType PurchasingManager::partial_D_r_transport_penalty(FloatType D_r, const purchasing::PreparedSupplier& s) const {
+    return purchasing::partial_D_r_transport_penalty(D_r, s, invariant_parameters);
+}
+
+FloatType PurchasingManager::marginal_costs_m_r(FloatType D_r, const purchasing::PreparedSupplier& s) const {
+    return purchasing::marginal_costs_m_r(D_r, s, invariant_parameters);
+}
+
+void PurchasingManager::update_invariant_parameters() {
+    const auto& model_parameters = model()->parameters();
+    invariant_parameters.deviation_penalty = model_parameters.deviation_penalty;
+    invariant_parameters.quadratic_transport_penalty = model_parameters.quadratic_transport_penalty;
+    invariant_parameters.relative_transport_penalty = model_parameters.relative_transport_penalty;
+    invariant_parameters.maximal_decrease_reservation_price_limited_by_markup = model_parameters.maximal_decrease_reservation_price_limited_by_markup;
+    invariant_parameters.initial_used_flow_U_star = to_float(storage->initial_used_flow_U_star().get_quantity());
+    invariant_parameters.initial_markup = to_float(storage->sector->parameters().initial_markup);
+    invariant_parameters.transport_penalty_large = model_parameters.transport_penalty_large;
+    invariant_parameters.transport_penalty_small = model_parameters.transport_penalty_small;
+    invariant_parameters.valid = true;
+}
+
+void PurchasingManager::calc_fingerprint() {
+    // everything the purchasing problem depends on besides invariant parameters
+    fingerprint.clear();
+    fingerprint.reserve(1 + 9 * purchasing_connections.size());
+    fingerprint.push_back(to_float(desired_purchase_));
+    for (std::size_t r = 0; r < purchasing_connections.size(); ++r) {
+        const auto* bc = purchasing_connections[r];
+        const auto& seller_parameters = bc->seller->communicated_parameters();
+        fingerprint.push_back(lower_bounds[r]);
+        fingerprint.push_back(upper_bounds[r]);
+        fingerprint.push_back(to_float(seller_parameters.offer_price_n_bar));
+        fingerprint.push_back(to_float(seller_parameters.production_X.get_quantity()));
+        fingerprint.push_back(to_float(seller_parameters.expected_production_X.get_quantity()));
+        fingerprint.push_back(to_float(seller_parameters.possible_production_X_hat.get_quantity()));
+        fingerprint.push_back(seller_parameters.possible_production_X_hat.get_price_float());
+        fingerprint.push_back(to_float(bc->last_shipment_Z().get_quantity()));
+        fingerprint.push_back(to_float(bc->last_demand_request_D(this).get_quantity()));  // target of deviation penalty
+        if constexpr (options::USE_MIN_PASSAGE_IN_EXPECTATION) {
+            fingerprint.push_back(bc->get_minimum_passage());
         }
-        return (D_r - target) * ((D_r - target) * to_float(model()->parameters().transport_penalty_large) / 2 + marg_penalty);
-    }
-    if (model()->parameters().relative_transport_penalty) {
-        return partial_D_r_transport_penalty(D_r, business_connection) * (D_r - target) / target;
     }
-    return partial_D_r_transport_penalty(D_r, business_connection) * (D_r - target);
 }
 
-FloatType PurchasingManager::partial_D_r_transport_penalty(FloatType D_r, const BusinessConnection* business_connection) const {
-    FloatType target = 0.0;
-    if (model()->parameters().deviation_penalty) {
-        target = to_float(business_connection->last_demand_request_D(this).get_quantity());
-    } else {
-        target = to_float(business_connection->initial_flow_Z_star().get_quantity());
+bool PurchasingManager::memo_applicable() const {
+    // compare against the solved problem rather than the last reused one, so that small changes cannot accumulate unnoticed
+    if (memo.fingerprint.size() != fingerprint.size()) {
+        return false;
     }
-    if (model()->parameters().quadratic_transport_penalty) {
-        FloatType marg_penalty = 0.0;
-        if (D_r < target) {
-            marg_penalty = -to_float(storage->sector->parameters().initial_markup);
-        } else if (D_r > target) {
-            marg_penalty = to_float(storage->sector->parameters().initial_markup);
-        } else {
-            marg_penalty = 0.0;
+    const auto tolerance = model()->parameters().purchasing_memoization_tolerance;
+    for (std::size_t i = 0; i < fingerprint.size(); ++i) {
+        if (std::abs(fingerprint[i] - memo.fingerprint[i]) > tolerance * std::max(std::abs(fingerprint[i]), std::abs(memo.fingerprint[i]))) {
+            return false;
         }
-        if (model()->parameters().relative_transport_penalty) {
-            if (target > FlowQuantity::precision) {
-                return (D_r - target) * to_float(model()->parameters().transport_penalty_large) / (target * target) + marg_penalty;
-            }
-            return D_r * to_float(model()->parameters().transport_penalty_large) + marg_penalty;
+    }
+    return true;
+}
+
+bool PurchasingManager::approximate_purchase() {
+    // first-order update of the previous solution: with suppliers at their bounds kept there, marginal costs of the others are linearized around their
+    // previous demand requests and set equal to a common shadow price meeting the desired purchase; the result is accepted if it satisfies the
+    // optimality conditions of the current problem up to the configured relative residual
+    static constexpr FloatType SENSITIVITY_STEP = 1e-6;  // relative to baseline flow
+    const auto n = purchasing_connections.size();
+    std::vector<FloatType> D(n);
+    std::vector<FloatType> m(n);
+    std::vector<FloatType> h(n);  // derivative of marginal costs
+    std::vector<bool> free(n);
+    FloatType bound_purchase = 0.0;
+    FloatType base_purchase = 0.0;
+    FloatType inverse_slopes = 0.0;
+    for (std::size_t r = 0; r < n; ++r) {
+        const auto* bc = purchasing_connections[r];
+        const auto x = std::min(upper_bounds[r], std::max(lower_bounds[r], memo.solution[r]));
+        D[r] = unscaled_D_r(x, bc);
+        free[r] = x > lower_bounds[r] + xtol_abs[r] && x < upper_bounds[r] - xtol_abs[r];
+        if (!free[r]) {
+            bound_purchase += D[r];
+            continue;
+        }
+        const auto step = std::min(SENSITIVITY_STEP * partial_D_r_scaled_D_r(bc), unscaled_D_r(upper_bounds[r], bc) - D[r]);
+        m[r] = marginal_costs_m_r(D[r], suppliers[r]);
+        h[r] = (marginal_costs_m_r(D[r] + step, suppliers[r]) - m[r]) / step;
+        if (!(h[r] > 0.0)) {  // flat marginal costs do not determine the demand request
+            return false;
         }
-        return (D_r - target) * to_float(model()->parameters().transport_penalty_large) + marg_penalty;
+        base_purchase += D[r] - m[r] / h[r];
+        inverse_slopes += 1.0 / h[r];
+    }
+    if (inverse_slopes <= 0.0) {
+        return false;
     }
-    if (model()->parameters().relative_transport_penalty) {
-        if (D_r < target) {
-            return -to_float(model()->parameters().transport_penalty_small) / target;
+    const auto shadow_price = (to_float(desired_purchase_) - bound_purchase - base_purchase) / inverse_slopes;
+    if (!(shadow_price > 0.0)) {
+        return false;
+    }
+
+    FloatType use = 0.0;
+    for (std::size_t r = 0; r < n; ++r) {
+        if (free[r]) {
+            const auto* bc = purchasing_connections[r];
+            D[r] = std::min(unscaled_D_r(upper_bounds[r], bc), std::max(unscaled_D_r(lower_bounds[r], bc), D[r] + (shadow_price - m[r]) / h[r]));
         }
-        if (D_r > target) {
-            return to_float(model()->parameters().transport_penalty_large) / target;
+        use += D[r];
+    }
+    if (std::abs(scaled_use(to_float(desired_purchase_) - use)) > FlowQuantity::precision) {  // bounds became active
+        return false;
+    }
+
+    // marginal costs equal the shadow price for interior demand requests and do not undercut (exceed) it at lower (upper) bounds
+    FloatType residual = 0.0;
+    for (std::size_t r = 0; r < n; ++r) {
+        const auto* bc = purchasing_connections[r];
+        const auto x = scaled_D_r(D[r], bc);
+        const auto m_r = marginal_costs_m_r(D[r], suppliers[r]);
+        if (x <= lower_bounds[r] + xtol_abs[r]) {
+            residual = std::max(residual, shadow_price - m_r);
+        } else if (x >= upper_bounds[r] - xtol_abs[r]) {
+            residual = std::max(residual, m_r - shadow_price);
+        } else {
+            residual = std::max(residual, std::abs(m_r - shadow_price));
         }
-        return (to_float(model()->parameters().transport_penalty_large) - to_float(model()->parameters().transport_penalty_small)) / 2 / target;
     }
-    if (D_r < target) {
-        return -to_float(model()->parameters().transport_penalty_small);
+    kkt_residual_ = residual / shadow_price;
+    if (kkt_residual_ > model()->parameters().purchasing_approximation_tolerance) {
+        return false;
     }
-    if (D_r > target) {
-        return to_float(model()->parameters().transport_penalty_large);
+
+    FloatType costs = 0.0;
+    for (std::size_t r = 0; r < n; ++r) {
+        const auto* bc = purchasing_connections[r];
+        demand_requests_D[r] = scaled_D_r(D[r], bc);
+        costs += n_r(D[r], suppliers[r]) * D[r] + transport_penalty(D[r], suppliers[r]);
     }
-    return (to_float(model()->parameters().transport_penalty_large) - to_float(model()->parameters().transport_penalty_small)) / 2;
+    optimized_value_ = -costs;
+    return true;
 }
 
 void PurchasingManager::add_initial_demand_D_star(const Demand& demand_D_p) {
     debug::assertstep(this, IterationStep::INITIALIZATION);
+    invariant_parameters.valid = false;
     demand_D_ += demand_D_p;
     expected_costs_ += demand_D_p.get_value();
 }
 
 void PurchasingManager::subtract_initial_demand_D_star(const Demand& demand_D_p) {
     debug::assertstep(this, IterationStep::INITIALIZATION);
+    invariant_parameters.valid = false;
     demand_D_ -= demand_D_p;
     expected_costs_ -= demand_D_p.get_value();
 }
 
 FloatType PurchasingManager::run_optimizer(optimization::Optimization& opt) {
     // debug code for optimization error
-    if (find(model()->parameters().debug_purchasing_steps.begin(), model()->parameters().debug_purchasing_steps.end(), this->name())
-        != model()->parameters().debug_purchasing_steps.end()) {
+    if (debug_distribution) {
         debug_print_distribution(demand_requests_D);
     }
     try {
@@ -482,7 +452,7 @@ FloatType PurchasingManager::run_optimizer(optimization::Optimization& opt) {
             optimization_restart_count += 1;
             log::warning(this, "optimization reached maximum iterations BUG for ", optimization_restart_count, " time (for ", purchasing_connections.size(),
                          " inputs)");
-            if (optimization_restart_count < 10) {
+            if (optimization_restart_count < 10 && !model()->parameters().deterministic_optimization) {
                 // optional restart at baseline demand levels (setting non-available suppliers to 0)
                 if (model()->parameters().optimization_restart_baseline) {
                     demand_requests_D.clear();
@@ -540,7 +510,7 @@ void PurchasingManager::optimization_exception_handling(bool res, optimization::
                 log::warning(this, "optimization reached maximum iterations for ", optimization_restart_count, " time (for ", purchasing_connections.size(),
                              " inputs)");
             }
-            if (optimization_restart_count < 10) {
+            if (optimization_restart_count < 10 && !model()->parameters().deterministic_optimization) {
                 opt.reset_last_result();
                 run_optimizer(opt);
             }
@@ -561,14 +531,33 @@ void PurchasingManager::optimization_exception_handling(bool res, optimization::
 }
 
 void PurchasingManager::iterate_purchase() {
+    const auto phase = prepare_purchase();
+    if (phase == purchase_phase_t::OPTIMIZE) {
+        optimize_purchase();
+    }
+    if (phase != purchase_phase_t::DONE) {
+        distribute_purchase();
+    }
+}
+
+PurchasingManager::purchase_phase_t PurchasingManager::prepare_purchase() {
     debug::assertstep(this, IterationStep::PURCHASE);
     assert(!business_connections.empty());
+    if (!invariant_parameters.valid) {
+        update_invariant_parameters();
+    }
 
     demand_D_ = Demand(0.0);
     expected_costs_ = FlowValue(0.0);
     optimized_value_ = 0.0;
     purchase_ = Demand(0.0);
     total_transport_penalty_ = FlowValue(0.0);
+    pruning_error_ = FlowValue(0.0);
+    pruned_connections.clear();
+    last_solution_ = solution_t::SOLVED;
+    approximation_rejected_ = false;
+    kkt_residual_ = 0.0;
+    batched_deviation_ = std::numeric_limits<FloatType>::quiet_NaN();
 
     demand_requests_D.clear();
     demand_requests_D.reserve(business_connections.size());
@@ -576,6 +565,8 @@ void PurchasingManager::iterate_purchase() {
     lower_bounds.reserve(business_connections.size());
     purchasing_connections.clear();
     purchasing_connections.reserve(business_connections.size());
+    suppliers.clear();
+    suppliers.reserve(business_connections.size());
     upper_bounds.clear();
     upper_bounds.reserve(business_connections.size());
     xtol_abs.clear();
@@ -596,19 +587,26 @@ void PurchasingManager::iterate_purchase() {
         for (auto& bc : business_connections) {
             bc->send_demand_request_D(Demand(0.0));
         }
-        return;
+        return purchase_phase_t::DONE;
     }
 
-    FlowQuantity maximal_possible_purchase(0.0);
-    for (auto& bc : business_connections) {
+    parallel_connections = model()->parallelize_connections(business_connections.size());
+    connection_upper_limits.resize(business_connections.size());
+    connection_initial_values.resize(business_connections.size());
+    connection_suppliers.resize(business_connections.size());
+    openmp::for_each_index(0, business_connections.size(), parallel_connections, [&](std::size_t i) {
+        auto* bc = business_connections[i].get();
+        connection_upper_limits[i] = -1.0;
         if (bc->seller->communicated_parameters().possible_production_X_hat.get_quantity() <= 0.0) {
             bc->send_demand_request_D(Demand(0.0));
         } else {  // this supplier can deliver a non-zero amount
             // assumption, we cannot crowd out other purchasers given that our maximum offer price is n_max, calculate analytical approximation for maximal
             // deliverable amount of purchaser X_max(n_max) and consider boundary conditions
-            const auto X_expected = expected_production(bc.get());
-            const auto additional_X_expected = expected_additional_production(bc.get());
-            auto X_max = to_float(calc_analytical_approximation_X_max(bc.get()));
+            connection_suppliers[i] = purchasing::PreparedSupplier(supplier(bc), invariant_parameters);
+            const auto& s = connection_suppliers[i];
+            const auto X_expected = s.expected_production_X;
+            const auto additional_X_expected = s.additional_X_expected;
+            auto X_max = to_float(calc_analytical_approximation_X_max(bc));
             if constexpr (options::USE_MIN_PASSAGE_IN_EXPECTATION) {
                 X_max *= bc->get_minimum_passage();
             }
@@ -634,24 +632,62 @@ void PurchasingManager::iterate_purchase() {
                     initial_value_unbound = (baseline_value + (X_expected - additional_X_expected))
                                             / 2;  // equal weighted interpolation between current expected value and starting value
                 }
-                const auto initial_value = std::min(upper_limit, std::max(lower_limit, initial_value_unbound));
-
-                purchasing_connections.push_back(bc.get());
-                lower_bounds.push_back(scaled_D_r(lower_limit, bc.get()));
-                upper_bounds.push_back(scaled_D_r(upper_limit, bc.get()));
-                xtol_abs.push_back(scaled_D_r(FlowQuantity::precision * model()->parameters().optimization_precision_adjustment, bc.get()));
-                pre_xtol_abs.push_back(scaled_D_r(FlowQuantity::precision * model()->parameters().global_optimization_precision_adjustment, bc.get()));
-                demand_requests_D.push_back(scaled_D_r(initial_value, bc.get()));
-                maximal_possible_purchase += D_r_max;
+                connection_upper_limits[i] = upper_limit;
+                connection_initial_values[i] = std::min(upper_limit, std::max(lower_limit, initial_value_unbound));
             } else {
                 bc->send_demand_request_D(Demand(0.0));
             }
         }
+    });
+
+    // suppliers with a negligible share of what could be delivered at baseline terms are left out of the optimization and get a fixed proportional
+    // share of the desired purchase instead; as the share is recomputed every step, they rejoin once their relative weight rises
+    const auto pruning_threshold = model()->parameters().purchasing_pruning_threshold;
+    FloatType deliverable_supply = 0.0;
+    FloatType max_deliverable = 0.0;
+    if (pruning_threshold > 0.0) {
+        for (std::size_t i = 0; i < business_connections.size(); ++i) {
+            if (connection_upper_limits[i] >= 0.0) {
+                const auto deliverable = std::min(to_float(business_connections[i]->initial_flow_Z_star().get_quantity()), connection_upper_limits[i]);
+                deliverable_supply += deliverable;
+                max_deliverable = std::max(max_deliverable, deliverable);
+            }
+        }
     }
+    const auto pruning_weight = [&](std::size_t i) {
+        return std::min(to_float(business_connections[i]->initial_flow_Z_star().get_quantity()), connection_upper_limits[i]) / deliverable_supply;
+    };
+    const bool prune = pruning_threshold > 0.0 && max_deliverable >= pruning_threshold * deliverable_supply;  // keeps at least one supplier
+
+    FlowQuantity maximal_possible_purchase(0.0);
+    FlowQuantity maximal_optimized_purchase(0.0);
+    for (std::size_t i = 0; i < business_connections.size(); ++i) {
+        if (connection_upper_limits[i] < 0.0) {
+            continue;
+        }
+        auto* bc = business_connections[i].get();
+        const FloatType lower_limit = 0.0;
+        const FloatType upper_limit = connection_upper_limits[i];
+        maximal_possible_purchase += round(FlowQuantity(upper_limit));
+        if (prune && pruning_weight(i) < pruning_threshold) {
+            pruned_connections.emplace_back(i, 0.0);  // demand request is fixed once desired purchase is known
+            continue;
+        }
+        purchasing_connections.push_back(bc);
+        suppliers.push_back(connection_suppliers[i]);
+        lower_bounds.push_back(scaled_D_r(lower_limit, bc));
+        upper_bounds.push_back(scaled_D_r(upper_limit, bc));
+        xtol_abs.push_back(scaled_D_r(FlowQuantity::precision * model()->parameters().optimization_precision_adjustment, bc));
+        pre_xtol_abs.push_back(scaled_D_r(FlowQuantity::precision * model()->parameters().global_optimization_precision_adjustment, bc));
+        demand_requests_D.push_back(scaled_D_r(connection_initial_values[i], bc));
+        maximal_optimized_purchase += round(FlowQuantity(upper_limit));
+    }
+    parallel_connections = model()->parallelize_connections(purchasing_connections.size());
+    parallel_objective = model()->parallelize_objective(purchasing_connections.size());
 
     if (purchasing_connections.empty()) {
         log::warning(this, "possible demand is zero (no supplier with possible production capacity > 0.0)");
-        return;
+        return purchase_phase_t::DONE;
     }
     assert(maximal_possible_purchase > 0.0);
 
@@ -659,6 +695,69 @@ void PurchasingManager::iterate_purchase() {
         desired_purchase_ = maximal_possible_purchase;
     }
 
+    if (!pruned_connections.empty()) {
+        FloatType pruned_purchase = 0.0;
+        for (auto& [i, D_r] : pruned_connections) {
+            D_r = std::min(pruning_weight(i) * to_float(desired_purchase_), connection_upper_limits[i]);
+            pruned_purchase += D_r;
+        }
+        desired_purchase_ = round(desired_purchase_ - FlowQuantity(pruned_purchase));
+        if (desired_purchase_ > maximal_optimized_purchase) {
+            desired_purchase_ = maximal_optimized_purchase;
+        }
+    }
+
+    const bool same_connections = (model()->parameters().purchasing_memoization || model()->parameters().purchasing_approximation)
+                                  && memo.connections.size() == purchasing_connections.size()
+                                  && std::equal(std::begin(purchasing_connections), std::end(purchasing_connections), std::begin(memo.connections));
+    if (same_connections && model()->parameters().purchasing_memoization) {
+        calc_fingerprint();
+        if (memo_applicable()) {
+            last_solution_ = solution_t::REUSED;
+            demand_requests_D = memo.solution;
+            optimized_value_ = memo.optimized_value;
+        } else {
+            // NLopt does not take multipliers or active sets, so warm-start from the previous solution instead
+            last_solution_ = solution_t::WARM_STARTED;
+            for (std::size_t r = 0; r < purchasing_connections.size(); ++r) {
+                demand_requests_D[r] = std::min(upper_bounds[r], std::max(lower_bounds[r], memo.solution[r]));
+            }
+        }
+    }
+    if (same_connections && model()->parameters().purchasing_approximation && last_solution_ != solution_t::REUSED) {
+        if (approximate_purchase()) {
+            // not memorized, so that reuse and further approximations are always checked against the last solve of the optimizer
+            last_solution_ = solution_t::APPROXIMATED;
+            return purchase_phase_t::DISTRIBUTE;
+        }
+        approximation_rejected_ = true;
+        last_solution_ = solution_t::WARM_STARTED;
+        for (std::size_t r = 0; r < purchasing_connections.size(); ++r) {
+            demand_requests_D[r] = std::min(upper_bounds[r], std::max(lower_bounds[r], memo.solution[r]));
+        }
+    }
+    return last_solution_ == solution_t::REUSED ? purchase_phase_t::DISTRIBUTE : purchase_phase_t::OPTIMIZE;
+}
+
+void PurchasingManager::optimize_purchase() {
+    const bool recording = !model()->parameters().purchasing_record_file.empty();
+    std::vector<double> start;
+    if (recording) {
+        start = demand_requests_D;
+    }
+    objective_evaluations = 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    solve_purchase(recording ? &start : nullptr);
+    if (recording) {
+        record_problem(std::move(start), std::chrono::duration<FloatType>(std::chrono::steady_clock::now() - t0).count());
+    }
+    memorize_solution();
+}
+
+void PurchasingManager::solve_purchase(std::vector<double>* local_start) {
+    // wall-clock limits and restarts make results depend on machine load, in deterministic mode only evaluation counts limit the optimization
+    const bool deterministic = model()->parameters().deterministic_optimization;
+
     // experimental optimization setup: first use global optimizer DIRECT to get a reasonable result, polish the result with previous routine.
     // add auglag to support contraints with different global algorithms
     // define  lagrangian optimizer to pass (in)equality constraints to global algorithm which cannot use it directly:
@@ -672,22 +771,28 @@ void PurchasingManager::iterate_purchase() {
         lagrangian_optimizer.upper_bounds(upper_bounds);
         lagrangian_optimizer.xtol(pre_xtol_abs);
         lagrangian_optimizer.maxeval(model()->parameters().global_optimization_maxiter);
-        lagrangian_optimizer.maxtime(model()->parameters().global_optimization_timeout);
+        lagrangian_optimizer.maxtime(deterministic ? 0 : model()->parameters().global_optimization_timeout);
         // define global optimizer
         optimization::Optimization pre_opt(static_cast<nlopt_algorithm>(model()->parameters().global_optimization_algorithm),
                                            purchasing_connections.size());  // TODO keep and only recreate when resize is needed
 
         pre_opt.xtol(pre_xtol_abs);
         pre_opt.maxeval(model()->parameters().global_optimization_maxiter);
-        pre_opt.maxtime(model()->parameters().global_optimization_timeout);
+        pre_opt.maxtime(deterministic ? 0 : model()->parameters().global_optimization_timeout);
         // start combined global optimizer
         lagrangian_optimizer.set_local_algorithm(pre_opt.get_optimizer());
+        if (deterministic) {
+            optimization::Optimization::seed(0);
+        }
         optimization_restart_count = 0;
         optimized_value_ = run_optimizer(lagrangian_optimizer);
     }
     // optional local optimization to polish global optimum
 
     if (model()->parameters().local_purchasing_optimization) {
+        if (local_start != nullptr) {
+            *local_start = demand_requests_D;  // recorded problems are replayed with the local algorithm only
+        }
         optimization::Optimization local_optimizer(static_cast<nlopt_algorithm>(model()->parameters().optimization_algorithm),
                                                    purchasing_connections.size());  // TODO keep and only recreate when resize is needed
         local_optimizer.add_equality_constraint(this, FlowQuantity::precision);
@@ -695,20 +800,312 @@ void PurchasingManager::iterate_purchase() {
         local_optimizer.xtol(xtol_abs);
         local_optimizer.lower_bounds(lower_bounds);
         local_optimizer.upper_bounds(upper_bounds);
-        local_optimizer.maxeval(model()->parameters().optimization_maxiter);
-        local_optimizer.maxtime(model()->parameters().optimization_timeout);
+        if (deterministic) {
+            local_optimizer.evaluation_budget(model()->parameters().optimization_evaluations_per_dimension * static_cast<int>(purchasing_connections.size()));
+        } else {
+            local_optimizer.maxeval(model()->parameters().optimization_maxiter);
+            local_optimizer.maxtime(model()->parameters().optimization_timeout);
+        }
         optimization_restart_count = 0;
         optimized_value_ = run_optimizer(local_optimizer);
     }
+}
 
-    FloatType costs = 0.0;
+void PurchasingManager::record_problem(std::vector<double> start, FloatType seconds, bool batched) {
+    const auto& parameters = model()->parameters();
+    const bool slow = parameters.purchasing_record_time > 0.0 && seconds >= parameters.purchasing_record_time;
+    const bool expensive = parameters.purchasing_record_evaluations > 0 && objective_evaluations >= static_cast<std::uint64_t>(parameters.purchasing_record_evaluations);
+    if (!slow && !expensive && !debug_distribution) {
+        return;
+    }
+    PurchasingProblemRecord record;
+    record.name = name();
+    record.timestep = model()->timestep();
+    record.algorithm = parameters.optimization_algorithm;
+    record.maxeval = parameters.deterministic_optimization ? parameters.optimization_evaluations_per_dimension * static_cast<int>(purchasing_connections.size())
+                                                           : parameters.optimization_maxiter;
+    record.deterministic = parameters.deterministic_optimization;
+    record.global = parameters.global_purchasing_optimization;
+    record.batched = batched;
+    record.desired_purchase = to_float(desired_purchase_);
+    record.initial_used_flow_U_star = invariant_parameters.initial_used_flow_U_star;
+    record.parameters = invariant_parameters;
+    record.evaluations = objective_evaluations;
+    record.seconds = seconds;
+    record.optimized_value = optimized_value_;
+    record.suppliers.assign(std::begin(suppliers), std::end(suppliers));
+    record.lower_bounds = lower_bounds;
+    record.upper_bounds = upper_bounds;
+    record.xtol_abs = xtol_abs;
+    record.start = std::move(start);
+    record.solution = demand_requests_D;
+    model()->record_purchasing_problem(record);
+}
+
+void PurchasingManager::memorize_solution() {
+    if (model()->parameters().purchasing_memoization || model()->parameters().purchasing_approximation) {
+        if (model()->parameters().purchasing_memoization && last_solution_ == solution_t::SOLVED) {
+            calc_fingerprint();
+        }
+        memo.connections.assign(std::begin(purchasing_connections), std::end(purchasing_connections));
+        memo.fingerprint = fingerprint;
+        memo.solution = demand_requests_D;
+        memo.optimized_value = optimized_value_;
+    }
+}
+
+void PurchasingManager::optimize_purchase_batch(const std::vector<PurchasingManager*>& batch) {
+    // all problems have the same number of connections; as costs are separable, the optimum is found by bisection on the shadow price of the purchase
+    // constraint, for each price the demand requests follow from bisection on the marginal costs; all problems advance in lockstep and drop out once
+    // their purchase constraint and demand requests meet the precisions used by the single-problem optimization; warm-started problems take the
+    // marginal costs of the previous solution as their first price.
+    // The bisections only find the optimum if marginal costs are non-decreasing, which is not guaranteed (e.g. for the production extension
+    // penalty); hence every result is checked against the optimality conditions, and problems failing them, not converging or exceeding the
+    // evaluation budget in deterministic mode are solved by the single-problem optimization instead
+    static constexpr int MAX_PRICE_ITERATIONS = 100;
+    static constexpr FloatType MIN_RELATIVE_PRICE_BRACKET = 1e-12;
+    static constexpr FloatType KKT_TOLERANCE = 1e-9;  // relative to the price, marginal costs bracket the price exactly if non-decreasing
+    if (batch.empty()) {
+        return;
+    }
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto count = batch.size();
+    const auto n = batch.front()->purchasing_connections.size();
+    const auto& parameters = batch.front()->model()->parameters();
+    const bool recording = !parameters.purchasing_record_file.empty();
+    const bool cross_checking = parameters.batched_purchasing_cross_check_tolerance > 0.0;
+    // evaluation budget of the single-problem optimization in deterministic mode, counted in evaluations of the marginal costs of one connection,
+    // i.e. n per objective evaluation
+    const std::uint64_t budget =
+        parameters.deterministic_optimization ? static_cast<std::uint64_t>(parameters.optimization_evaluations_per_dimension) * n * n : 0;
+
+    // problem-major arrays, entry p * n + r belongs to connection r of problem p
+    std::vector<FloatType> D(count * n);
+    std::vector<FloatType> D_min(count * n);  // bounds
+    std::vector<FloatType> D_max(count * n);
+    std::vector<FloatType> D_lo(count * n);  // demand requests at price_lo
+    std::vector<FloatType> D_hi(count * n);  // demand requests at price_hi
+    std::vector<FloatType> D_tol(count * n);
+    std::vector<FloatType> a(count * n);
+    std::vector<FloatType> b(count * n);
+    std::vector<FloatType> mid(count * n);
+    std::vector<FloatType> m(count * n);  // marginal costs at mid
+    std::vector<FloatType> price(count, std::numeric_limits<FloatType>::quiet_NaN());
+    std::vector<FloatType> price_lo(count);
+    std::vector<FloatType> price_hi(count);
+    std::vector<FloatType> price_start(count, std::numeric_limits<FloatType>::quiet_NaN());
+    std::vector<FloatType> desired(count);
+    std::vector<std::uint64_t> evaluations(count, 0);
+    enum class state_t { ACTIVE, CONVERGED, FAILED };
+    std::vector<state_t> state(count, state_t::ACTIVE);
+    std::vector<std::vector<double>> starts(count);
+
+    const auto sum = [n](const std::vector<FloatType>& v, std::size_t p) {
+        return std::accumulate(std::begin(v) + p * n, std::begin(v) + (p + 1) * n, FloatType(0.0));
+    };
+
+    for (std::size_t p = 0; p < count; ++p) {
+        auto* pm = batch[p];
+        assert(pm->purchasing_connections.size() == n);
+        if (recording || cross_checking) {
+            starts[p] = pm->demand_requests_D;
+        }
+        // debug code as for the single-problem optimization
+        if (pm->debug_distribution) {
+            pm->debug_print_distribution(pm->demand_requests_D);
+        }
+        desired[p] = to_float(pm->desired_purchase_);
+        price_lo[p] = std::numeric_limits<FloatType>::max();
+        price_hi[p] = std::numeric_limits<FloatType>::lowest();
+        for (std::size_t r = 0; r < n; ++r) {
+            const auto* bc = pm->purchasing_connections[r];
+            const auto k = p * n + r;
+            D_min[k] = pm->unscaled_D_r(pm->lower_bounds[r], bc);
+            D_max[k] = pm->unscaled_D_r(pm->upper_bounds[r], bc);
+            D_tol[k] = pm->unscaled_D_r(pm->xtol_abs[r], bc);
+            price_lo[p] = std::min(price_lo[p], pm->marginal_costs_m_r(D_min[k], pm->suppliers[r]));
+            price_hi[p] = std::max(price_hi[p], pm->marginal_costs_m_r(D_max[k], pm->suppliers[r]));
+        }
+        evaluations[p] += 2 * n;
+        std::copy(std::begin(D_min) + p * n, std::begin(D_min) + (p + 1) * n, std::begin(D_lo) + p * n);
+        std::copy(std::begin(D_max) + p * n, std::begin(D_max) + (p + 1) * n, std::begin(D_hi) + p * n);
+        if (pm->last_solution_ == solution_t::WARM_STARTED) {
+            // demand requests hold the previous solution, its connections within their bounds have marginal costs at the previous price
+            FloatType weighted_costs = 0.0;
+            FloatType weights = 0.0;
+            for (std::size_t r = 0; r < n; ++r) {
+                const auto* bc = pm->purchasing_connections[r];
+                const auto D_r = pm->unscaled_D_r(pm->demand_requests_D[r], bc);
+                if (D_r > D_min[p * n + r] && D_r < D_max[p * n + r]) {
+                    weighted_costs += pm->marginal_costs_m_r(D_r, pm->suppliers[r]) * D_r;
+                    weights += D_r;
+                    ++evaluations[p];
+                }
+            }
+            if (weights > 0.0 && weighted_costs / weights > price_lo[p] && weighted_costs / weights < price_hi[p]) {
+                price_start[p] = weighted_costs / weights;
+            }
+        }
+        if (pm->scaled_use(sum(D_max, p) - desired[p]) <= FlowQuantity::precision) {  // all suppliers at their limit
+            std::copy(std::begin(D_max) + p * n, std::begin(D_max) + (p + 1) * n, std::begin(D) + p * n);
+            state[p] = state_t::CONVERGED;
+        } else if (pm->scaled_use(sum(D_min, p) - desired[p]) >= -FlowQuantity::precision) {
+            std::copy(std::begin(D_min) + p * n, std::begin(D_min) + (p + 1) * n, std::begin(D) + p * n);
+            state[p] = state_t::CONVERGED;
+        }
+    }
+
+    for (int iteration = 0; iteration < MAX_PRICE_ITERATIONS && std::find(std::begin(state), std::end(state), state_t::ACTIVE) != std::end(state);
+         ++iteration) {
+        for (std::size_t p = 0; p < count; ++p) {
+            if (state[p] == state_t::ACTIVE) {
+                price[p] = iteration == 0 && !std::isnan(price_start[p]) ? price_start[p] : (price_lo[p] + price_hi[p]) / 2;
+                std::copy(std::begin(D_lo) + p * n, std::begin(D_lo) + (p + 1) * n, std::begin(a) + p * n);
+                std::copy(std::begin(D_hi) + p * n, std::begin(D_hi) + (p + 1) * n, std::begin(b) + p * n);
+            }
+        }
+        // demand requests at which marginal costs reach the current prices, bisected until within their tolerance; midpoints and the bracket
+        // update are computed in separate passes over contiguous arrays, only the marginal costs are evaluated per connection
+        bool bisecting = true;
+        while (bisecting) {
+            bisecting = false;
+            for (std::size_t p = 0; p < count; ++p) {
+                if (state[p] != state_t::ACTIVE) {
+                    continue;
+                }
+                const auto* pm = batch[p];
+                const auto begin = p * n;
+                const auto end = begin + n;
+                for (std::size_t k = begin; k < end; ++k) {
+                    mid[k] = (a[k] + b[k]) / 2;
+                }
+                std::uint64_t bisected = 0;
+                for (std::size_t r = 0; r < n; ++r) {
+                    const auto k = begin + r;
+                    if (b[k] - a[k] > D_tol[k]) {
+                        m[k] = pm->marginal_costs_m_r(mid[k], pm->suppliers[r]);
+                        ++bisected;
+                    }
+                }
+                for (std::size_t k = begin; k < end; ++k) {
+                    const bool open = b[k] - a[k] > D_tol[k];
+                    const bool below = m[k] < price[p];
+                    a[k] = open && below ? mid[k] : a[k];
+                    b[k] = open && !below ? mid[k] : b[k];
+                }
+                evaluations[p] += bisected;
+                bisecting = bisecting || bisected > 0;
+            }
+        }
+        for (std::size_t p = 0; p < count; ++p) {
+            if (state[p] != state_t::ACTIVE) {
+                continue;
+            }
+            if (budget > 0 && evaluations[p] > budget) {
+                state[p] = state_t::FAILED;
+                continue;
+            }
+            for (std::size_t k = p * n; k < (p + 1) * n; ++k) {
+                D[k] = (a[k] + b[k]) / 2;
+            }
+            const auto residual = batch[p]->scaled_use(sum(D, p) - desired[p]);
+            if (std::abs(residual) <= FlowQuantity::precision) {
+                state[p] = state_t::CONVERGED;
+                continue;
+            }
+            // keep the solutions bracketed by the demand requests at the bracketing prices
+            if (residual > 0.0) {
+                price_hi[p] = price[p];
+                std::copy(std::begin(b) + p * n, std::begin(b) + (p + 1) * n, std::begin(D_hi) + p * n);
+            } else {
+                price_lo[p] = price[p];
+                std::copy(std::begin(a) + p * n, std::begin(a) + (p + 1) * n, std::begin(D_lo) + p * n);
+            }
+            if (price_hi[p] - price_lo[p] <= MIN_RELATIVE_PRICE_BRACKET * std::abs(price_hi[p])) {
+                // marginal costs are flat around the price, any mix of both brackets is optimal, so take the one meeting the purchase constraint
+                const auto sum_lo = sum(D_lo, p);
+                const auto sum_hi = sum(D_hi, p);
+                const auto t = sum_hi > sum_lo ? std::min(1.0, std::max(0.0, (desired[p] - sum_lo) / (sum_hi - sum_lo))) : 0.0;
+                for (std::size_t k = p * n; k < (p + 1) * n; ++k) {
+                    D[k] = D_lo[k] + t * (D_hi[k] - D_lo[k]);
+                }
+                state[p] = state_t::CONVERGED;
+            }
+        }
+    }
+
+    // optimality conditions: no connection can be moved away from its bound (or in either direction if interior) at marginal costs below (above)
+    // the shadow price
+    for (std::size_t p = 0; p < count; ++p) {
+        if (state[p] != state_t::CONVERGED || std::isnan(price[p])) {  // no price for problems with all suppliers at their bounds
+            continue;
+        }
+        const auto* pm = batch[p];
+        FloatType residual = 0.0;
+        for (std::size_t r = 0; r < n; ++r) {
+            const auto k = p * n + r;
+            if (D[k] > D_min[k] + D_tol[k]) {
+                residual = std::max(residual, pm->marginal_costs_m_r(std::max(D_min[k], D[k] - D_tol[k]), pm->suppliers[r]) - price[p]);
+                ++evaluations[p];
+            }
+            if (D[k] < D_max[k] - D_tol[k]) {
+                residual = std::max(residual, price[p] - pm->marginal_costs_m_r(std::min(D_max[k], D[k] + D_tol[k]), pm->suppliers[r]));
+                ++evaluations[p];
+            }
+        }
+        if (residual > KKT_TOLERANCE * std::abs(price[p])) {
+            state[p] = state_t::FAILED;
+        }
+    }
+
+    const auto seconds = std::chrono::duration<FloatType>(std::chrono::steady_clock::now() - t0).count() / count;
+    for (std::size_t p = 0; p < count; ++p) {
+        auto* pm = batch[p];
+        pm->optimization_restart_count = 0;
+        if (state[p] != state_t::CONVERGED) {
+            // fall back to the single-problem optimization
+            pm->optimize_purchase();
+            continue;
+        }
+        FloatType costs = 0.0;
+        for (std::size_t r = 0; r < n; ++r) {
+            const auto* bc = pm->purchasing_connections[r];
+            const auto D_r = D[p * n + r];
+            pm->demand_requests_D[r] = pm->scaled_D_r(D_r, bc);
+            costs += pm->n_r(D_r, pm->suppliers[r]) * D_r + pm->transport_penalty(D_r, pm->suppliers[r]);
+        }
+        if (cross_checking) {
+            // solve the same problem with NLopt from the same starting point, keep the batched solution
+            const auto batched_solution = pm->demand_requests_D;
+            pm->demand_requests_D = starts[p];
+            pm->solve_purchase(nullptr);
+            const auto nlopt_costs = -pm->optimized_value_;
+            pm->batched_deviation_ = (costs - nlopt_costs) / std::max(std::abs(nlopt_costs), to_float(FlowValue::precision));
+            if (pm->batched_deviation_ > parameters.batched_purchasing_cross_check_tolerance) {
+                log::warning(pm, "batched purchasing deviates from NLopt: costs ", costs, " vs. ", nlopt_costs);
+            }
+            pm->demand_requests_D = batched_solution;
+        }
+        pm->optimized_value_ = -costs;
+        pm->objective_evaluations = evaluations[p] / n;  // in objective evaluations for recording
+        if (recording) {
+            pm->record_problem(std::move(starts[p]), seconds, true);
+        }
+        pm->memorize_solution();
+    }
+}
+
+void PurchasingManager::distribute_purchase() {
     FloatType use = 0.0;
+    FlowValue total_transport_penalty = FlowValue(0.0);
+    connection_costs.resize(purchasing_connections.size());
+    connection_transport_penalties.resize(purchasing_connections.size());
     // distribute demand requests
-    for (std::size_t r = 0; r < purchasing_connections.size(); ++r) {
+    openmp::for_each_index(0, purchasing_connections.size(), parallel_connections, [&](std::size_t r) {
         const auto D_r = unscaled_D_r(demand_requests_D[r], purchasing_connections[r]);
         Demand demand_request_D = Demand(FlowQuantity(D_r), FlowValue(D_r));
-        assert(!std::isnan(n_r(D_r, purchasing_connections[r])));
-        demand_request_D.set_price(round(Price(n_r(D_r, purchasing_connections[r]))));
+        assert(!std::isnan(n_r(D_r, suppliers[r])));
+        demand_request_D.set_price(round(Price(n_r(D_r, suppliers[r]))));
 
         if constexpr (options::OPTIMIZATION_WARNINGS) {
             if (round(demand_request_D.get_quantity()) > round(FlowQuantity(unscaled_D_r(upper_bounds[r], purchasing_connections[r])))) {
@@ -721,14 +1118,45 @@ void PurchasingManager::iterate_purchase() {
             }
         }
         purchasing_connections[r]->send_demand_request_D(round(demand_request_D));
-
+        connection_transport_penalties[r] = transport_penalty(D_r, suppliers[r]);
+        connection_costs[r] = n_r(D_r, suppliers[r]) * D_r + connection_transport_penalties[r];
+    });
+    // sum up in fixed order
+    FloatType costs = 0.0;
+    FloatType marginal_costs = 0.0;  // demand weighted over optimized connections, only needed for pruning error
+    FloatType optimized_purchase = 0.0;
+    for (std::size_t r = 0; r < purchasing_connections.size(); ++r) {
+        const auto D_r = unscaled_D_r(demand_requests_D[r], purchasing_connections[r]);
         if constexpr (options::DEBUGGING) {
             use += D_r;
         }
-        demand_D_ += round(demand_request_D);
-        costs += n_r(D_r, purchasing_connections[r]) * D_r + transport_penalty(D_r, purchasing_connections[r]);
-        total_transport_penalty_ += FlowValue(transport_penalty(D_r, purchasing_connections[r]));
+        demand_D_ += purchasing_connections[r]->last_demand_request_D(this);
+        costs += connection_costs[r];
+        total_transport_penalty += FlowValue(connection_transport_penalties[r]);
+        if (!pruned_connections.empty()) {
+            marginal_costs += marginal_costs_m_r(D_r, suppliers[r]) * D_r;
+            optimized_purchase += D_r;
+        }
+    }
+    // pruned suppliers get their fixed share, the deviation of their marginal costs from the optimized ones estimates the error made
+    FloatType pruning_error = 0.0;
+    if (optimized_purchase > 0.0) {
+        marginal_costs /= optimized_purchase;
+    }
+    for (const auto& [i, D_r] : pruned_connections) {
+        auto* bc = business_connections[i].get();
+        Demand demand_request_D = Demand(FlowQuantity(D_r), FlowValue(D_r));
+        const auto& s = connection_suppliers[i];
+        demand_request_D.set_price(round(Price(n_r(D_r, s))));
+        bc->send_demand_request_D(round(demand_request_D));
+        demand_D_ += bc->last_demand_request_D(this);
+        const auto transport_penalty_r = transport_penalty(D_r, s);
+        costs += n_r(D_r, s) * D_r + transport_penalty_r;
+        total_transport_penalty += FlowValue(transport_penalty_r);
+        pruning_error += std::abs(marginal_costs_m_r(D_r, s) - marginal_costs) * D_r;
     }
+    pruning_error_ = FlowValue(pruning_error);
+    total_transport_penalty_ = total_transport_penalty;
     expected_costs_ = FlowValue(costs);
     if constexpr (options::DEBUGGING) {
         assert(FlowQuantity(use) >= 0.0);
@@ -751,90 +1179,85 @@ void PurchasingManager::debug_print_details() const {
 }
 
 template<typename T1, typename T2>
-static void print_row(T1 a, T2 b) {
-    std::cout << "      " << std::setw(14) << a << " = " << std::setw(14) << b << '\n';
+static void print_row(std::ostream& os, T1 a, T2 b) {
+    os << "      " << std::setw(14) << a << " = " << std::setw(14) << b << '\n';
 }
 
 template<typename T1, typename T2, typename T3>
-static void print_row(T1 a, T2 b, T3 c) {
-    std::cout << "      " << std::setw(14) << a << " = " << std::setw(14) << b << " (" << c << ")\n";
+static void print_row(std::ostream& os, T1 a, T2 b, T3 c) {
+    os << "      " << std::setw(14) << a << " = " << std::setw(14) << b << " (" << c << ")\n";
 }
 
 void PurchasingManager::debug_print_distribution(const std::vector<double>& demand_requests_D) const {
-    // if constexpr (options::DEBUGGING) {
-#pragma omp critical(output)
-    {
-        std::cout << model()->run()->timeinfo() << ", " << name() << ": demand distribution for " << purchasing_connections.size() << " inputs :\n";
-        FloatType purchasing_quantity = 0.0;
-        FloatType purchasing_value = 0.0;
-        FloatType initial_sum = 0.0;
-        std::vector<FloatType> last_demand_requests(purchasing_connections.size());
-        std::vector<FloatType> grad(purchasing_connections.size());
-
-        const auto obj = max_objective(&demand_requests_D[0], &grad[0]);
-        FloatType total_upper_bound = 0.0;
-        FloatType T_penalty = 0.0;
-        for (std::size_t r = 0; r < purchasing_connections.size(); ++r) {
-            const auto bc = purchasing_connections[r];
-            const auto D_r = unscaled_D_r(demand_requests_D[r], bc);
-            const auto lower_bound_D_r = unscaled_D_r(lower_bounds[r], bc);
-            const auto upper_bound_D_r = unscaled_D_r(upper_bounds[r], bc);
-            const auto X = to_float(bc->seller->communicated_parameters().production_X.get_quantity());
-            const auto X_hat = to_float(bc->seller->communicated_parameters().possible_production_X_hat.get_quantity());
-            const auto X_star = to_float(bc->seller->firm->initial_production_X_star().get_quantity());
-
-            total_upper_bound += X_hat;
-            const auto n_bar = to_float(bc->seller->communicated_parameters().offer_price_n_bar);
-            const auto n_r_l = n_r(D_r, bc);
-            const auto n_r_tc_l = transport_penalty(D_r, bc);
-            T_penalty += n_r_tc_l;
-            last_demand_requests[r] = to_float(bc->last_demand_request_D(this).get_quantity());
-
-            if constexpr (options::OPTIMIZATION_PROBLEMS_FATAL) {
-                std::cout << "      " << bc->name() << " :\n";
-                print_row("X", FlowQuantity(X));
-                print_row("X_star", FlowQuantity(X_star));
-                print_row("X_hat", FlowQuantity(X_hat));
-                print_row("n_bar", FlowQuantity(n_bar));
-                print_row("n_r(D_r)", FlowQuantity(n_r_l));
-                print_row("penalty_t", FlowQuantity(n_r_tc_l), scaled_objective(n_r_tc_l));
-                print_row("Z_last", bc->last_shipment_Z().get_quantity(), scaled_D_r(to_float(bc->last_shipment_Z().get_quantity()), bc));
-                print_row("D_star", bc->initial_flow_Z_star().get_quantity());
-                print_row("out_share", bc->initial_flow_Z_star() / bc->seller->firm->initial_production_X_star());
-                print_row("grad", grad[r]);
-                print_row("D_lower", FlowQuantity(lower_bound_D_r), scaled_D_r(lower_bound_D_r, bc));
-                print_row("D_r", FlowQuantity(D_r), scaled_D_r(D_r, bc));
-                print_row("D_upper", FlowQuantity(upper_bound_D_r), scaled_D_r(upper_bound_D_r, bc));
-                std::cout << '\n';
-            }
-            purchasing_quantity += D_r;
-            purchasing_value += n_r_l * D_r;
-            initial_sum += to_float(bc->initial_flow_Z_star().get_quantity());
-        }
-        const auto use = purchasing_quantity;
-        const auto transport_flow_deficit = get_flow_deficit();
-        FloatType S_shortage = to_float(transport_flow_deficit)
-                               + to_float((storage->initial_content_S_star().get_quantity() - storage->content_S().get_quantity()) / model()->delta_t());
-        FloatType n_r_bar = (purchasing_quantity > 0.0) ? purchasing_value / purchasing_quantity : 0.0;
-        std::cout << "      Storage :\n";
-        print_row("av. n_r", Price(n_r_bar));
-        print_row("S", storage->content_S().get_quantity());
-        print_row("S_star", storage->initial_content_S_star().get_quantity());
-        print_row("S_shortage", Quantity(S_shortage));
-        print_row("T_def", transport_flow_deficit, scaled_use(to_float(transport_flow_deficit)));
-        print_row("T_penalty", FlowValue(T_penalty), scaled_objective(T_penalty));
-        std::cout << "\n";
-
-        std::cout << "      Sums :\n";
-        print_row("X_hat", FlowQuantity(total_upper_bound));
-        print_row("D_orig", demand_D_.get_quantity());
-        print_row("purchase", FlowQuantity(purchasing_quantity), scaled_use(use));
-        print_row("D_star", FlowQuantity(initial_sum));
-        print_row("U_i", FlowQuantity(use), scaled_use(use));
-        print_row("obj", FlowValue(unscaled_objective(obj)), obj);
-        std::cout << "\n";
-    }
-    // }
+    std::ostringstream ss;
+    FloatType purchasing_quantity = 0.0;
+    FloatType purchasing_value = 0.0;
+    FloatType initial_sum = 0.0;
+    std::vector<FloatType> last_demand_requests(purchasing_connections.size());
+    std::vector<FloatType> grad(purchasing_connections.size());
+
+    const auto obj = max_objective(&demand_requests_D[0], &grad[0]);
+    FloatType total_upper_bound = 0.0;
+    FloatType T_penalty = 0.0;
+    for (std::size_t r = 0; r < purchasing_connections.size(); ++r) {
+        const auto bc = purchasing_connections[r];
+        const auto D_r = unscaled_D_r(demand_requests_D[r], bc);
+        const auto lower_bound_D_r = unscaled_D_r(lower_bounds[r], bc);
+        const auto upper_bound_D_r = unscaled_D_r(upper_bounds[r], bc);
+        const auto X = to_float(bc->seller->communicated_parameters().production_X.get_quantity());
+        const auto X_hat = to_float(bc->seller->communicated_parameters().possible_production_X_hat.get_quantity());
+        const auto X_star = to_float(bc->seller->firm->initial_production_X_star().get_quantity());
+
+        total_upper_bound += X_hat;
+        const auto n_bar = to_float(bc->seller->communicated_parameters().offer_price_n_bar);
+        const auto n_r_l = n_r(D_r, suppliers[r]);
+        const auto n_r_tc_l = transport_penalty(D_r, suppliers[r]);
+        T_penalty += n_r_tc_l;
+        last_demand_requests[r] = to_float(bc->last_demand_request_D(this).get_quantity());
+
+        if constexpr (options::OPTIMIZATION_PROBLEMS_FATAL) {
+            ss << "      " << bc->name() << " :\n";
+            print_row(ss, "X", FlowQuantity(X));
+            print_row(ss, "X_star", FlowQuantity(X_star));
+            print_row(ss, "X_hat", FlowQuantity(X_hat));
+            print_row(ss, "n_bar", FlowQuantity(n_bar));
+            print_row(ss, "n_r(D_r)", FlowQuantity(n_r_l));
+            print_row(ss, "penalty_t", FlowQuantity(n_r_tc_l), scaled_objective(n_r_tc_l));
+            print_row(ss, "Z_last", bc->last_shipment_Z().get_quantity(), scaled_D_r(to_float(bc->last_shipment_Z().get_quantity()), bc));
+            print_row(ss, "D_star", bc->initial_flow_Z_star().get_quantity());
+            print_row(ss, "out_share", bc->initial_flow_Z_star() / bc->seller->firm->initial_production_X_star());
+            print_row(ss, "grad", grad[r]);
+            print_row(ss, "D_lower", FlowQuantity(lower_bound_D_r), scaled_D_r(lower_bound_D_r, bc));
+            print_row(ss, "D_r", FlowQuantity(D_r), scaled_D_r(D_r, bc));
+            print_row(ss, "D_upper", FlowQuantity(upper_bound_D_r), scaled_D_r(upper_bound_D_r, bc));
+            ss << '\n';
+        }
+        purchasing_quantity += D_r;
+        purchasing_value += n_r_l * D_r;
+        initial_sum += to_float(bc->initial_flow_Z_star().get_quantity());
+    }
+    const auto use = purchasing_quantity;
+    const auto transport_flow_deficit = get_flow_deficit();
+    FloatType S_shortage = to_float(transport_flow_deficit)
+                           + to_float((storage->initial_content_S_star().get_quantity() - storage->content_S().get_quantity()) / model()->delta_t());
+    FloatType n_r_bar = (purchasing_quantity > 0.0) ? purchasing_value / purchasing_quantity : 0.0;
+    ss << "      Storage :\n";
+    print_row(ss, "av. n_r", Price(n_r_bar));
+    print_row(ss, "S", storage->content_S().get_quantity());
+    print_row(ss, "S_star", storage->initial_content_S_star().get_quantity());
+    print_row(ss, "S_shortage", Quantity(S_shortage));
+    print_row(ss, "T_def", transport_flow_deficit, scaled_use(to_float(transport_flow_deficit)));
+    print_row(ss, "T_penalty", FlowValue(T_penalty), scaled_objective(T_penalty));
+    ss << "\n";
+
+    ss << "      Sums :\n";
+    print_row(ss, "X_hat", FlowQuantity(total_upper_bound));
+    print_row(ss, "D_orig", demand_D_.get_quantity());
+    print_row(ss, "purchase", FlowQuantity(purchasing_quantity), scaled_use(use));
+    print_row(ss, "D_star", FlowQuantity(initial_sum));
+    print_row(ss, "U_i", FlowQuantity(use), scaled_use(use));
+    print_row(ss, "obj", FlowValue(unscaled_objective(obj)), obj);
+    log::print(this, "demand distribution for ", purchasing_connections.size(), " inputs :\n", ss.str());
 }
 
 }  // namespace acclimate
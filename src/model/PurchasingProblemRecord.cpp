@@ -0,0 +1,436 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "model/PurchasingProblemRecord.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <utility>
+
+#include "model/ConsumptionUtility.h"
+#include "optimization.h"
+
+namespace acclimate {
+
+namespace {
+
+// the purchasing problem as seen by the optimizer, with the same scaling as in PurchasingManager
+class RecordedPurchasingProblem {
+  private:
+    const PurchasingProblemRecord& record;
+    std::vector<purchasing::PreparedSupplier> suppliers;
+
+  public:
+    std::uint64_t evaluations = 0;
+
+    explicit RecordedPurchasingProblem(const PurchasingProblemRecord& record_p) : record(record_p) {
+        suppliers.reserve(record.suppliers.size());
+        for (const auto& supplier : record.suppliers) {
+            suppliers.emplace_back(supplier, record.parameters);
+        }
+    }
+
+    FloatType equality_constraint(const double* x, double* grad) const {
+        FloatType use = 0.0;
+        for (std::size_t r = 0; r < record.suppliers.size(); ++r) {
+            use += x[r] * record.suppliers[r].initial_flow_Z_star;
+            if (grad != nullptr) {
+                grad[r] = -record.suppliers[r].initial_flow_Z_star / record.initial_used_flow_U_star;
+            }
+        }
+        return (record.desired_purchase - use) / record.initial_used_flow_U_star;
+    }
+
+    FloatType max_objective(const double* x, double* grad) {
+        ++evaluations;
+        FloatType costs = 0.0;
+        for (std::size_t r = 0; r < suppliers.size(); ++r) {
+            const auto& supplier = suppliers[r];
+            const auto D_r = x[r] * supplier.initial_flow_Z_star;
+            costs += purchasing::costs(D_r, supplier, record.parameters);
+            if (grad != nullptr) {
+                grad[r] = -supplier.initial_flow_Z_star * purchasing::marginal_costs_m_r(D_r, supplier, record.parameters) / record.initial_used_flow_U_star;
+            }
+        }
+        return -costs / record.initial_used_flow_U_star;
+    }
+};
+
+// the utility maximization as seen by the optimizer, with the same scaling as in Consumer
+class RecordedConsumptionProblem {
+  private:
+    const ConsumptionProblemRecord& record;
+    std::vector<std::vector<int>> basket_indices;
+    std::vector<FloatType> basket_sums;
+    std::vector<FloatType> basket_utilities;
+
+  public:
+    std::uint64_t evaluations = 0;
+
+    explicit RecordedConsumptionProblem(const ConsumptionProblemRecord& record_p)
+        : record(record_p),
+          basket_indices(record_p.basket_share_factors.size()),
+          basket_sums(record_p.basket_share_factors.size()),
+          basket_utilities(record_p.basket_share_factors.size()) {
+        for (std::size_t i = 0; i < record.baskets.size(); ++i) {
+            if (record.baskets[i] != ConsumptionProblemRecord::NO_BASKET) {
+                basket_indices[record.baskets[i]].push_back(static_cast<int>(i));
+            }
+        }
+    }
+
+    FloatType inequality_constraint(const double* x, double* grad) const {
+        return consumption::budget_constraint(x, grad, record.prices.size(), record.baseline_quantities, record.prices, record.budget, record.budget_share,
+                                              record.linear_budget_constraint);
+    }
+
+    FloatType equality_constraint(const double* x, double* grad) const { return inequality_constraint(x, grad); }
+
+    FloatType max_objective(const double* x, double* grad) {
+        ++evaluations;
+        return consumption::nested_CES_utility(x, grad, record.baskets.size(), basket_indices, record.share_factors, record.exponent_share_factors,
+                                               record.intra_basket_substitution_exponent, record.basket_share_factors,
+                                               record.exponent_basket_share_factors, record.inter_basket_substitution_exponent, basket_sums,
+                                               basket_utilities);
+    }
+};
+
+template<typename T>
+void write_value(std::ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void read_value(std::istream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+template<typename T>
+void write_vector(std::ostream& out, const std::vector<T>& v) {
+    out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+template<typename T>
+void read_vector(std::istream& in, std::vector<T>& v, std::size_t n) {
+    v.resize(n);
+    in.read(reinterpret_cast<char*>(v.data()), n * sizeof(T));
+}
+
+void write_string(std::ostream& out, const std::string& s) {
+    write_value(out, static_cast<std::uint64_t>(s.size()));
+    out.write(s.data(), s.size());
+}
+
+void read_string(std::istream& in, std::string& s) {
+    std::uint64_t size = 0;
+    read_value(in, size);
+    if (!in || size > PurchasingProblemRecord::MAX_NAME_LENGTH) {
+        throw log::error("Invalid problem record: name length ", size);
+    }
+    s.resize(size);
+    in.read(&s[0], size);
+}
+
+std::size_t read_dimension(std::istream& in, const std::string& name) {
+    std::uint64_t size = 0;
+    read_value(in, size);
+    if (!in || size > PurchasingProblemRecord::MAX_DIMENSION) {
+        throw log::error("Invalid problem record '", name, "': dimension ", size);
+    }
+    return size;
+}
+
+template<typename Problem>
+void replay(Problem& problem,
+            const char* label,
+            int algorithm,
+            const std::vector<double>& start,
+            const std::vector<double>& lower_bounds,
+            const std::vector<double>& upper_bounds,
+            const std::vector<double>& xtol_abs,
+            int maxeval,
+            bool deterministic,
+            double scale,
+            const std::function<void(optimization::Optimization&)>& add_constraint) {
+    auto x = start;
+    std::string result;
+    FloatType optimized_value = 0.0;
+    const auto t0 = std::chrono::steady_clock::now();
+    try {
+        optimization::Optimization opt(static_cast<nlopt_algorithm>(algorithm), start.size());
+        add_constraint(opt);
+        opt.add_max_objective(&problem);
+        opt.xtol(xtol_abs);
+        opt.lower_bounds(lower_bounds);
+        opt.upper_bounds(upper_bounds);
+        if (deterministic) {
+            opt.evaluation_budget(maxeval);  // after xtol, which the budget stages are derived from
+        } else {
+            opt.maxeval(maxeval);
+        }
+        opt.optimize(x);
+        result = opt.last_result_description();
+        optimized_value = opt.optimized_value() * scale;
+    } catch (const optimization::failure& ex) {
+        result = ex.what();
+    }
+    const auto t1 = std::chrono::steady_clock::now();
+    std::cout << "    " << label << ": " << result << ", " << problem.evaluations << " evaluations in "
+              << std::chrono::duration<FloatType, std::milli>(t1 - t0).count() << " ms, objective " << optimized_value << '\n';
+}
+
+std::vector<std::pair<std::string, int>> replay_runs(int recorded_algorithm, const std::vector<std::string>& algorithms) {
+    std::vector<std::pair<std::string, int>> runs;
+    if (algorithms.empty()) {
+        runs.emplace_back("recorded", recorded_algorithm);
+    } else {
+        for (const auto& algorithm : algorithms) {
+            runs.emplace_back(algorithm, optimization::get_algorithm(hashed_string(algorithm)));
+        }
+    }
+    return runs;
+}
+
+}  // namespace
+
+void PurchasingProblemRecord::write_header(std::ostream& out) { out.write(MAGIC.data(), MAGIC.size()); }
+
+bool PurchasingProblemRecord::read_header(std::istream& in) {
+    std::array<char, 8> magic = {};
+    in.read(magic.data(), magic.size());
+    return in && magic == MAGIC;
+}
+
+bool PurchasingProblemRecord::read_kind(std::istream& in, ProblemKind& kind) {
+    std::uint8_t value = 0;
+    read_value(in, value);
+    if (!in) {
+        return false;
+    }
+    if (value > static_cast<std::uint8_t>(ProblemKind::CONSUMPTION)) {
+        throw log::error("Invalid problem record: kind ", static_cast<int>(value));
+    }
+    kind = static_cast<ProblemKind>(value);
+    return true;
+}
+
+void PurchasingProblemRecord::write(std::ostream& out) const {
+    write_value(out, static_cast<std::uint8_t>(ProblemKind::PURCHASING));
+    write_string(out, name);
+    write_value(out, static_cast<std::uint64_t>(timestep));
+    write_value(out, static_cast<std::int32_t>(algorithm));
+    write_value(out, static_cast<std::int32_t>(maxeval));
+    write_value(out, static_cast<std::uint8_t>(deterministic));
+    write_value(out, static_cast<std::uint8_t>(global));
+    write_value(out, static_cast<std::uint8_t>(batched));
+    write_value(out, desired_purchase);
+    write_value(out, initial_used_flow_U_star);
+    write_value(out, static_cast<std::uint8_t>(parameters.quadratic_transport_penalty));
+    write_value(out, static_cast<std::uint8_t>(parameters.relative_transport_penalty));
+    write_value(out, static_cast<std::uint8_t>(parameters.maximal_decrease_reservation_price_limited_by_markup));
+    write_value(out, parameters.initial_markup);
+    write_value(out, to_float(parameters.transport_penalty_large));
+    write_value(out, to_float(parameters.transport_penalty_small));
+    write_value(out, evaluations);
+    write_value(out, seconds);
+    write_value(out, optimized_value);
+    write_value(out, static_cast<std::uint64_t>(suppliers.size()));
+    write_vector(out, suppliers);
+    for (const auto* v : {&lower_bounds, &upper_bounds, &xtol_abs, &start, &solution}) {
+        write_vector(out, *v);
+    }
+}
+
+void PurchasingProblemRecord::read(std::istream& in) {
+    read_string(in, name);
+    std::uint64_t timestep_value = 0;
+    read_value(in, timestep_value);
+    timestep = timestep_value;
+    std::int32_t int_value = 0;
+    read_value(in, int_value);
+    algorithm = int_value;
+    read_value(in, int_value);
+    maxeval = int_value;
+    std::uint8_t flag = 0;
+    read_value(in, flag);
+    deterministic = flag != 0;
+    read_value(in, flag);
+    global = flag != 0;
+    read_value(in, flag);
+    batched = flag != 0;
+    read_value(in, desired_purchase);
+    read_value(in, initial_used_flow_U_star);
+    read_value(in, flag);
+    parameters.quadratic_transport_penalty = flag != 0;
+    read_value(in, flag);
+    parameters.relative_transport_penalty = flag != 0;
+    read_value(in, flag);
+    parameters.maximal_decrease_reservation_price_limited_by_markup = flag != 0;
+    read_value(in, parameters.initial_markup);
+    FloatType price = 0.0;
+    read_value(in, price);
+    parameters.transport_penalty_large = Price(price);
+    read_value(in, price);
+    parameters.transport_penalty_small = Price(price);
+    read_value(in, evaluations);
+    read_value(in, seconds);
+    read_value(in, optimized_value);
+    const auto size = read_dimension(in, name);
+    read_vector(in, suppliers, size);
+    for (auto* v : {&lower_bounds, &upper_bounds, &xtol_abs, &start, &solution}) {
+        read_vector(in, *v, size);
+    }
+    if (!in) {
+        throw log::error("Truncated purchasing problem record '", name, "'");
+    }
+}
+
+void ConsumptionProblemRecord::write(std::ostream& out) const {
+    write_value(out, static_cast<std::uint8_t>(ProblemKind::CONSUMPTION));
+    write_string(out, name);
+    write_value(out, static_cast<std::uint64_t>(timestep));
+    write_value(out, static_cast<std::int32_t>(algorithm));
+    write_value(out, static_cast<std::int32_t>(maxeval));
+    write_value(out, static_cast<std::uint8_t>(deterministic));
+    write_value(out, static_cast<std::uint8_t>(inequality_constrained));
+    write_value(out, static_cast<std::uint8_t>(linear_budget_constraint));
+    write_value(out, static_cast<std::uint8_t>(global));
+    write_value(out, budget);
+    write_value(out, budget_share);
+    write_value(out, inter_basket_substitution_exponent);
+    write_value(out, evaluations);
+    write_value(out, seconds);
+    write_value(out, optimized_value);
+    write_value(out, static_cast<std::uint64_t>(basket_share_factors.size()));
+    for (const auto* v : {&intra_basket_substitution_exponent, &basket_share_factors, &exponent_basket_share_factors}) {
+        write_vector(out, *v);
+    }
+    write_value(out, static_cast<std::uint64_t>(baskets.size()));
+    write_vector(out, baskets);
+    for (const auto* v : {&share_factors, &exponent_share_factors, &baseline_quantities, &prices}) {
+        write_vector(out, *v);
+    }
+    for (const auto* v : {&lower_bounds, &upper_bounds, &xtol_abs, &start, &solution}) {
+        write_vector(out, *v);
+    }
+}
+
+void ConsumptionProblemRecord::read(std::istream& in) {
+    read_string(in, name);
+    std::uint64_t timestep_value = 0;
+    read_value(in, timestep_value);
+    timestep = timestep_value;
+    std::int32_t int_value = 0;
+    read_value(in, int_value);
+    algorithm = int_value;
+    read_value(in, int_value);
+    maxeval = int_value;
+    std::uint8_t flag = 0;
+    read_value(in, flag);
+    deterministic = flag != 0;
+    read_value(in, flag);
+    inequality_constrained = flag != 0;
+    read_value(in, flag);
+    linear_budget_constraint = flag != 0;
+    read_value(in, flag);
+    global = flag != 0;
+    read_value(in, budget);
+    read_value(in, budget_share);
+    read_value(in, inter_basket_substitution_exponent);
+    read_value(in, evaluations);
+    read_value(in, seconds);
+    read_value(in, optimized_value);
+    const auto basket_count = read_dimension(in, name);
+    for (auto* v : {&intra_basket_substitution_exponent, &basket_share_factors, &exponent_basket_share_factors}) {
+        read_vector(in, *v, basket_count);
+    }
+    const auto size = read_dimension(in, name);
+    read_vector(in, baskets, size);
+    for (auto* v : {&share_factors, &exponent_share_factors, &baseline_quantities, &prices}) {
+        read_vector(in, *v, size);
+    }
+    for (auto* v : {&lower_bounds, &upper_bounds, &xtol_abs, &start, &solution}) {
+        read_vector(in, *v, size);
+    }
+    if (!in) {
+        throw log::error("Truncated consumption problem record '", name, "'");
+    }
+    for (const auto basket : baskets) {
+        if (basket >= basket_count && basket != NO_BASKET) {
+            throw log::error("Invalid consumption problem record '", name, "': basket ", basket, " of ", basket_count);
+        }
+    }
+}
+
+void replay_optimization_problems(const std::string& filename, const std::vector<std::string>& algorithms) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        throw log::error("Could not open ", filename);
+    }
+    if (!PurchasingProblemRecord::read_header(in)) {
+        throw log::error(filename, " is not a problem record file");
+    }
+    ProblemKind kind;
+    PurchasingProblemRecord purchasing_record;
+    ConsumptionProblemRecord consumption_record;
+    while (PurchasingProblemRecord::read_kind(in, kind)) {
+        if (kind == ProblemKind::PURCHASING) {
+            const auto& record = purchasing_record;
+            purchasing_record.read(in);
+            std::cout << record.name << " (timestep " << record.timestep << ", " << record.suppliers.size() << " inputs"
+                      << (record.global ? ", global in run" : "") << (record.batched ? ", batched in run" : "") << "): " << record.evaluations
+                      << " evaluations in " << record.seconds * 1000 << " ms, objective " << record.optimized_value << '\n';
+            for (const auto& [label, algorithm] : replay_runs(record.algorithm, algorithms)) {
+                RecordedPurchasingProblem problem(record);
+                replay(problem, label.c_str(), algorithm, record.start, record.lower_bounds, record.upper_bounds, record.xtol_abs, record.maxeval,
+                       record.deterministic, record.initial_used_flow_U_star,
+                       [&problem](optimization::Optimization& opt) { opt.add_equality_constraint(&problem, FlowQuantity::precision); });
+            }
+        } else {
+            const auto& record = consumption_record;
+            consumption_record.read(in);
+            std::cout << record.name << " (timestep " << record.timestep << ", " << record.baskets.size() << " goods"
+                      << (record.global ? ", global in run" : "") << (record.linear_budget_constraint ? ", linear budget" : "")
+                      << "): " << record.evaluations << " evaluations in " << record.seconds * 1000 << " ms, utility " << record.optimized_value << '\n';
+            for (const auto& [label, algorithm] : replay_runs(record.algorithm, algorithms)) {
+                RecordedConsumptionProblem problem(record);
+                const bool inequality_constrained = record.inequality_constrained;
+                replay(problem, label.c_str(), algorithm, record.start, record.lower_bounds, record.upper_bounds, record.xtol_abs, record.maxeval,
+                       record.deterministic, 1.0,
+                       [&problem, inequality_constrained](optimization::Optimization& opt) {
+                           if (inequality_constrained) {
+                               opt.add_inequality_constraint(&problem, FlowValue::precision);
+                           } else {
+                               opt.add_equality_constraint(&problem, FlowValue::precision);
+                           }
+                       });
+            }
+        }
+    }
+    std::cout << std::flush;
+}
+
+}  // namespace acclimate
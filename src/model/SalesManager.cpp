@@ -23,9 +23,10 @@
 #include <algorithm>
 #include <cmath>
 #include <iomanip>
-#include <iostream>
 #include <iterator>
 #include <numeric>
+#include <sstream>
+#include <vector>
 
 #include "ModelRun.h"
 #include "acclimate.h"
@@ -36,7 +37,9 @@
 #include "model/PurchasingManager.h"
 #include "model/Sector.h"
 #include "model/Storage.h"
+#include "openmp.h"
 #include "parameters.h"
+#include "rootfinding.h"
 
 namespace acclimate {
 
@@ -89,42 +92,71 @@ SalesManager::~SalesManager() {
 Model* SalesManager::model() { return firm->model(); }
 const Model* SalesManager::model() const { return firm->model(); }
 
-std::string SalesManager::name() const { return firm->name(); }
+const std::string& SalesManager::name() const { return firm->name(); }
 
 const Demand& SalesManager::sum_demand_requests_D() const {
     debug::assertstepnot(this, IterationStep::PURCHASE);
     return sum_demand_requests_D_;
 }
 
+// ordering of incoming connections by price (descending), then by quantity (descending), empty demand requests last
+static bool demand_request_before(const std::shared_ptr<BusinessConnection>& business_connection_1,
+                                  const std::shared_ptr<BusinessConnection>& business_connection_2) {
+    if (business_connection_1->last_demand_request_D().get_quantity() <= 0.0 && business_connection_2->last_demand_request_D().get_quantity() > 0.0) {
+        // we want to store empty demand requests at the end of the business connections
+        return false;
+    }
+    if (business_connection_1->last_demand_request_D().get_quantity() > 0.0 && business_connection_2->last_demand_request_D().get_quantity() <= 0.0) {
+        return true;
+    }
+    if (business_connection_1->last_demand_request_D().get_quantity() <= 0.0 && business_connection_2->last_demand_request_D().get_quantity() <= 0.0) {
+        // both are empty --> ordering does not matter
+        return false;
+    }
+    if (business_connection_1->last_demand_request_D().get_price() > business_connection_2->last_demand_request_D().get_price()) {
+        return true;
+    }
+    if (business_connection_1->last_demand_request_D().get_price() < business_connection_2->last_demand_request_D().get_price()) {
+        return false;
+    }
+    // none of them is empty, but prices are equal
+    return (business_connection_1->last_demand_request_D().get_quantity() > business_connection_2->last_demand_request_D().get_quantity());
+}
+
+// connections keep their order from the previous timestep, in which most of them are still sorted as demand requests change only little, so
+// only connections out of order are moved to their place (binary insertion); falls back to a full sort if too many are out of order
+static void sort_business_connections(std::vector<std::shared_ptr<BusinessConnection>>& business_connections) {
+    const auto begin = std::begin(business_connections);
+    const auto end = std::end(business_connections);
+    std::size_t out_of_order = 0;
+    for (auto it = std::next(begin); it < end; ++it) {
+        if (demand_request_before(*it, *std::prev(it))) {
+            ++out_of_order;
+        }
+    }
+    if (out_of_order == 0) {
+        return;
+    }
+    if (out_of_order > business_connections.size() / 16 + 1) {
+        std::stable_sort(begin, end, demand_request_before);
+        return;
+    }
+    for (auto it = std::next(begin); it < end; ++it) {
+        if (demand_request_before(*it, *std::prev(it))) {
+            // insert after all connections not ordered after it to keep equal ones in their previous order
+            std::rotate(std::upper_bound(begin, it, *it, demand_request_before), it, std::next(it));
+        }
+    }
+}
+
 Flow SalesManager::calc_production_X() {
     debug::assertstep(this, IterationStep::CONSUMPTION_AND_PRODUCTION);
     assert(!business_connections.empty());
     sum_demand_requests_D_ = round(sum_demand_requests_D_);
 
-    // sort all incoming connections by price (descending), then by quantity (descending)
-    std::sort(
-        business_connections.begin(), business_connections.end(),
-        [](const std::shared_ptr<BusinessConnection>& business_connection_1, const std::shared_ptr<BusinessConnection>& business_connection_2) {
-            if (business_connection_1->last_demand_request_D().get_quantity() <= 0.0 && business_connection_2->last_demand_request_D().get_quantity() > 0.0) {
-                // we want to store empty demand requests at the end of the business connections
-                return false;
-            }
-            if (business_connection_1->last_demand_request_D().get_quantity() > 0.0 && business_connection_2->last_demand_request_D().get_quantity() <= 0.0) {
-                return true;
-            }
-            if (business_connection_1->last_demand_request_D().get_quantity() <= 0.0 && business_connection_2->last_demand_request_D().get_quantity() <= 0.0) {
-                // both are empty --> ordering does not matter
-                return false;
-            }
-            if (business_connection_1->last_demand_request_D().get_price() > business_connection_2->last_demand_request_D().get_price()) {
-                return true;
-            }
-            if (business_connection_1->last_demand_request_D().get_price() < business_connection_2->last_demand_request_D().get_price()) {
-                return false;
-            }
-            // none of them is empty, but prices are equal
-            return (business_connection_1->last_demand_request_D().get_quantity() > business_connection_2->last_demand_request_D().get_quantity());
-        });
+    sort_business_connections(business_connections);
+    demand_book.assign(std::begin(business_connections), std::end(business_connections),
+                       [](const std::shared_ptr<BusinessConnection>& bc) -> const Demand& { return bc->last_demand_request_D(); });
 
     Flow possible_production_X_hat = firm->capacity_manager->possible_production_X_hat();
     if (estimated_possible_production_X_hat_.get_quantity() > 0.0) {
@@ -140,11 +172,12 @@ Flow SalesManager::calc_production_X() {
 void SalesManager::distribute() {
     debug::assertstep(this, IterationStep::CONSUMPTION_AND_PRODUCTION);
     assert(!business_connections.empty());
+    // hub firms push their flows as tasks, pushing to different connections is independent (storages and regions lock on their own)
+    const bool parallel_connections = model()->parallelize_connections(business_connections.size());
     // push all flows
     if (communicated_parameters_.production_X.get_quantity() <= 0.0) {  // no production
-        for (auto& not_served_bc : business_connections) {
-            not_served_bc->push_flow_Z(Flow(0.0));
-        }
+        openmp::for_each_index(0, business_connections.size(), parallel_connections,
+                               [this](std::size_t i) { business_connections[i]->push_flow_Z(Flow(0.0)); });
     } else {                            // non-zero production to distribute
         unsigned int pushed_flows = 0;  // only used when debugging
         assert(!isnan(supply_distribution_scenario.price_cheapest_buyer_accepted_in_optimization));
@@ -157,42 +190,56 @@ void SalesManager::distribute() {
         } else {
             cheapest_price_range_half_width = model()->parameters().cheapest_price_range_width / 2;
         }
-        auto begin_cheapest_price_range = business_connections.begin();
-        auto end_cheapest_price_range = business_connections.begin();
+        enum class price_range_t { ABOVE, CHEAPEST, BELOW };  // BELOW also for zero demand requests
+        const auto price_range = [&](const BusinessConnection* bc) {
+            if (bc->last_demand_request_D().get_quantity() > 0.0) {
+                if (round(bc->last_demand_request_D().get_price() - supply_distribution_scenario.price_cheapest_buyer_accepted_in_optimization)
+                    >= cheapest_price_range_half_width) {
+                    return price_range_t::ABOVE;
+                }
+                if (abs(round(bc->last_demand_request_D().get_price() - supply_distribution_scenario.price_cheapest_buyer_accepted_in_optimization))
+                    < cheapest_price_range_half_width) {
+                    return price_range_t::CHEAPEST;
+                }
+            }
+            return price_range_t::BELOW;
+        };
+        std::size_t begin_cheapest_price_range = 0;
+        std::size_t end_cheapest_price_range = 0;
         auto demand_cheapest_price_range = FlowQuantity(0.0);
         auto demand_value_cheapest_price_range = FlowValue(0.0);
         Flow production_without_cheapest_price_range = Flow(0.0);
-        for (auto served_bc = business_connections.begin(); served_bc != business_connections.end(); ++served_bc) {
-            if ((*served_bc)->last_demand_request_D().get_quantity() > 0.0) {
-                if (round((*served_bc)->last_demand_request_D().get_price() - supply_distribution_scenario.price_cheapest_buyer_accepted_in_optimization)
-                    >= cheapest_price_range_half_width) {  // price higher than in cheapest price range
-                    assert((*served_bc)->last_demand_request_D().get_quantity() <= communicated_parameters_.production_X.get_quantity());
-                    (*served_bc)->push_flow_Z(round((*served_bc)->last_demand_request_D()));
-                    production_without_cheapest_price_range += round((*served_bc)->last_demand_request_D());
-                    if constexpr (options::DEBUGGING) {
-                        ++pushed_flows;
-                    }
-                    begin_cheapest_price_range = served_bc + 1;
-                } else if (abs(round((*served_bc)->last_demand_request_D().get_price()
-                                     - supply_distribution_scenario.price_cheapest_buyer_accepted_in_optimization))
-                           < cheapest_price_range_half_width) {  // price in cheapest price range
-                    demand_cheapest_price_range += (*served_bc)->last_demand_request_D().get_quantity();
-                    demand_value_cheapest_price_range += (*served_bc)->last_demand_request_D().get_value();
-                    // flow is pushed later
-                    end_cheapest_price_range = served_bc + 1;
-                } else {  // price lower than in cheapest price range
-                    (*served_bc)->push_flow_Z(Flow(0.0));
-                    if constexpr (options::DEBUGGING) {
-                        ++pushed_flows;
-                    }
-                }
-            } else {  // demand request is zero
-                (*served_bc)->push_flow_Z(Flow(0.0));
-                if constexpr (options::DEBUGGING) {
-                    ++pushed_flows;
-                }
+        for (std::size_t i = 0; i < business_connections.size(); ++i) {
+            const auto& served_bc = business_connections[i];
+            switch (price_range(served_bc.get())) {
+                case price_range_t::ABOVE:  // price higher than in cheapest price range
+                    assert(served_bc->last_demand_request_D().get_quantity() <= communicated_parameters_.production_X.get_quantity());
+                    production_without_cheapest_price_range += round(served_bc->last_demand_request_D());
+                    begin_cheapest_price_range = i + 1;
+                    break;
+                case price_range_t::CHEAPEST:  // price in cheapest price range, flow is pushed later
+                    demand_cheapest_price_range += served_bc->last_demand_request_D().get_quantity();
+                    demand_value_cheapest_price_range += served_bc->last_demand_request_D().get_value();
+                    end_cheapest_price_range = i + 1;
+                    break;
+                case price_range_t::BELOW:  // price lower than in cheapest price range or demand request is zero
+                    break;
             }
         }
+        pushed_flows += openmp::sum_over_indices<unsigned int>(0, business_connections.size(), parallel_connections, [&](std::size_t i) {
+            const auto& served_bc = business_connections[i];
+            switch (price_range(served_bc.get())) {
+                case price_range_t::ABOVE:
+                    served_bc->push_flow_Z(round(served_bc->last_demand_request_D()));
+                    return 1U;
+                case price_range_t::CHEAPEST:
+                    return 0U;
+                case price_range_t::BELOW:
+                    served_bc->push_flow_Z(Flow(0.0));
+                    return 1U;
+            }
+            return 0U;
+        });
         if (begin_cheapest_price_range < end_cheapest_price_range) {
             const FlowQuantity production_cheapest_price_range =
                 round(communicated_parameters_.production_X.get_quantity() - production_without_cheapest_price_range.get_quantity());
@@ -211,31 +258,30 @@ void SalesManager::distribute() {
                 const Price price_as_calculated_in_distribution_scenario =
                     (communicated_parameters_.production_X.get_value() - production_without_cheapest_price_range.get_value()) / production_cheapest_price_range;
 
-                total_revenue_R_ = production_without_cheapest_price_range.get_value();
                 // serve demand requests in equal distribution range
-                for (auto served_bc = begin_cheapest_price_range; served_bc != end_cheapest_price_range; ++served_bc) {
+                std::vector<FlowValue> revenues(end_cheapest_price_range - begin_cheapest_price_range);
+                openmp::for_each_index(begin_cheapest_price_range, end_cheapest_price_range, parallel_connections, [&](std::size_t i) {
+                    const auto& served_bc = business_connections[i];
                     Flow flow_Z = Flow(round(FlowQuantity(to_float(production_cheapest_price_range)
-                                                          * to_float((*served_bc)->last_demand_request_D().get_quantity() * price_shift
-                                                                     + (*served_bc)->last_demand_request_D().get_value())
+                                                          * to_float(served_bc->last_demand_request_D().get_quantity() * price_shift
+                                                                     + served_bc->last_demand_request_D().get_value())
                                                           / to_float(demand_cheapest_price_range * price_shift + demand_value_cheapest_price_range))),
                                        model()->parameters().cheapest_price_range_preserve_seller_price ? price_as_calculated_in_distribution_scenario
-                                                                                                        : (*served_bc)->last_demand_request_D().get_price());
-                    assert(flow_Z.get_quantity() <= (*served_bc)->last_demand_request_D().get_quantity());
-                    (*served_bc)->push_flow_Z(flow_Z);
-                    total_revenue_R_ += flow_Z.get_value();
-                    if constexpr (options::DEBUGGING) {
-                        ++pushed_flows;
-                    }
-                }
+                                                                                                        : served_bc->last_demand_request_D().get_price());
+                    assert(flow_Z.get_quantity() <= served_bc->last_demand_request_D().get_quantity());
+                    served_bc->push_flow_Z(flow_Z);
+                    revenues[i - begin_cheapest_price_range] = flow_Z.get_value();
+                });
+                pushed_flows += static_cast<unsigned int>(end_cheapest_price_range - begin_cheapest_price_range);
+                total_revenue_R_ = std::accumulate(std::begin(revenues), std::end(revenues), production_without_cheapest_price_range.get_value());
             } else {  // all demands in cheapest price range can be fulfilled
                 total_revenue_R_ = communicated_parameters_.production_X.get_value();
-                for (auto served_bc = begin_cheapest_price_range; served_bc != end_cheapest_price_range; ++served_bc) {
-                    assert((*served_bc)->last_demand_request_D().get_quantity() <= communicated_parameters_.production_X.get_quantity());
-                    (*served_bc)->push_flow_Z(round((*served_bc)->last_demand_request_D()));
-                    if constexpr (options::DEBUGGING) {
-                        ++pushed_flows;
-                    }
-                }
+                openmp::for_each_index(begin_cheapest_price_range, end_cheapest_price_range, parallel_connections, [&](std::size_t i) {
+                    const auto& served_bc = business_connections[i];
+                    assert(served_bc->last_demand_request_D().get_quantity() <= communicated_parameters_.production_X.get_quantity());
+                    served_bc->push_flow_Z(round(served_bc->last_demand_request_D()));
+                });
+                pushed_flows += static_cast<unsigned int>(end_cheapest_price_range - begin_cheapest_price_range);
             }
         } else {
             total_revenue_R_ = communicated_parameters_.production_X.get_value();
@@ -250,15 +296,24 @@ void SalesManager::distribute() {
     }
 }
 
+std::tuple<Flow, bool> SalesManager::serve_demand_requests(const Flow& possible_production_X_hat_p,
+                                                           const Price& minimal_production_price,
+                                                           const Price& minimal_extension_price) {
+    // shared by actual and expected supply distribution, both serve the demand book taken in calc_production_X
+    assert(demand_book.size() <= business_connections.size());
+    const auto served = sales::serve(demand_book, possible_production_X_hat_p.get_quantity(), firm->forced_initial_production_quantity_lambda_X_star(),
+                                     minimal_production_price, minimal_extension_price,
+                                     [this](const FlowQuantity& production_quantity_X, const Price& unit_production_costs_n_c) {
+                                         return calc_marginal_production_costs(production_quantity_X, unit_production_costs_n_c);
+                                     });
+    supply_distribution_scenario.connection_not_served_completely = std::begin(business_connections) + served.count;
+    assert(!served.all || served.production_X.get_quantity() <= possible_production_X_hat_p.get_quantity());
+    return std::make_tuple(served.production_X, served.all);
+}
+
 std::tuple<Flow, Price> SalesManager::calc_supply_distribution_scenario(const Flow& possible_production_X_hat_p) {
     debug::assertstep(this, IterationStep::CONSUMPTION_AND_PRODUCTION);
 
-    // find first (in order) connection with zero demand
-    auto first_zero_connection = std::find_if(std::begin(business_connections), std::end(business_connections), [](const auto& business_connection) {
-        return business_connection->last_demand_request_D().get_quantity() <= 0.0;
-    });
-
-    supply_distribution_scenario.connection_not_served_completely = first_zero_connection;
     total_production_costs_C_ = FlowValue(0.0);
     Price minimal_production_price = round(possible_production_X_hat_p.get_price());
     Price minimal_offer_price = round(minimal_production_price + get_initial_markup() / (1 - tax_));
@@ -276,12 +331,12 @@ std::tuple<Flow, Price> SalesManager::calc_supply_distribution_scenario(const Fl
         supply_distribution_scenario.price_cheapest_buyer_accepted_in_optimization = Price::quiet_NaN();
         return std::make_tuple(Flow(0.0), Price::quiet_NaN());
     }
-    if (first_zero_connection == business_connections.begin()  // no production due to demand quantity shortage
-        || round((*business_connections.begin())->last_demand_request_D().get_price()) < minimal_production_price  // no production due to demand value shortage
+    if (business_connections.front()->last_demand_request_D().get_quantity() <= 0.0  // no production due to demand quantity shortage
+        || round(business_connections.front()->last_demand_request_D().get_price()) < minimal_production_price  // no production due to demand value shortage
     ) {
         // no production due to demand shortage
 
-        if (first_zero_connection == business_connections.begin()) {
+        if (business_connections.front()->last_demand_request_D().get_quantity() <= 0.0) {
             model()->run()->event(EventType::NO_PRODUCTION_DEMAND_QUANTITY_SHORTAGE, firm);
         } else {
             model()->run()->event(EventType::NO_PRODUCTION_DEMAND_VALUE_SHORTAGE, firm);
@@ -295,31 +350,12 @@ std::tuple<Flow, Price> SalesManager::calc_supply_distribution_scenario(const Fl
     }
     // non-zero production
 
-    Flow production_X = Flow(0.0);
-
-    // cycle over non-zero connections
-    for (auto business_connection = business_connections.begin(); business_connection != first_zero_connection; ++business_connection) {
-        // check that connection can be served at all
-        if (round((production_X + (*business_connection)->last_demand_request_D())).get_quantity() > possible_production_X_hat_p.get_quantity()) {
-            supply_distribution_scenario.connection_not_served_completely = business_connection;
-            break;
-        }
-        // check that price of demand request is high enough
-        Price maximal_marginal_production_costs =
-            calc_marginal_production_costs((round(production_X + (*business_connection)->last_demand_request_D())).get_quantity(), minimal_production_price);
-        if (isnan(maximal_marginal_production_costs)  // infinite costs
-            || round((*business_connection)->last_demand_request_D().get_price()) < round(maximal_marginal_production_costs)) {
-            supply_distribution_scenario.connection_not_served_completely = business_connection;
-            break;
-        }
-        production_X += (*business_connection)->last_demand_request_D();
-    }
-    production_X = round(production_X);
-    assert(production_X.get_quantity() <= possible_production_X_hat_p.get_quantity());
+    auto [production_X, all_served] = serve_demand_requests(possible_production_X_hat_p, minimal_production_price, minimal_production_price);
 
-    if (supply_distribution_scenario.connection_not_served_completely == first_zero_connection) {
+    if (all_served) {
         // all demand requests have been served completely to the price they offered
-        auto cheapest_served_non_zero_connection = first_zero_connection - 1;  // note: first_zero_connection == business_connections.begin() is excluded
+        auto cheapest_served_non_zero_connection =
+            supply_distribution_scenario.connection_not_served_completely - 1;  // note: first connection has non-zero demand (checked above)
         assert(production_X.get_quantity() <= sum_demand_requests_D_.get_quantity());  // to see if we make rounding errors
         assert(production_X.get_quantity() >= sum_demand_requests_D_.get_quantity());  // to see if we make rounding errors
         total_production_costs_C_ = calc_total_production_costs(production_X, minimal_production_price);
@@ -424,12 +460,6 @@ std::tuple<Flow, Price> SalesManager::calc_supply_distribution_scenario(const Fl
 
 std::tuple<Flow, Price> SalesManager::calc_expected_supply_distribution_scenario(const Flow& possible_production_X_hat_p) {
     debug::assertstep(this, IterationStep::EXPECTATION);
-    // find first (in order) connection with zero demand
-    auto first_zero_connection = std::find_if(std::begin(business_connections), std::end(business_connections), [](const auto& business_connection) {
-        return business_connection->last_demand_request_D().get_quantity() <= 0.0;
-    });
-
-    supply_distribution_scenario.connection_not_served_completely = first_zero_connection;
     Price minimal_production_price = round(possible_production_X_hat_p.get_price());
     Price minimal_offer_price = round(minimal_production_price + get_initial_markup() / (1 - tax_));
 
@@ -446,11 +476,11 @@ std::tuple<Flow, Price> SalesManager::calc_expected_supply_distribution_scenario
         supply_distribution_scenario.price_cheapest_buyer_accepted_in_optimization = Price::quiet_NaN();
         return std::make_tuple(Flow(0.0), Price::quiet_NaN());
     }
-    if (first_zero_connection == business_connections.begin()  // no production due to demand quantity shortage
-        || round((*business_connections.begin())->last_demand_request_D().get_price()) < minimal_production_price) {
+    if (business_connections.front()->last_demand_request_D().get_quantity() <= 0.0  // no production due to demand quantity shortage
+        || round(business_connections.front()->last_demand_request_D().get_price()) < minimal_production_price) {
         // no production due to demand shortage
 
-        if (first_zero_connection == business_connections.begin()) {
+        if (business_connections.front()->last_demand_request_D().get_quantity() <= 0.0) {
             model()->run()->event(EventType::NO_EXP_PRODUCTION_DEMAND_QUANTITY_SHORTAGE, firm);
         } else {
             model()->run()->event(EventType::NO_EXP_PRODUCTION_DEMAND_VALUE_SHORTAGE, firm);
@@ -467,40 +497,15 @@ std::tuple<Flow, Price> SalesManager::calc_expected_supply_distribution_scenario
     }
     // non-zero expected production
 
-    Flow expected_production_X = Flow(0.0);
+    // beyond lambda * X_star, markup is respected if set in parameters
+    auto [expected_production_X, all_served] = serve_demand_requests(
+        possible_production_X_hat_p, minimal_production_price,
+        model()->parameters().respect_markup_in_production_extension ? minimal_offer_price : minimal_production_price);
 
-    // cycle over non-zero connections
-    for (auto business_connection = business_connections.begin(); business_connection != first_zero_connection; ++business_connection) {
-        // check that connection can be served under quantitative aspects
-        if (round((expected_production_X + (*business_connection)->last_demand_request_D())).get_quantity() > possible_production_X_hat_p.get_quantity()) {
-            supply_distribution_scenario.connection_not_served_completely = business_connection;
-            break;
-        }
-        // check that price of demand request is high enough
-        auto maximal_marginal_production_costs = Price(0.0);
-
-        if (!model()->parameters().respect_markup_in_production_extension                                       // we always want to attract more demand
-            || expected_production_X.get_quantity() < firm->forced_initial_production_quantity_lambda_X_star()  // ... production is below lambda * X_star
-        ) {
-            maximal_marginal_production_costs = calc_marginal_production_costs(
-                (round(expected_production_X + (*business_connection)->last_demand_request_D())).get_quantity(), minimal_production_price);
-        } else {
-            maximal_marginal_production_costs = calc_marginal_production_costs(
-                (round(expected_production_X + (*business_connection)->last_demand_request_D())).get_quantity(), minimal_offer_price);
-        }
-        if (isnan(maximal_marginal_production_costs)  // infinite costs
-            || round((*business_connection)->last_demand_request_D().get_price()) < round(maximal_marginal_production_costs)) {
-            supply_distribution_scenario.connection_not_served_completely = business_connection;
-            break;
-        }
-        expected_production_X += (*business_connection)->last_demand_request_D();
-    }
-    expected_production_X = round(expected_production_X);
-    assert(expected_production_X.get_quantity() <= possible_production_X_hat_p.get_quantity());
-
-    if (supply_distribution_scenario.connection_not_served_completely == first_zero_connection) {
+    if (all_served) {
         // all demand requests would be served completely to the price they offered
-        auto cheapest_served_non_zero_connection = first_zero_connection - 1;  // note: first_zero_connection == business_connections.begin() is excluded
+        auto cheapest_served_non_zero_connection =
+            supply_distribution_scenario.connection_not_served_completely - 1;  // note: first connection has non-zero demand (checked above)
         // Expectations: the demand curves have to be extended
         // check that we reach the regime where X > sum_of_demand_requests
 
@@ -534,10 +539,10 @@ std::tuple<Flow, Price> SalesManager::calc_expected_supply_distribution_scenario
                     // price is not high enough to fulfill complete demand request, we have to find the optimal production ratio
                     auto precision_root_finding = Price(Price::precision);
                     additional_expected_flow =
-                        search_root_bisec_expectation(FlowQuantity(0.0), maximal_additional_production_quantity, expected_production_X.get_quantity(),
-                                                      respect_markup_in_extension_of_revenue_curve ? minimal_offer_price : minimal_production_price,
-                                                      (*cheapest_served_non_zero_connection)->last_demand_request_D().get_price(),
-                                                      precision_root_finding);  // note: true: initial markup respected
+                        search_root_expectation(FlowQuantity(0.0), maximal_additional_production_quantity, expected_production_X.get_quantity(),
+                                                respect_markup_in_extension_of_revenue_curve ? minimal_offer_price : minimal_production_price,
+                                                (*cheapest_served_non_zero_connection)->last_demand_request_D().get_price(),
+                                                precision_root_finding);  // note: true: initial markup respected
                     assert(round(additional_expected_flow).get_quantity() >= 0.0);
                 }
                 expected_production_X = round(expected_production_X + additional_expected_flow);
@@ -741,41 +746,36 @@ Price SalesManager::goal_fkt_marginal_costs_minus_price(const FlowQuantity& prod
     return calc_marginal_production_costs(production_quantity_X_rounded, unit_production_costs_n_c) - price;
 }
 
-Flow SalesManager::search_root_bisec_expectation(const FlowQuantity& left,
-                                                 const FlowQuantity& right,
-                                                 const FlowQuantity& production_quantity_X_p,
-                                                 const Price& unit_production_costs_n_c,
-                                                 const Price& n_min_p,
-                                                 const Price& precision_p) const {
-    assert(left < right);  // check limits of interval
-    // check if root is in interval
-
-    FlowQuantity middle = (left + right) / 2;
-    if (left + FlowQuantity(FlowQuantity::precision) >= right) {  // interval too narrow
-        if (abs(goal_fkt_marginal_costs_minus_marginal_revenue(production_quantity_X_p + left, unit_production_costs_n_c, n_min_p))
-            < abs(goal_fkt_marginal_costs_minus_marginal_revenue(production_quantity_X_p + right, unit_production_costs_n_c, n_min_p))) {
-            return Flow(left, calc_additional_revenue_expectation(round(production_quantity_X_p + left), n_min_p));
-        }
-        return Flow(right, calc_additional_revenue_expectation(round(production_quantity_X_p + right), n_min_p));
-    }
-    // check if root is in interval
-    assert(!same_sgn(goal_fkt_marginal_costs_minus_marginal_revenue(production_quantity_X_p + left, unit_production_costs_n_c, n_min_p),
-                     goal_fkt_marginal_costs_minus_marginal_revenue(production_quantity_X_p + right, unit_production_costs_n_c, n_min_p)));
-
-    if (abs(goal_fkt_marginal_costs_minus_marginal_revenue(production_quantity_X_p + middle, unit_production_costs_n_c, n_min_p)) < precision_p) {
-        return Flow(middle, calc_additional_revenue_expectation(production_quantity_X_p + middle, n_min_p));
-    }
-    if (abs(goal_fkt_marginal_costs_minus_marginal_revenue(production_quantity_X_p + left, unit_production_costs_n_c, n_min_p)) < precision_p) {
-        return Flow(left, calc_additional_revenue_expectation(production_quantity_X_p + left, n_min_p));
-    }
-    if (abs(goal_fkt_marginal_costs_minus_marginal_revenue(production_quantity_X_p + right, unit_production_costs_n_c, n_min_p)) < precision_p) {
-        return Flow(right, calc_additional_revenue_expectation(production_quantity_X_p + right, n_min_p));
+FloatType SalesManager::goal_fkt_marginal_costs_minus_marginal_revenue_derivative(const FlowQuantity& production_quantity_X_p, const Price& n_min_p) const {
+    FlowQuantity production_quantity_X_rounded = round(production_quantity_X_p);
+    // derivative of marginal revenue n_min * (D / X)^elasticity is -elasticity * marginal revenue / X
+    FloatType res = firm->sector->parameters().supply_elasticity * to_float(calc_marginal_revenue_curve(production_quantity_X_rounded, n_min_p))
+                    / to_float(production_quantity_X_rounded);
+    if (production_quantity_X_rounded > firm->forced_initial_production_quantity_lambda_X_star()) {  // in production extension
+        res += to_float(firm->sector->parameters().price_increase_production_extension) / to_float(firm->forced_initial_production_quantity_lambda_X_star());
+    }
+    return res;
+}
+
+Flow SalesManager::search_root_expectation(const FlowQuantity& left,
+                                           const FlowQuantity& right,
+                                           const FlowQuantity& production_quantity_X_p,
+                                           const Price& unit_production_costs_n_c,
+                                           const Price& n_min_p,
+                                           const Price& precision_p) const {
+    const auto root = rootfinding::search_root_safeguarded_newton(
+        left, right,
+        [&](const FlowQuantity& x) { return goal_fkt_marginal_costs_minus_marginal_revenue(production_quantity_X_p + x, unit_production_costs_n_c, n_min_p); },
+        [&](const FlowQuantity& x) { return goal_fkt_marginal_costs_minus_marginal_revenue_derivative(production_quantity_X_p + x, n_min_p); },
+        precision_p);
+    if constexpr (options::DEBUGGING) {
+        log::debug(this, "expectation root found after ", root.evaluations, " evaluations");
     }
-    if (!same_sgn(goal_fkt_marginal_costs_minus_marginal_revenue(production_quantity_X_p + middle, unit_production_costs_n_c, n_min_p),
-                  goal_fkt_marginal_costs_minus_marginal_revenue(production_quantity_X_p + right, unit_production_costs_n_c, n_min_p))) {
-        return search_root_bisec_expectation(middle, right, production_quantity_X_p, unit_production_costs_n_c, n_min_p, precision_p);
+    if (root.within_precision) {
+        return Flow(root.x, calc_additional_revenue_expectation(production_quantity_X_p + root.x, n_min_p));
     }
-    return search_root_bisec_expectation(left, middle, production_quantity_X_p, unit_production_costs_n_c, n_min_p, precision_p);
+    // interval too narrow
+    return Flow(root.x, calc_additional_revenue_expectation(round(production_quantity_X_p + root.x), n_min_p));
 }
 
 const SupplyParameters& SalesManager::communicated_parameters() const {
@@ -810,72 +810,69 @@ void SalesManager::debug_print_details() const {
 }
 
 template<typename T1, typename T2>
-static void print_row(T1 a, T2 b) {
-    std::cout << "      " << std::setw(14) << a << " = " << std::setw(14) << b << '\n';
+static void print_row(std::ostream& os, T1 a, T2 b) {
+    os << "      " << std::setw(14) << a << " = " << std::setw(14) << b << '\n';
 }
 
 template<typename T1, typename T2, typename T3>
-static void print_row(T1 a, T2 b, T3 c) {
-    std::cout << "      " << std::setw(14) << a << " = " << std::setw(14) << b << " (" << c << ")\n";
+static void print_row(std::ostream& os, T1 a, T2 b, T3 c) {
+    os << "      " << std::setw(14) << a << " = " << std::setw(14) << b << " (" << c << ")\n";
 }
 
 void SalesManager::print_parameters() const {
     if constexpr (options::DEBUGGING) {
-        log::info(this, "parameters:");
-        print_row("X", communicated_parameters_.production_X.get_quantity());
-        print_row("X_exp", communicated_parameters_.expected_production_X.get_quantity());
-        print_row("X_hat", communicated_parameters_.possible_production_X_hat);
-        print_row("  lambda", firm->forcing());
-        print_row("X_star", firm->initial_production_X_star().get_quantity());
-        print_row("lambda X_star", firm->forced_initial_production_quantity_lambda_X_star());
-        print_row("p", communicated_parameters_.production_X.get_quantity() / firm->initial_production_X_star().get_quantity());
-        print_row("p_exp", communicated_parameters_.expected_production_X.get_quantity() / firm->initial_production_X_star().get_quantity());
-        print_row("m_prod_cost(X)", calc_marginal_production_costs(communicated_parameters_.production_X.get_quantity(),
-                                                                   communicated_parameters_.possible_production_X_hat.get_price() * (1 - tax_)));
-        print_row("expected m_prod_cost(X)", calc_marginal_production_costs(communicated_parameters_.expected_production_X.get_quantity(),
-                                                                            communicated_parameters_.possible_production_X_hat.get_price() * (1 - tax_)));
-        print_row("n_bar", communicated_parameters_.offer_price_n_bar);
-        print_row("n_c", communicated_parameters_.possible_production_X_hat.get_price());
-        print_row("  C", total_production_costs_C_);
-        std::cout << std::flush;
+        std::ostringstream ss;
+        print_row(ss, "X", communicated_parameters_.production_X.get_quantity());
+        print_row(ss, "X_exp", communicated_parameters_.expected_production_X.get_quantity());
+        print_row(ss, "X_hat", communicated_parameters_.possible_production_X_hat);
+        print_row(ss, "  lambda", firm->forcing());
+        print_row(ss, "X_star", firm->initial_production_X_star().get_quantity());
+        print_row(ss, "lambda X_star", firm->forced_initial_production_quantity_lambda_X_star());
+        print_row(ss, "p", communicated_parameters_.production_X.get_quantity() / firm->initial_production_X_star().get_quantity());
+        print_row(ss, "p_exp", communicated_parameters_.expected_production_X.get_quantity() / firm->initial_production_X_star().get_quantity());
+        print_row(ss, "m_prod_cost(X)", calc_marginal_production_costs(communicated_parameters_.production_X.get_quantity(),
+                                                                       communicated_parameters_.possible_production_X_hat.get_price() * (1 - tax_)));
+        print_row(ss, "expected m_prod_cost(X)", calc_marginal_production_costs(communicated_parameters_.expected_production_X.get_quantity(),
+                                                                                communicated_parameters_.possible_production_X_hat.get_price() * (1 - tax_)));
+        print_row(ss, "n_bar", communicated_parameters_.offer_price_n_bar);
+        print_row(ss, "n_c", communicated_parameters_.possible_production_X_hat.get_price());
+        print_row(ss, "  C", total_production_costs_C_);
+        log::print(this, "parameters:\n", ss.str());
     }
 }
 
 void SalesManager::print_connections(std::vector<std::shared_ptr<BusinessConnection>>::const_iterator begin_equally_distributed,
                                      std::vector<std::shared_ptr<BusinessConnection>>::const_iterator end_equally_distributed) const {
     if constexpr (options::DEBUGGING) {
-#pragma omp critical(output)
-        {
-            std::cout << model()->run()->timeinfo() << ", " << name() << ": supply distribution for " << business_connections.size() << " outputs:\n";
-            auto sum = FlowQuantity(0.0);
-            auto initial_sum = FlowQuantity(0.0);
-            for (const auto& bc : business_connections) {
-                std::cout << "      " << bc->name() << " :\n";
-                print_row("n", bc->last_demand_request_D().get_price());
-                print_row("D_r", bc->last_demand_request_D().get_quantity());
-                print_row("D_star", bc->initial_flow_Z_star().get_quantity());
-                print_row("Z_last", bc->last_shipment_Z(this).get_quantity());
-                print_row("in_share", (bc->initial_flow_Z_star() / bc->buyer->storage->initial_input_flow_I_star()));
-                std::cout << '\n';
-                sum += bc->last_demand_request_D().get_quantity();
-                initial_sum += bc->initial_flow_Z_star().get_quantity();
-            }
-            if (supply_distribution_scenario.connection_not_served_completely != business_connections.end()) {
-                std::cout << "      not completely served: " << (*supply_distribution_scenario.connection_not_served_completely)->name() << '\n';
-            } else {
-                std::cout << "      all connections served completely\n";
-            }
-            if (begin_equally_distributed != business_connections.end()) {
-                std::cout << "      first_equal_distribution: " << (*begin_equally_distributed)->name() << '\n';
-            }
-            if (end_equally_distributed != business_connections.end()) {
-                std::cout << "      last_equal_distribution:  " << (*end_equally_distributed)->name() << '\n';
-            }
-            std::cout << "      Sums:\n";
-            print_row("sum D_r", sum);
-            print_row("sum_star D_r", initial_sum);
-            std::cout << std::flush;
+        std::ostringstream ss;
+        auto sum = FlowQuantity(0.0);
+        auto initial_sum = FlowQuantity(0.0);
+        for (const auto& bc : business_connections) {
+            ss << "      " << bc->name() << " :\n";
+            print_row(ss, "n", bc->last_demand_request_D().get_price());
+            print_row(ss, "D_r", bc->last_demand_request_D().get_quantity());
+            print_row(ss, "D_star", bc->initial_flow_Z_star().get_quantity());
+            print_row(ss, "Z_last", bc->last_shipment_Z(this).get_quantity());
+            print_row(ss, "in_share", (bc->initial_flow_Z_star() / bc->buyer->storage->initial_input_flow_I_star()));
+            ss << '\n';
+            sum += bc->last_demand_request_D().get_quantity();
+            initial_sum += bc->initial_flow_Z_star().get_quantity();
+        }
+        if (supply_distribution_scenario.connection_not_served_completely != business_connections.end()) {
+            ss << "      not completely served: " << (*supply_distribution_scenario.connection_not_served_completely)->name() << '\n';
+        } else {
+            ss << "      all connections served completely\n";
+        }
+        if (begin_equally_distributed != business_connections.end()) {
+            ss << "      first_equal_distribution: " << (*begin_equally_distributed)->name() << '\n';
+        }
+        if (end_equally_distributed != business_connections.end()) {
+            ss << "      last_equal_distribution:  " << (*end_equally_distributed)->name() << '\n';
         }
+        ss << "      Sums:\n";
+        print_row(ss, "sum D_r", sum);
+        print_row(ss, "sum_star D_r", initial_sum);
+        log::print(this, "supply distribution for ", business_connections.size(), " outputs:\n", ss.str());
     }
 }
 
@@ -21,11 +21,17 @@
 #include "output/ArrayOutput.h"
 
 #include <algorithm>
+#include <cmath>
+#include <fstream>
 #include <iterator>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <tuple>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
 
 #include "ModelRun.h"
 #include "model/BusinessConnection.h"
@@ -39,6 +45,9 @@
 #include "model/Sector.h"
 #include "model/Storage.h"
 #include "model/TransportChainLink.h"
+#include "netcdflock.h"
+#include "netcdfpp.h"
+#include "openmp.h"
 #include "settingsnode.h"
 
 namespace acclimate {
@@ -55,24 +64,24 @@ class CollectVariables {
     std::vector<ArrayOutput::Variable>& variables;
 
   private:
-    void add_variable(std::string name, bool flow_or_stock) {
+    void add_variable(std::string name, bool flow_or_stock, ArrayOutput::reduction_t reduction) {
         const auto name_hash = hash(name.c_str());
         if (flow_or_stock) {
-            variables.emplace_back(name + "_quantity", name_hash);
-            variables.emplace_back(name + "_value", name_hash);
+            variables.emplace_back(name + "_quantity", name_hash, ArrayOutput::reduction_t::SUM);
+            variables.emplace_back(name + "_value", name_hash, ArrayOutput::reduction_t::SUM);
         } else {
-            variables.emplace_back(name, name_hash);
+            variables.emplace_back(name, name_hash, reduction);
         }
     }
 
-    bool collect_variable(const char* name, bool flow_or_stock) {
+    bool collect_variable(const char* name, bool flow_or_stock, ArrayOutput::reduction_t reduction) {
         if (want_all) {
-            add_variable(name, flow_or_stock);
+            add_variable(name, flow_or_stock, reduction);
             return true;
         }
         const auto num_removed = wanted_variables.erase(name);
         if (num_removed > 0) {
-            add_variable(name, flow_or_stock);
+            add_variable(name, flow_or_stock, reduction);
         }
         return !wanted_variables.empty();
     }
@@ -101,16 +110,47 @@ class CollectVariables {
     template<typename Function>
     auto set(const char* name, Function&& f) ->
         typename std::enable_if<!std::is_same<decltype(f()), Flow>::value && !std::is_same<decltype(f()), Stock>::value, bool>::type {
-        return collect_variable(name, false);
+        // prices are aggregated as means weighted by baseline quantities
+        return collect_variable(name, false,
+                                std::is_same<typename std::decay<decltype(f())>::type, Price>::value ? ArrayOutput::reduction_t::WEIGHTED_MEAN
+                                                                                                      : ArrayOutput::reduction_t::MEAN);
     }
 
     template<typename Function>
     auto set(const char* name, Function&& f) ->
         typename std::enable_if<std::is_same<decltype(f()), Flow>::value || std::is_same<decltype(f()), Stock>::value, bool>::type {
-        return collect_variable(name, true);
+        return collect_variable(name, true, ArrayOutput::reduction_t::SUM);
     }
 };
 
+static void store_sample(ArrayOutput::aggregation_t aggregation, TimeStep samples, ArrayOutput::output_float_t& target, ArrayOutput::output_float_t value) {
+    if (samples == 0) {
+        target = value;
+        return;
+    }
+    switch (aggregation) {
+        case ArrayOutput::aggregation_t::LAST:
+            target = value;
+            break;
+        case ArrayOutput::aggregation_t::MEAN:  // running mean, so that target is valid after every sample
+            target += (value - target) / (samples + 1);
+            break;
+        case ArrayOutput::aggregation_t::SUM:
+            target += value;
+            break;
+        case ArrayOutput::aggregation_t::MIN:  // NaN samples are skipped, so the result is only NaN if all samples are
+            if (std::isnan(target) || value < target) {
+                target = value;
+            }
+            break;
+        case ArrayOutput::aggregation_t::MAX:
+            if (std::isnan(target) || value > target) {
+                target = value;
+            }
+            break;
+    }
+}
+
 class WriteVariables {
   public:
     struct H {
@@ -121,9 +161,15 @@ class WriteVariables {
     std::size_t index;
     std::vector<ArrayOutput::Variable>::iterator var;
     std::vector<ArrayOutput::Variable>& variables;
+    const ArrayOutput::aggregation_t aggregation;
+    const TimeStep samples;
+
+  private:
+    void store(ArrayOutput::output_float_t& target, ArrayOutput::output_float_t value) const { store_sample(aggregation, samples, target, value); }
 
   public:
-    WriteVariables(std::vector<ArrayOutput::Variable>& variables_p) : variables(variables_p) {}
+    template<std::size_t dim>
+    explicit WriteVariables(ArrayOutput::Observable<dim>& obs) : variables(obs.variables), aggregation(obs.aggregation), samples(obs.samples) {}
 
     template<typename T>
     void collect(const T* v, std::size_t index_p) {
@@ -136,7 +182,7 @@ class WriteVariables {
     auto set(hash_t name_hash, Function&& f) ->
         typename std::enable_if<!std::is_same<decltype(f()), Flow>::value && !std::is_same<decltype(f()), Stock>::value, bool>::type {
         if (var->name_hash == name_hash) {
-            var->data[index] = to_float(f());
+            store(var->data[index], to_float(f()));
             ++var;
             return var != std::end(variables);
         }
@@ -148,9 +194,9 @@ class WriteVariables {
         typename std::enable_if<std::is_same<decltype(f()), Flow>::value || std::is_same<decltype(f()), Stock>::value, bool>::type {
         if (var->name_hash == name_hash) {
             const auto& v = f();
-            var->data[index] = to_float(v.get_quantity());
+            store(var->data[index], to_float(v.get_quantity()));
             ++var;
-            var->data[index] = to_float(v.get_value());
+            store(var->data[index], to_float(v.get_value()));
             ++var;
             return var != std::end(variables);
         }
@@ -158,9 +204,211 @@ class WriteVariables {
     }
 };
 
+class AggregateVariables {
+  public:
+    struct H {
+        static constexpr hash_t hash(const char* s) { return acclimate::hash(s); }
+    };
+
+    struct Sum {
+        ArrayOutput::output_float_t value = 0;
+        ArrayOutput::output_float_t weight = 0;
+        std::size_t count = 0;
+
+        ArrayOutput::output_float_t result(ArrayOutput::reduction_t reduction) const {
+            if (count == 0) {
+                return std::numeric_limits<ArrayOutput::output_float_t>::quiet_NaN();
+            }
+            switch (reduction) {
+                case ArrayOutput::reduction_t::SUM:
+                    return value;
+                case ArrayOutput::reduction_t::MEAN:
+                    return value / count;
+                case ArrayOutput::reduction_t::WEIGHTED_MEAN:
+                    return weight > 0 ? value / weight : std::numeric_limits<ArrayOutput::output_float_t>::quiet_NaN();
+            }
+            return std::numeric_limits<ArrayOutput::output_float_t>::quiet_NaN();
+        }
+    };
+
+  private:
+    FloatType weight;
+    std::vector<ArrayOutput::Variable>::const_iterator var;
+    std::vector<Sum>::iterator sum;
+    const std::vector<ArrayOutput::Variable>& variables;
+
+  private:
+    void add(ArrayOutput::output_float_t value) {
+        if (!std::isnan(value)) {
+            if (var->reduction == ArrayOutput::reduction_t::WEIGHTED_MEAN) {
+                sum->value += weight * value;
+                sum->weight += weight;
+            } else {
+                sum->value += value;
+            }
+            ++sum->count;
+        }
+        ++var;
+        ++sum;
+    }
+
+  public:
+    explicit AggregateVariables(const std::vector<ArrayOutput::Variable>& variables_p) : variables(variables_p) {}
+
+    template<typename T>
+    void collect(const T* v, FloatType weight_p, std::vector<Sum>::iterator sums) {
+        weight = weight_p;
+        var = std::begin(variables);
+        sum = sums;
+        v->template observe<AggregateVariables, AggregateVariables::H>(*this);
+    }
+
+    template<typename Function>
+    auto set(hash_t name_hash, Function&& f) ->
+        typename std::enable_if<!std::is_same<decltype(f()), Flow>::value && !std::is_same<decltype(f()), Stock>::value, bool>::type {
+        if (var->name_hash == name_hash) {
+            add(to_float(f()));
+            return var != std::end(variables);
+        }
+        return true;
+    }
+
+    template<typename Function>
+    auto set(hash_t name_hash, Function&& f) ->
+        typename std::enable_if<std::is_same<decltype(f()), Flow>::value || std::is_same<decltype(f()), Stock>::value, bool>::type {
+        if (var->name_hash == name_hash) {
+            const auto& v = f();
+            add(to_float(v.get_quantity()));
+            add(to_float(v.get_value()));
+            return var != std::end(variables);
+        }
+        return true;
+    }
+};
+
+static FloatType baseline_weight(const Firm* firm) { return to_float(firm->initial_production_X_star().get_quantity()); }
+
+static FloatType baseline_weight(const Consumer* consumer) {
+    FloatType res = 0;
+    for (const auto& storage : consumer->input_storages) {
+        res += to_float(storage->initial_input_flow_I_star().get_quantity());
+    }
+    return res;
+}
+
+static FloatType baseline_weight(const BusinessConnection* business_connection) { return to_float(business_connection->initial_flow_Z_star().get_quantity()); }
+
+std::unique_ptr<ArrayOutput::AgentGroups> ArrayOutput::read_agent_groups(const settings::SettingsNode& node, bool include_firms, bool include_consumers) const {
+    const auto filename = node["file"].as<std::string>();
+    std::vector<std::pair<std::string, std::string>> mapping;  // (name, group)
+    if (filename.size() > 3 && filename.compare(filename.size() - 3, 3, ".nc") == 0) {
+        std::lock_guard<std::mutex> lock(netcdf_lock());
+        netCDF::File file(filename, 'r');
+        const auto names = file.variable("name").require().get<std::string>();
+        const auto groups = file.variable("group").require().get<std::string>();
+        if (names.size() != groups.size()) {
+            throw log::error(this, "Mapping variables 'name' and 'group' in ", filename, " differ in size");
+        }
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            mapping.emplace_back(names[i], groups[i]);
+        }
+    } else {  // CSV with lines 'name,group'
+        std::ifstream file(filename);
+        if (!file) {
+            throw log::error(this, "Could not open mapping file ", filename);
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            const auto sep = line.find(',');
+            if (sep == std::string::npos) {
+                throw log::error(this, "Invalid line '", line, "' in mapping file ", filename);
+            }
+            mapping.emplace_back(line.substr(0, sep), line.substr(sep + 1));
+        }
+    }
+
+    auto res = std::make_unique<AgentGroups>();
+    std::unordered_map<std::string, std::size_t> group_of_name;
+    for (const auto& [name, group] : mapping) {
+        const auto it = std::find(std::begin(res->names), std::end(res->names), group);
+        const auto group_index = static_cast<std::size_t>(std::distance(std::begin(res->names), it));
+        if (!group_of_name.emplace(name, group_index).second) {
+            throw log::error(this, "Duplicate name '", name, "' in mapping file ", filename);
+        }
+        if (it == std::end(res->names)) {
+            res->names.push_back(group);
+        }
+    }
+    res->members.resize(res->names.size());
+
+    const auto by = node["by"].as<hashed_string>("agent");
+    const auto& agents = model()->economic_agents;
+    res->group_of_agent.resize(agents.size(), -1);
+    for (std::size_t i = 0; i < agents.size(); ++i) {
+        const auto* agent = agents[i];
+        if ((agent->is_firm() && !include_firms) || (agent->is_consumer() && !include_consumers)) {
+            continue;
+        }
+        const std::string* key;
+        switch (by) {
+            case hash("agent"):
+                key = &agent->id.name;
+                break;
+            case hash("region"):
+                key = &agent->region->id.name;
+                break;
+            case hash("sector"):
+                if (!agent->is_firm()) {
+                    continue;
+                }
+                key = &agent->as_firm()->sector->id.name;
+                break;
+            default:
+                throw log::error(this, "Unknown aggregation mapping type ", by);
+        }
+        const auto it = group_of_name.find(*key);
+        if (it != std::end(group_of_name)) {
+            res->group_of_agent[i] = it->second;
+            res->members[it->second].push_back(i);
+        }
+    }
+    return res;
+}
+
+template<std::size_t dim>
+void ArrayOutput::read_aggregation(const settings::SettingsNode& obs_node, Observable<dim>& obs) {
+    obs.frequency = obs_node["frequency"].as<TimeStep>(1);
+    if (obs.frequency < 1) {
+        throw log::error(this, "Output frequency must be at least 1 timestep");
+    }
+    const auto aggregation = obs_node["aggregation"].as<hashed_string>("mean");
+    switch (aggregation) {
+        case hash("last"):
+            obs.aggregation = aggregation_t::LAST;
+            break;
+        case hash("mean"):
+            obs.aggregation = aggregation_t::MEAN;
+            break;
+        case hash("sum"):
+            obs.aggregation = aggregation_t::SUM;
+            break;
+        case hash("min"):
+            obs.aggregation = aggregation_t::MIN;
+            break;
+        case hash("max"):
+            obs.aggregation = aggregation_t::MAX;
+            break;
+        default:
+            throw log::error(this, "Unknown aggregation ", aggregation);
+    }
+}
+
 template<std::size_t dim>
 void ArrayOutput::resize_data(Observable<dim>& obs) {
-    auto size = only_current_timestep ? 1 : model()->run()->total_timestep_count();
+    auto size = only_current_timestep ? 1 : (model()->run()->total_timestep_count() + obs.frequency - 1) / obs.frequency;
     if constexpr (dim > 0) {
         for (std::size_t i = 0; i < dim; ++i) {
             size *= obs.sizes[i];
@@ -171,12 +419,31 @@ void ArrayOutput::resize_data(Observable<dim>& obs) {
     }
 }
 
+template<std::size_t dim>
+std::size_t ArrayOutput::begin_period(Observable<dim>& obs) {
+    if (obs.period_complete()) {
+        obs.samples = 0;
+    }
+    return only_current_timestep ? 0 : model()->timestep() / obs.frequency;
+}
+
 ArrayOutput::ArrayOutput(Model* model_p, const settings::SettingsNode& settings, bool only_current_timestep_p)
     : Output(model_p), only_current_timestep(only_current_timestep_p) {
     include_events = settings["events"].as<bool>(false);
+    event_counters = settings["event_counters"].as<bool>(false);
+    max_events = settings["max_events"].as<std::size_t>(0);
+    thread_events.resize(openmp::get_thread_count() + 1);
+    if (event_counters) {
+        event_counts_sector.resize(EVENT_NAMES.size() * model()->sectors.size());
+        event_counts_region.resize(EVENT_NAMES.size() * model()->regions.size());
+        for (auto& t : thread_events) {
+            t.counts.resize(event_counts_sector.size() + event_counts_region.size());
+        }
+    }
 
     // model
     if (const auto& obs_node = settings["model"]; !obs_node.empty()) {
+        read_aggregation(obs_node, obs_model);
         CollectVariables collector(obs_node, obs_model.variables);
         collector.collect<Model>();
         resize_data(obs_model);
@@ -220,11 +487,18 @@ ArrayOutput::ArrayOutput(Model* model_p, const settings::SettingsNode& settings,
                 }
             }
         }
-        if (obs_firms.indices[0].empty()) {
+        if (const auto& node = obs_node["aggregate"]; !node.empty()) {
+            if (!obs_firms.indices[0].empty()) {
+                throw log::error(this, "Selection and aggregation of firms not supported together");
+            }
+            obs_firms.groups = read_agent_groups(node, true, false);
+            obs_firms.sizes[0] = obs_firms.groups->names.size();
+        } else if (obs_firms.indices[0].empty()) {
             obs_firms.sizes[0] = model()->economic_agents.size();
         } else {
             obs_firms.sizes[0] = obs_firms.indices[0].size();
         }
+        read_aggregation(obs_node, obs_firms);
         CollectVariables collector(obs_node, obs_firms.variables);
         collector.collect<Firm>();
         resize_data(obs_firms);
@@ -257,14 +531,37 @@ ArrayOutput::ArrayOutput(Model* model_p, const settings::SettingsNode& settings,
                 }
             }
         }
-        if (obs_consumers.indices[0].empty()) {
+        if (const auto& node = obs_node["aggregate"]; !node.empty()) {
+            if (!obs_consumers.indices[0].empty()) {
+                throw log::error(this, "Selection and aggregation of consumers not supported together");
+            }
+            obs_consumers.groups = read_agent_groups(node, false, true);
+            obs_consumers.sizes[0] = obs_consumers.groups->names.size();
+        } else if (obs_consumers.indices[0].empty()) {
             obs_consumers.sizes[0] = model()->economic_agents.size();
         } else {
             obs_consumers.sizes[0] = obs_consumers.indices[0].size();
         }
+        read_aggregation(obs_node, obs_consumers);
         CollectVariables collector(obs_node, obs_consumers.variables);
         collector.collect<Consumer>();
         resize_data(obs_consumers);
+        // non-utilitarian consumers only calculate their (local optimal) utility if it is observed
+        if (std::any_of(std::begin(obs_consumers.variables), std::end(obs_consumers.variables), [](const Variable& v) {
+                return v.name_hash == hash("utility") || v.name_hash == hash("local_optimal_utility");
+            })) {
+            if (obs_consumers.indices[0].empty()) {
+                for (auto& agent : model()->economic_agents) {
+                    if (agent->is_consumer()) {
+                        agent->as_consumer()->request_local_optimal_utility();
+                    }
+                }
+            } else {
+                for (const auto index : obs_consumers.indices[0]) {
+                    model()->economic_agents[index]->as_consumer()->request_local_optimal_utility();
+                }
+            }
+        }
     }
 
     // sectors
@@ -283,6 +580,7 @@ ArrayOutput::ArrayOutput(Model* model_p, const settings::SettingsNode& settings,
         } else {
             obs_sectors.sizes[0] = obs_sectors.indices[0].size();
         }
+        read_aggregation(obs_node, obs_sectors);
         CollectVariables collector(obs_node, obs_sectors.variables);
         collector.collect<Sector>();
         resize_data(obs_sectors);
@@ -304,6 +602,7 @@ ArrayOutput::ArrayOutput(Model* model_p, const settings::SettingsNode& settings,
         } else {
             obs_regions.sizes[0] = obs_regions.indices[0].size();
         }
+        read_aggregation(obs_node, obs_regions);
         CollectVariables collector(obs_node, obs_regions.variables);
         collector.collect<Region>();
         resize_data(obs_regions);
@@ -325,6 +624,7 @@ ArrayOutput::ArrayOutput(Model* model_p, const settings::SettingsNode& settings,
         } else {
             obs_locations.sizes[0] = obs_locations.indices[0].size();
         }
+        read_aggregation(obs_node, obs_locations);
         CollectVariables collector(obs_node, obs_locations.variables);
         collector.collect<GeoLocation>();
         resize_data(obs_locations);
@@ -383,6 +683,7 @@ ArrayOutput::ArrayOutput(Model* model_p, const settings::SettingsNode& settings,
         } else {
             obs_storages.sizes[1] = obs_storages.indices[1].size();
         }
+        read_aggregation(obs_node, obs_storages);
         CollectVariables collector(obs_node, obs_storages.variables);
         collector.collect<Storage>();
         resize_data(obs_storages);
@@ -470,6 +771,15 @@ ArrayOutput::ArrayOutput(Model* model_p, const settings::SettingsNode& settings,
         if (!obs_flows.indices[0].empty() && !obs_flows.indices[1].empty()) {
             throw log::error(this, "Selection on both source agent and target agent not supported yet");
         }
+        if (const auto& node = obs_node["aggregate"]; !node.empty()) {
+            if (!obs_flows.indices[0].empty() || !obs_flows.indices[1].empty()) {
+                throw log::error(this, "Selection and aggregation of flows not supported together");
+            }
+            obs_flows.groups = read_agent_groups(node, true, true);
+            obs_flows.sizes[0] = obs_flows.groups->names.size();
+            obs_flows.sizes[1] = obs_flows.groups->names.size();
+        }
+        read_aggregation(obs_node, obs_flows);
         CollectVariables collector(obs_node, obs_flows.variables);
         collector.collect<BusinessConnection>();
         resize_data(obs_flows);
@@ -477,21 +787,23 @@ ArrayOutput::ArrayOutput(Model* model_p, const settings::SettingsNode& settings,
 }
 
 void ArrayOutput::iterate() {
-    const auto t = model()->timestep();
-
     // model
     if (!obs_model.variables.empty()) {
-        WriteVariables collector(obs_model.variables);
-        const auto offset = only_current_timestep ? 0 : t;
+        const auto offset = begin_period(obs_model);
+        WriteVariables collector(obs_model);
         collector.collect(model(), offset);
+        ++obs_model.samples;
     }
 
     // firms
-    if (!obs_firms.variables.empty()) {
-        WriteVariables collector(obs_firms.variables);
+    if (obs_firms.groups) {
+        aggregate_agents<Firm>(obs_firms, begin_period(obs_firms) * obs_firms.sizes[0]);
+        ++obs_firms.samples;
+    } else if (!obs_firms.variables.empty()) {
         const auto& vec = model()->economic_agents;
         const auto& indices = obs_firms.indices[0];
-        const auto offset = only_current_timestep ? 0 : t * obs_firms.sizes[0];
+        const auto offset = begin_period(obs_firms) * obs_firms.sizes[0];
+        WriteVariables collector(obs_firms);
         if (indices.empty()) {
             for (std::size_t i = 0; i < vec.size(); ++i) {
                 if (vec[i]->is_firm()) {
@@ -505,14 +817,18 @@ void ArrayOutput::iterate() {
                 }
             }
         }
+        ++obs_firms.samples;
     }
 
     // consumers
-    if (!obs_consumers.variables.empty()) {
-        WriteVariables collector(obs_consumers.variables);
+    if (obs_consumers.groups) {
+        aggregate_agents<Consumer>(obs_consumers, begin_period(obs_consumers) * obs_consumers.sizes[0]);
+        ++obs_consumers.samples;
+    } else if (!obs_consumers.variables.empty()) {
         const auto& vec = model()->economic_agents;
         const auto& indices = obs_consumers.indices[0];
-        const auto offset = only_current_timestep ? 0 : t * obs_consumers.sizes[0];
+        const auto offset = begin_period(obs_consumers) * obs_consumers.sizes[0];
+        WriteVariables collector(obs_consumers);
         if (indices.empty()) {
             for (std::size_t i = 0; i < vec.size(); ++i) {
                 if (vec[i]->is_consumer()) {
@@ -526,14 +842,15 @@ void ArrayOutput::iterate() {
                 }
             }
         }
+        ++obs_consumers.samples;
     }
 
     // sectors
     if (!obs_sectors.variables.empty()) {
-        WriteVariables collector(obs_sectors.variables);
         const auto& vec = model()->sectors;
         const auto& indices = obs_sectors.indices[0];
-        const auto offset = only_current_timestep ? 0 : t * obs_sectors.sizes[0];
+        const auto offset = begin_period(obs_sectors) * obs_sectors.sizes[0];
+        WriteVariables collector(obs_sectors);
         if (indices.empty()) {
             for (std::size_t i = 0; i < vec.size(); ++i) {
                 collector.collect(vec[i], offset + i);
@@ -543,14 +860,15 @@ void ArrayOutput::iterate() {
                 collector.collect(vec[indices[i]], offset + i);
             }
         }
+        ++obs_sectors.samples;
     }
 
     // regions
     if (!obs_regions.variables.empty()) {
-        WriteVariables collector(obs_regions.variables);
         const auto& vec = model()->regions;
         const auto& indices = obs_regions.indices[0];
-        const auto offset = only_current_timestep ? 0 : t * obs_regions.sizes[0];
+        const auto offset = begin_period(obs_regions) * obs_regions.sizes[0];
+        WriteVariables collector(obs_regions);
         if (indices.empty()) {
             for (std::size_t i = 0; i < vec.size(); ++i) {
                 collector.collect(vec[i], offset + i);
@@ -560,14 +878,15 @@ void ArrayOutput::iterate() {
                 collector.collect(vec[indices[i]], offset + i);
             }
         }
+        ++obs_regions.samples;
     }
 
     // locations
     if (!obs_locations.variables.empty()) {
-        WriteVariables collector(obs_locations.variables);
         const auto& vec = model()->other_locations;
         const auto& indices = obs_locations.indices[0];
-        const auto offset = only_current_timestep ? 0 : t * obs_locations.sizes[0];
+        const auto offset = begin_period(obs_locations) * obs_locations.sizes[0];
+        WriteVariables collector(obs_locations);
         if (indices.empty()) {
             for (std::size_t i = 0; i < vec.size(); ++i) {
                 collector.collect(vec[i], offset + i);
@@ -577,14 +896,15 @@ void ArrayOutput::iterate() {
                 collector.collect(vec[indices[i]], offset + i);
             }
         }
+        ++obs_locations.samples;
     }
 
     // storages
     if (!obs_storages.variables.empty()) {
-        WriteVariables collector(obs_storages.variables);
         const auto& vec = model()->economic_agents;
         const auto& indices = obs_storages.indices[1];  // selection on storage sector not supported yet
-        const auto offset = only_current_timestep ? 0 : t * obs_storages.sizes[1] * obs_storages.sizes[0];
+        const auto offset = begin_period(obs_storages) * obs_storages.sizes[1] * obs_storages.sizes[0];
+        WriteVariables collector(obs_storages);
         if (indices.empty()) {
             for (std::size_t i = 0; i < vec.size(); ++i) {
                 const auto* agent = vec[i];
@@ -600,13 +920,17 @@ void ArrayOutput::iterate() {
                 }
             }
         }
+        ++obs_storages.samples;
     }
 
     // flows
-    if (!obs_flows.variables.empty()) {
-        WriteVariables collector(obs_flows.variables);
+    if (obs_flows.groups) {
+        aggregate_flows(begin_period(obs_flows) * obs_flows.sizes[1] * obs_flows.sizes[0]);
+        ++obs_flows.samples;
+    } else if (!obs_flows.variables.empty()) {
         const auto& vec = model()->economic_agents;
-        const auto offset = only_current_timestep ? 0 : t * obs_flows.sizes[1] * obs_flows.sizes[0];
+        const auto offset = begin_period(obs_flows) * obs_flows.sizes[1] * obs_flows.sizes[0];
+        WriteVariables collector(obs_flows);
         if (obs_flows.indices[0].empty()) {
             const auto& indices = obs_flows.indices[1];
             if (indices.empty()) {
@@ -642,6 +966,123 @@ void ArrayOutput::iterate() {
                 }
             }
         }
+        ++obs_flows.samples;
+    }
+
+    collect_events();
+}
+
+template<typename Agent>
+void ArrayOutput::aggregate_agents(Observable<1>& obs, std::size_t offset) {
+    const auto& groups = *obs.groups;
+    const auto& vec = model()->economic_agents;
+    const auto var_count = obs.variables.size();
+#pragma omp parallel for default(shared) schedule(guided)
+    for (std::size_t g = 0; g < groups.members.size(); ++g) {  // groups are disjoint, so each thread only writes its own entries
+        std::vector<AggregateVariables::Sum> sums(var_count);
+        AggregateVariables collector(obs.variables);
+        for (const auto i : groups.members[g]) {
+            const Agent* agent;
+            if constexpr (std::is_same<Agent, Firm>::value) {
+                agent = vec[i]->as_firm();
+            } else {
+                agent = vec[i]->as_consumer();
+            }
+            collector.collect(agent, baseline_weight(agent), std::begin(sums));
+        }
+        for (std::size_t v = 0; v < var_count; ++v) {
+            store_sample(obs.aggregation, obs.samples, obs.variables[v].data[offset + g], sums[v].result(obs.variables[v].reduction));
+        }
+    }
+}
+
+void ArrayOutput::aggregate_flows(std::size_t offset) {
+    const auto& groups = *obs_flows.groups;
+    const auto& vec = model()->economic_agents;
+    const auto group_count = groups.names.size();
+    const auto var_count = obs_flows.variables.size();
+#pragma omp parallel for default(shared) schedule(guided)
+    for (std::size_t g_from = 0; g_from < group_count; ++g_from) {  // each thread only writes the row of its source group
+        std::vector<AggregateVariables::Sum> sums(group_count * var_count);
+        AggregateVariables collector(obs_flows.variables);
+        for (const auto i : groups.members[g_from]) {
+            const auto* agent = vec[i];
+            if (agent->is_firm()) {
+                for (const auto& bc : agent->as_firm()->sales_manager->business_connections) {
+                    const auto g_to = groups.group_of_agent[bc->buyer->storage->economic_agent->id.index()];
+                    if (g_to >= 0) {
+                        collector.collect(bc.get(), baseline_weight(bc.get()), std::begin(sums) + g_to * var_count);
+                    }
+                }
+            }
+        }
+        const auto n = offset + g_from * group_count;
+        for (std::size_t g_to = 0; g_to < group_count; ++g_to) {
+            for (std::size_t v = 0; v < var_count; ++v) {
+                store_sample(obs_flows.aggregation, obs_flows.samples, obs_flows.variables[v].data[n + g_to],
+                             sums[g_to * var_count + v].result(obs_flows.variables[v].reduction));
+            }
+        }
+    }
+}
+
+template<typename Func>
+void ArrayOutput::with_thread_events(const Func& f) {
+    const auto thread = openmp::get_global_thread();
+    if (thread + 1 < thread_events.size()) {
+        f(thread_events[thread]);
+    } else {  // more threads than expected
+        shared_thread_events_lock.call([&]() { f(thread_events.back()); });
+    }
+}
+
+void ArrayOutput::add_event(const Event& ev) {
+    with_thread_events([&](ThreadEvents& t) { t.events.emplace_back(ev); });
+}
+
+void ArrayOutput::count_event(EventType type, const Sector* sector, const EconomicAgent* economic_agent) {
+    const auto type_index = static_cast<std::size_t>(type);
+    with_thread_events([&](ThreadEvents& t) {
+        if (sector != nullptr) {
+            ++t.counts[type_index * model()->sectors.size() + sector->id.index()];
+        }
+        ++t.counts[event_counts_sector.size() + type_index * model()->regions.size() + economic_agent->region->id.index()];
+    });
+}
+
+void ArrayOutput::collect_events() {
+    if (include_events) {
+        if (only_current_timestep) {
+            events.clear();
+        }
+        const auto begin = events.size();
+        for (auto& t : thread_events) {
+            events.insert(std::end(events), std::begin(t.events), std::end(t.events));
+            t.events.clear();  // keeps capacity
+        }
+        // order of events from different threads is arbitrary, so sort them for reproducible output
+        // (values are NaN if not given, these are ordered first to keep a strict weak ordering)
+        const auto key = [](const Event& e) { return std::make_tuple(e.type, e.index1, e.index2, !std::isnan(e.value), std::isnan(e.value) ? 0.0 : e.value); };
+        std::sort(std::begin(events) + begin, std::end(events), [&key](const Event& a, const Event& b) { return key(a) < key(b); });
+        // cap only after sorting, so that the kept events do not depend on which thread raised them first
+        dropped_events = 0;
+        if (max_events > 0 && events.size() - begin > max_events) {
+            dropped_events = static_cast<unsigned int>(events.size() - begin - max_events);
+            events.resize(begin + max_events);
+        }
+    }
+    if (event_counters) {
+        std::fill(std::begin(event_counts_sector), std::end(event_counts_sector), 0);
+        std::fill(std::begin(event_counts_region), std::end(event_counts_region), 0);
+        for (auto& t : thread_events) {
+            for (std::size_t i = 0; i < event_counts_sector.size(); ++i) {
+                event_counts_sector[i] += t.counts[i];
+            }
+            for (std::size_t i = 0; i < event_counts_region.size(); ++i) {
+                event_counts_region[i] += t.counts[event_counts_sector.size() + i];
+            }
+            std::fill(std::begin(t.counts), std::end(t.counts), 0);
+        }
     }
 }
 
@@ -653,7 +1094,10 @@ void ArrayOutput::event(EventType type, const Sector* sector, const EconomicAgen
         ev.index1 = sector->id.index();
         ev.index2 = economic_agent->id.index();
         ev.value = value;
-        event_lock.call([&]() { events.emplace_back(ev); });
+        add_event(ev);
+    }
+    if (event_counters) {
+        count_event(type, sector, economic_agent);
     }
 }
 
@@ -664,7 +1108,10 @@ void ArrayOutput::event(EventType type, const EconomicAgent* economic_agent, Flo
         ev.type = static_cast<unsigned char>(type);
         ev.index1 = economic_agent->id.index();
         ev.value = value;
-        event_lock.call([&]() { events.emplace_back(ev); });
+        add_event(ev);
+    }
+    if (event_counters) {
+        count_event(type, economic_agent->is_firm() ? static_cast<const Sector*>(economic_agent->as_firm()->sector) : nullptr, economic_agent);
     }
 }
 
@@ -676,7 +1123,10 @@ void ArrayOutput::event(EventType type, const EconomicAgent* economic_agent_from
         ev.index1 = economic_agent_from->id.index();
         ev.index2 = economic_agent_to->id.index();
         ev.value = value;
-        event_lock.call([&]() { events.emplace_back(ev); });
+        add_event(ev);
+    }
+    if (event_counters) {
+        count_event(type, economic_agent_from->is_firm() ? static_cast<const Sector*>(economic_agent_from->as_firm()->sector) : nullptr, economic_agent_from);
     }
 }
 
@@ -24,9 +24,12 @@
 #include <array>
 #include <cstring>
 #include <ctime>
+#include <initializer_list>
 #include <iterator>
 #include <limits>
+#include <mutex>
 #include <ostream>
+#include <utility>
 
 #include "ModelRun.h"
 #include "acclimate.h"
@@ -35,14 +38,43 @@
 #include "model/Model.h"
 #include "model/Region.h"
 #include "model/Sector.h"
+#include "netcdflock.h"
 #include "netcdfpp.h"
 #include "settingsnode.h"
 #include "version.h"
 
 namespace acclimate {
 
+void NetCDFOutput::read_group_settings(const settings::SettingsNode& node, GroupSettings& group_settings) {
+    group_settings.compression_level = node["compression"].as<int>(group_settings.compression_level);
+    group_settings.shuffle = node["shuffle"].as<bool>(group_settings.shuffle);
+    group_settings.slab_steps = node["slab"].as<TimeStep>(group_settings.slab_steps);
+    if (group_settings.slab_steps < 1) {
+        throw log::error("Slab size must be at least 1 timestep");
+    }
+    if (node.has("chunks")) {
+        group_settings.chunks = node["chunks"].to_vector<std::size_t>();
+    }
+}
+
 NetCDFOutput::NetCDFOutput(Model* model_p, const settings::SettingsNode& settings) : ArrayOutput(model_p, settings, true) {
     flush_freq = settings["flush"].as<TimeStep>(1);
+    read_group_settings(settings, default_settings);
+    for (auto [name, group_settings] : std::initializer_list<std::pair<const char*, GroupSettings*>>{
+             {"model", &group_model.settings},
+             {"firms", &group_firms.settings},
+             {"consumers", &group_consumers.settings},
+             {"sectors", &group_sectors.settings},
+             {"regions", &group_regions.settings},
+             {"locations", &group_locations.settings},
+             {"storages", &group_storages.settings},
+             {"flows", &group_flows.settings},
+         }) {
+        *group_settings = default_settings;
+        if (const auto& node = settings[name]; !node.empty()) {
+            read_group_settings(node, *group_settings);
+        }
+    }
     if (const auto& filename_node = settings["file"]; !filename_node.empty()) {
         filename = filename_node.as<std::string>();
     } else {  // no filename given, use timestamp instead
@@ -59,35 +91,85 @@ void NetCDFOutput::create_group(const char* name,
                                 const std::array<netCDF::Dimension, dim + 1>& default_dims,
                                 const std::array<const char*, dim>& index_names,
                                 const Observable<dim>& observable,
-                                std::vector<netCDF::Variable>& nc_variables) {
+                                Group<dim>& group) {
     if (observable.variables.empty()) {
         return;
     }
-    auto group = file->add_group(name);
+    const auto& group_settings = group.settings;
+    auto nc_group = file->add_group(name);
     std::vector<int> dims(default_dims.size());
-    dims[0] = default_dims[0].id();
+    if (observable.frequency > 1) {  // group gets its own time axis
+        const auto dim_time = nc_group.add_dimension("time");
+        dims[0] = dim_time.id();
+        group.time_variable = std::make_unique<netCDF::Variable>(nc_group.add_variable<int>("time", {dim_time}));
+        netCDF::Variable& time_variable = *group.time_variable;
+        time_variable.add_attribute("calendar").set<std::string>(model()->run()->calendar());
+        time_variable.add_attribute("units").set<std::string>(std::string("days since ") + model()->run()->basedate());
+        time_variable.add_attribute("frequency").set<int>(observable.frequency);
+        time_variable.add_attribute("aggregation").set<std::string>(AGGREGATION_NAMES[static_cast<int>(observable.aggregation)]);
+    } else {
+        dims[0] = default_dims[0].id();
+    }
     if constexpr (dim > 0) {
         for (std::size_t i = 0; i < dim; ++i) {
-            if (observable.indices[i].empty()) {
+            if (observable.groups) {  // agents aggregated into groups, store group names instead of indices
+                const char* group_dim_name = dim == 1 ? "group" : (i == 0 ? "group_from" : "group_to");
+                dims[i + 1] = nc_group.add_dimension(group_dim_name, observable.groups->names.size()).id();
+                nc_group.add_variable<std::string>(group_dim_name, std::vector<int>{dims[i + 1]}).set<std::string>(observable.groups->names);
+            } else if (observable.indices[i].empty()) {
                 dims[i + 1] = default_dims[i + 1].id();
             } else {
-                dims[i + 1] = group.add_dimension(index_names[i], observable.indices[i].size()).id();
+                dims[i + 1] = nc_group.add_dimension(index_names[i], observable.indices[i].size()).id();
                 assert(observable.indices[i].size() == observable.sizes[i]);
-                netCDF::Variable var = group.add_variable<std::size_t>(index_names[i], std::vector<int>{dims[i + 1]});
-                var.set_compression(false, compression_level);
+                netCDF::Variable var = nc_group.add_variable<std::size_t>(index_names[i], std::vector<int>{dims[i + 1]});
+                if (group_settings.compression_level > 0) {
+                    var.set_compression(group_settings.shuffle, group_settings.compression_level);
+                }
                 var.set<unsigned long long>(observable.indices[i]);
             }
         }
     }
-    std::transform(std::begin(observable.variables), std::end(observable.variables), std::back_inserter(nc_variables), [&](const auto& obs_var) {
-        auto nc_var = group.add_variable<output_float_t>(obs_var.name, dims);
-        nc_var.set_compression(false, compression_level);
+
+    // chunks are given as (time, ...), missing or zero entries span the whole respective dimension
+    std::vector<std::size_t> chunks;
+    if (!group_settings.chunks.empty()) {
+        if (group_settings.chunks.size() > dim + 1) {
+            throw log::error(this, "Too many chunk sizes given for group ", name);
+        }
+        chunks.resize(dim + 1, 0);
+        std::copy(std::begin(group_settings.chunks), std::end(group_settings.chunks), std::begin(chunks));
+        if (chunks[0] == 0) {
+            chunks[0] = group_settings.slab_steps;
+        }
+        if constexpr (dim > 0) {
+            for (std::size_t i = 0; i < dim; ++i) {
+                if (chunks[i + 1] == 0 || chunks[i + 1] > observable.sizes[i]) {
+                    chunks[i + 1] = observable.sizes[i];
+                }
+            }
+        }
+    }
+
+    std::transform(std::begin(observable.variables), std::end(observable.variables), std::back_inserter(group.variables), [&](const auto& obs_var) {
+        auto nc_var = nc_group.add_variable<output_float_t>(obs_var.name, dims);
+        if (!chunks.empty()) {
+            nc_var.set_chunking(chunks);
+        }
+        if (group_settings.compression_level > 0) {
+            nc_var.set_compression(group_settings.shuffle, group_settings.compression_level);
+        }
         nc_var.set_fill(std::numeric_limits<output_float_t>::quiet_NaN());
         return nc_var;
     });
+
+    group.staging.resize(observable.variables.size());
+    for (std::size_t i = 0; i < observable.variables.size(); ++i) {
+        group.staging[i].resize(group_settings.slab_steps * observable.variables[i].data.size());
+    }
 }
 
 void NetCDFOutput::start() {
+    std::lock_guard<std::mutex> lock(netcdf_lock());
     const auto dim_time = file->add_dimension("time");
     const auto dim_sector = file->add_dimension("sector", model()->sectors.size());
     const auto dim_region = file->add_dimension("region", model()->regions.size());
@@ -106,13 +188,23 @@ void NetCDFOutput::start() {
     event_t.add_compound_field<decltype(ArrayOutput::Event::value)>("value", offsetof(ArrayOutput::Event, value));
     var_events = std::make_unique<netCDF::Variable>(file->add_variable("events", event_t, {dim_event}));
     // var_events->set_compression(false, compression_level); //removing compression from events
+    var_dropped_events = std::make_unique<netCDF::Variable>(file->add_variable<unsigned int>("dropped_events", {dim_time}));  // beyond max_events
 
     var_time = std::make_unique<netCDF::Variable>(file->add_variable<int>("time", {dim_time}));
-    var_time->set_compression(false, compression_level);
+    if (default_settings.compression_level > 0) {
+        var_time->set_compression(default_settings.shuffle, default_settings.compression_level);
+    }
     var_time->add_attribute("calendar").set<std::string>(model()->run()->calendar());
     var_time->add_attribute("units").set<std::string>(std::string("days since ") + model()->run()->basedate());
 
-    include_events = false;
+    if (event_counters) {
+        var_event_counts_sector = std::make_unique<netCDF::Variable>(file->add_variable<unsigned int>("event_counts_sector", {dim_time, dim_event_type, dim_sector}));
+        var_event_counts_region = std::make_unique<netCDF::Variable>(file->add_variable<unsigned int>("event_counts_region", {dim_time, dim_event_type, dim_region}));
+        if (default_settings.compression_level > 0) {
+            var_event_counts_sector->set_compression(default_settings.shuffle, default_settings.compression_level);
+            var_event_counts_region->set_compression(default_settings.shuffle, default_settings.compression_level);
+        }
+    }
 
     {
         auto event_type_var = file->add_variable<std::string>("event_type", {dim_event_type});
@@ -220,60 +312,124 @@ void NetCDFOutput::start() {
         options_group.add_attribute(option.name).set<unsigned char>(option.value ? 1 : 0);
     }
 
-    create_group<0>("model", {dim_time}, {}, obs_model, vars_model);
-    create_group<1>("firms", {dim_time, dim_agent}, {"firm_index"}, obs_firms, vars_firms);
-    create_group<1>("consumers", {dim_time, dim_agent}, {"consumer_index"}, obs_consumers, vars_consumers);
-    create_group<1>("sectors", {dim_time, dim_sector}, {"sector_index"}, obs_sectors, vars_sectors);
-    create_group<1>("regions", {dim_time, dim_region}, {"region_index"}, obs_regions, vars_regions);
-    create_group<1>("locations", {dim_time, dim_location}, {"location_index"}, obs_locations, vars_locations);
-    create_group<2>("storages", {dim_time, dim_sector, dim_agent}, {"sector_input_index", "agent_index"}, obs_storages, vars_storages);
-    create_group<2>("flows", {dim_time, dim_agent_from, dim_agent_to}, {"agent_from_index", "agent_to_index"}, obs_flows, vars_flows);
+    create_group<0>("model", {dim_time}, {}, obs_model, group_model);
+    create_group<1>("firms", {dim_time, dim_agent}, {"firm_index"}, obs_firms, group_firms);
+    create_group<1>("consumers", {dim_time, dim_agent}, {"consumer_index"}, obs_consumers, group_consumers);
+    create_group<1>("sectors", {dim_time, dim_sector}, {"sector_index"}, obs_sectors, group_sectors);
+    create_group<1>("regions", {dim_time, dim_region}, {"region_index"}, obs_regions, group_regions);
+    create_group<1>("locations", {dim_time, dim_location}, {"location_index"}, obs_locations, group_locations);
+    create_group<2>("storages", {dim_time, dim_sector, dim_agent}, {"sector_input_index", "agent_index"}, obs_storages, group_storages);
+    create_group<2>("flows", {dim_time, dim_agent_from, dim_agent_to}, {"agent_from_index", "agent_to_index"}, obs_flows, group_flows);
 }
 
 void NetCDFOutput::end() {
+    std::lock_guard<std::mutex> lock(netcdf_lock());
+    stage_all_variables(true);
+    write_all_staged();
     file->add_attribute("end_time").set<std::string>(model()->run()->now());
     file->close();
 }
 
-template<>
-void NetCDFOutput::write_variables(const Observable<0>& observable, std::vector<netCDF::Variable>& nc_variables) {
-    for (std::size_t i = 0; i < nc_variables.size(); ++i) {
-        nc_variables[i].set<output_float_t, 1>(observable.variables[i].data[0], {model()->timestep()});
+template<std::size_t dim>
+void NetCDFOutput::stage_variables(const Observable<dim>& observable, Group<dim>& group, bool end_of_run) {
+    if (group.variables.empty()) {
+        return;
+    }
+    if (end_of_run) {
+        if (observable.samples == 0 || observable.period_complete()) {  // complete periods have already been staged
+            return;
+        }
+    } else if (!observable.period_complete()) {
+        return;
+    }
+    if (group.staged_periods == 0) {
+        group.first_period = group.periods;
+    }
+    for (std::size_t i = 0; i < group.variables.size(); ++i) {
+        const auto& data = observable.variables[i].data;
+        std::copy(std::begin(data), std::end(data), std::begin(group.staging[i]) + group.staged_periods * data.size());
+    }
+    if (group.time_variable) {
+        netCDF::Variable& time_variable = *group.time_variable;
+        time_variable.set<output_float_t, 1>(to_float(last_time), {group.periods});
+    }
+    ++group.periods;
+    ++group.staged_periods;
+    if (group.staged_periods >= group.settings.slab_steps) {
+        write_staged(observable, group);
     }
 }
 
-template<>
-void NetCDFOutput::write_variables(const Observable<1>& observable, std::vector<netCDF::Variable>& nc_variables) {
-    for (std::size_t i = 0; i < nc_variables.size(); ++i) {
-        nc_variables[i].set<output_float_t, 2>(observable.variables[i].data, {model()->timestep(), 0}, {1, observable.sizes[0]});
-    }
+void NetCDFOutput::stage_all_variables(bool end_of_run) {
+    stage_variables(obs_model, group_model, end_of_run);
+    stage_variables(obs_firms, group_firms, end_of_run);
+    stage_variables(obs_consumers, group_consumers, end_of_run);
+    stage_variables(obs_sectors, group_sectors, end_of_run);
+    stage_variables(obs_regions, group_regions, end_of_run);
+    stage_variables(obs_locations, group_locations, end_of_run);
+    stage_variables(obs_storages, group_storages, end_of_run);
+    stage_variables(obs_flows, group_flows, end_of_run);
 }
 
-template<>
-void NetCDFOutput::write_variables(const Observable<2>& observable, std::vector<netCDF::Variable>& nc_variables) {
-    for (std::size_t i = 0; i < nc_variables.size(); ++i) {
-        nc_variables[i].set<output_float_t, 3>(observable.variables[i].data, {model()->timestep(), 0, 0}, {1, observable.sizes[0], observable.sizes[1]});
+template<std::size_t dim>
+void NetCDFOutput::write_staged(const Observable<dim>& observable, Group<dim>& group) {
+    if (group.staged_periods == 0) {
+        return;
+    }
+    std::array<std::size_t, dim + 1> start;
+    std::array<std::size_t, dim + 1> count;
+    start[0] = group.first_period;
+    count[0] = group.staged_periods;
+    if constexpr (dim > 0) {
+        for (std::size_t i = 0; i < dim; ++i) {
+            start[i + 1] = 0;
+            count[i + 1] = observable.sizes[i];
+        }
+    }
+    const auto full_size = group.settings.slab_steps * (observable.variables.empty() ? 0 : observable.variables[0].data.size());
+    for (std::size_t i = 0; i < group.variables.size(); ++i) {
+        auto& buffer = group.staging[i];
+        if (group.staged_periods < group.settings.slab_steps) {  // only for the last slab or before checkpointing, no reallocation as capacity stays the same
+            buffer.resize(group.staged_periods * observable.variables[i].data.size());
+            group.variables[i].template set<output_float_t, dim + 1>(buffer, start, count);
+            buffer.resize(full_size);
+        } else {
+            group.variables[i].template set<output_float_t, dim + 1>(buffer, start, count);
+        }
     }
+    group.staged_periods = 0;
 }
 
-void NetCDFOutput::iterate() {
-    var_time->set<output_float_t, 1>(to_float(model()->time()), {model()->timestep()});
+void NetCDFOutput::write_all_staged() {
+    write_staged(obs_model, group_model);
+    write_staged(obs_firms, group_firms);
+    write_staged(obs_consumers, group_consumers);
+    write_staged(obs_sectors, group_sectors);
+    write_staged(obs_regions, group_regions);
+    write_staged(obs_locations, group_locations);
+    write_staged(obs_storages, group_storages);
+    write_staged(obs_flows, group_flows);
+}
 
+void NetCDFOutput::iterate() {
     ArrayOutput::iterate();
 
-    write_variables(obs_model, vars_model);
-    write_variables(obs_firms, vars_firms);
-    write_variables(obs_consumers, vars_consumers);
-    write_variables(obs_sectors, vars_sectors);
-    write_variables(obs_regions, vars_regions);
-    write_variables(obs_locations, vars_locations);
-    write_variables(obs_storages, vars_storages);
-    write_variables(obs_flows, vars_flows);
+    std::lock_guard<std::mutex> lock(netcdf_lock());
+    last_time = model()->time();
+    var_time->set<output_float_t, 1>(to_float(last_time), {model()->timestep()});
 
-    if (!events.empty()) {
+    stage_all_variables(false);
+
+    if (!events.empty()) {  // only contains events of current timestep, so each event is written once
         var_events->set<Event, 1>(events, {event_cnt}, {events.size()});
         event_cnt += events.size();
     }
+    var_dropped_events->set<unsigned int, 1>(dropped_events, {model()->timestep()});
+
+    if (event_counters) {
+        var_event_counts_sector->set<unsigned int, 3>(event_counts_sector, {model()->timestep(), 0, 0}, {1, EVENT_NAMES.size(), model()->sectors.size()});
+        var_event_counts_region->set<unsigned int, 3>(event_counts_region, {model()->timestep(), 0, 0}, {1, EVENT_NAMES.size(), model()->regions.size()});
+    }
 
     if (flush_freq > 0) {
         if ((model()->timestep() % flush_freq) == 0) {
@@ -282,8 +438,15 @@ void NetCDFOutput::iterate() {
     }
 }
 
-void NetCDFOutput::checkpoint_stop() { file->close(); }
+void NetCDFOutput::checkpoint_stop() {
+    std::lock_guard<std::mutex> lock(netcdf_lock());
+    write_all_staged();
+    file->close();
+}
 
-void NetCDFOutput::checkpoint_resume() { file->open(filename, 'a'); }
+void NetCDFOutput::checkpoint_resume() {
+    std::lock_guard<std::mutex> lock(netcdf_lock());
+    file->open(filename, 'a');
+}
 
 }  // namespace acclimate
@@ -0,0 +1,47 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "model/PurchasingProblemRecord.h"
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h") {
+        std::cerr << "Replay purchasing and consumption problems recorded by acclimate (see purchasing_record_file)\n"
+                     "\n"
+                     "Usage:   "
+                  << argv[0]
+                  << " <record file> [<algorithm>...]\n"
+                     "                 Solve each recorded problem with the given algorithms (or the recorded one)"
+                  << std::endl;
+        return 1;
+    }
+    try {
+        acclimate::replay_optimization_problems(argv[1], std::vector<std::string>(argv + 2, argv + argc));
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return 255;
+    }
+    return 0;
+}
@@ -38,50 +38,50 @@ namespace acclimate {
 EventSeriesScenario::EventSeriesScenario(const settings::SettingsNode& settings_p, settings::SettingsNode scenario_node_p, Model* model_p)
     : ExternalScenario(settings_p, std::move(scenario_node_p), model_p) {}
 
+EventSeriesScenario::~EventSeriesScenario() { stop_prefetch(); }
+
 ExternalForcing* EventSeriesScenario::read_forcing_file(const std::string& filename, const std::string& variable_name) {
     return new EventForcing(filename, variable_name, model());
 }
 
 void EventSeriesScenario::read_forcings() {
-    {
-        auto forcing_l = static_cast<EventForcing*>(forcing.get());  // NOLINT(cppcoreguidelines-pro-type-static-cast-downcast)
-        for (std::size_t i = 0; i < forcing_l->agents.size(); ++i) {
-            if (forcing_l->agents[i] != nullptr) {
-                if (std::isnan(forcing_l->forcings[i])) {
-                    forcing_l->agents[i]->set_forcing(1.0);
-                } else {
-                    forcing_l->agents[i]->set_forcing(forcing_l->forcings[i]);
-                }
+    // only entries that changed since the previous timestep need to be applied (for a new file all entries are marked as changed)
+    auto forcing_l = static_cast<EventForcing*>(forcing.get());  // NOLINT(cppcoreguidelines-pro-type-static-cast-downcast)
+    for (const auto& change : forcing_changes) {
+        if (change.index < forcing_l->agents.size() && forcing_l->agents[change.index] != nullptr) {
+            if (std::isnan(change.value)) {
+                forcing_l->agents[change.index]->set_forcing(1.0);
+            } else {
+                forcing_l->agents[change.index]->set_forcing(change.value);
             }
         }
     }
-    {
-        auto forcing_l = static_cast<EventForcing*>(forcing.get());
-        for (std::size_t i = 0; i < forcing_l->locations.size(); ++i) {
-            if (forcing_l->locations[i] != nullptr) {
-                if (forcing_l->forcings[i] < 0.0) {
-                    forcing_l->locations[i]->set_forcing_nu(-1.);
-                } else {
-                    forcing_l->locations[i]->set_forcing_nu(forcing_l->forcings[i]);
-                }
+    for (const auto& change : forcing_changes) {
+        if (change.index < forcing_l->locations.size() && forcing_l->locations[change.index] != nullptr) {
+            if (change.value < 0.0) {
+                forcing_l->locations[change.index]->set_forcing_nu(-1.);
+            } else {
+                forcing_l->locations[change.index]->set_forcing_nu(change.value);
             }
         }
     }
 }
 
-void EventSeriesScenario::EventForcing::read_data() {
+void EventSeriesScenario::EventForcing::read_data(std::vector<Forcing>& data) {
+    data = forcings;
     if (agents.size() != 0) {
-        variable->read<Forcing, 3>(&forcings[0], {time_index, 0, 0}, {1, sectors_count, regions_count});
+        variable->read<Forcing, 3>(&data[0], {time_index, 0, 0}, {1, sectors_count, regions_count});
     } else if (locations.size() != 0) {
-        variable->read<Forcing, 3>(&forcings[0], {time_index, 0}, {1, sea_routes_count});
+        // all three counts have to be given, a missing one would be zero and nothing would be read
+        variable->read<Forcing, 3>(&data[0], {time_index, 0, 0}, {1, sea_routes_count, 1});
     }
 }
 
 EventSeriesScenario::EventForcing::EventForcing(const std::string& filename, const std::string& variable_name, Model* model)
     : ExternalForcing(filename, variable_name) {
-    if (file.variable("region") && file.variable("sector")) {
-        const auto regions = file.variable("region").require().get<std::string>();
-        const auto sectors = file.variable("sector").require().get<std::string>();
+    if (has_labels("region") && has_labels("sector")) {
+        const auto regions = labels("region");
+        const auto sectors = labels("sector");
         regions_count = regions.size();
         sectors_count = sectors.size();
         agents.reserve(regions_count * sectors_count);
@@ -102,8 +102,8 @@ EventSeriesScenario::EventForcing::EventForcing(const std::string& filename, con
             }
         }
     }
-    if (file.variable("sea_route")) {
-        const auto sea_routes = file.variable("sea_route").require().get<std::string>();
+    if (has_labels("sea_route")) {
+        const auto sea_routes = labels("sea_route");
         sea_routes_count = sea_routes.size();
         locations.reserve(sea_routes_count);
         forcings.reserve(sea_routes_count);
@@ -18,35 +18,98 @@
   along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+
 #include "scenario/ExternalForcing.h"
 
+#include <cmath>
+#include <mutex>
 #include <utility>
 
+#include "netcdflock.h"
 #include "netcdfpp.h"
+#include "scenario/MappedForcing.h"
 
 namespace acclimate {
 
 ExternalForcing::ExternalForcing(std::string filename, std::string variable_name) {
-    file.open(std::move(filename), 'r');
-    variable = std::make_unique<netCDF::Variable>(file.variable(std::move(variable_name)).require());
-    time_variable = std::make_unique<netCDF::Variable>(file.variable("time").require());
-    time_index_count = time_variable->size();
+    if (MappedForcingFile::is_mapped_forcing(filename)) {
+        mapped = std::make_unique<MappedForcingFile>(filename);
+        time_index_count = mapped->timesteps_count();
+    } else {
+        file.open(std::move(filename), 'r');
+        variable = std::make_unique<netCDF::Variable>(file.variable(std::move(variable_name)).require());
+        time_variable = std::make_unique<netCDF::Variable>(file.variable("time").require());
+        time_index_count = time_variable->size();
+    }
     time_index = 0;
 }
 
-ExternalForcing::~ExternalForcing() = default;  // needed to use forward declares for std::unique_ptr
+ExternalForcing::~ExternalForcing() {
+    if (!mapped) {
+        // might be released on the main thread while the prefetch thread is reading
+        std::lock_guard<std::mutex> lock(netcdf_lock());
+        variable.reset();
+        time_variable.reset();
+        file.close();
+    }
+}
+
+bool ExternalForcing::has_labels(const std::string& name) const {
+    if (mapped) {
+        return !mapped->labels(name).empty();
+    }
+    return static_cast<bool>(file.variable(name));
+}
+
+std::vector<std::string> ExternalForcing::labels(const std::string& name) const {
+    if (mapped) {
+        return mapped->labels(name);
+    }
+    return file.variable(name).require().get<std::string>();
+}
 
-int ExternalForcing::next_timestep() {
+int ExternalForcing::next_timestep(ForcingChanges& changes) {
     if (time_index >= time_index_count) {
         return -1;
     }
-    read_data();
+    if (mapped) {
+        mapped->changes(time_index, changes);
+        return mapped->day(time_index++);
+    }
+    read_data(data);
+    auto& res = changes.buffer;
+    res.clear();
+    if (previous_data.size() != data.size()) {  // first timestep of this file, all entries need to be applied
+        res.reserve(data.size());
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            res.push_back(ForcingChange{static_cast<std::uint32_t>(i), data[i]});
+        }
+    } else {
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            if (data[i] != previous_data[i] && !(std::isnan(data[i]) && std::isnan(previous_data[i]))) {
+                res.push_back(ForcingChange{static_cast<std::uint32_t>(i), data[i]});
+            }
+        }
+    }
+    std::swap(data, previous_data);
+    changes.begin_ = res.data();
+    changes.end_ = res.data() + res.size();
     auto day = time_variable->get<int, 1>({time_index});
     time_index++;
     return day;
 }
 
-std::string ExternalForcing::calendar_str() const { return time_variable->attribute("calendar").require().get_string(); }
+std::string ExternalForcing::calendar_str() const {
+    if (mapped) {
+        return mapped->calendar_str();
+    }
+    return time_variable->attribute("calendar").require().get_string();
+}
 
-std::string ExternalForcing::time_units_str() const { return time_variable->attribute("units").require().get_string(); }
+std::string ExternalForcing::time_units_str() const {
+    if (mapped) {
+        return mapped->time_units_str();
+    }
+    return time_variable->attribute("units").require().get_string();
+}
 }  // namespace acclimate
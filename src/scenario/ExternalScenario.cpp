@@ -31,6 +31,7 @@
 #include "model/EconomicAgent.h"
 #include "model/Model.h"
 #include "model/Region.h"
+#include "netcdflock.h"
 #include "scenario/ExternalForcing.h"
 #include "settingsnode.h"
 
@@ -39,7 +40,10 @@ namespace acclimate {
 ExternalScenario::ExternalScenario(const settings::SettingsNode& settings_p, settings::SettingsNode scenario_node_p, Model* model_p)
     : Scenario(settings_p, std::move(scenario_node_p), model_p) {}
 
-std::string ExternalScenario::fill_template(const std::string& in) const {
+// only a last resort, the prefetch thread must already have been stopped by the destructor of the deriving class
+ExternalScenario::~ExternalScenario() { stop_prefetch(); }
+
+std::string ExternalScenario::fill_template(const std::string& in, unsigned int index) const {
     const char* beg_mark = "[[";
     const char* end_mark = "]]";
     std::ostringstream ss;
@@ -56,7 +60,7 @@ std::string ExternalScenario::fill_template(const std::string& in) const {
         if (key != "index") {
             ss << scenario_node["parameters"][key.c_str()].as<std::string>();
         } else {
-            ss << file_index;
+            ss << index;
         }
         pos = stop + std::strlen(end_mark);
     }
@@ -80,46 +84,137 @@ unsigned int ExternalScenario::get_ref_year(const std::string& filename, const s
     throw log::error(this, "Forcing file ", filename, " has invalid time units");
 }
 
-bool ExternalScenario::next_forcing_file() {
-    if (file_index > file_index_to) {
-        forcing.reset();
-        return false;
+ExternalScenario::ForcingStep ExternalScenario::read_step() {
+    ForcingStep res;
+    if (!reading_forcing) {
+        if (reading_file_index > file_index_to) {
+            return res;
+        }
+        if (remove_afterwards) {
+            std::remove(forcing_file.c_str());
+        }
+        if (!expression.empty()) {
+            const std::string final_expression = fill_template(expression, reading_file_index);
+            log::info(this, "Invoking '", final_expression, "'");
+            if (std::system(final_expression.c_str()) != 0) {  // NOLINT(cert-env33-c)
+                throw log::error(this, "Invoking '", final_expression, "' raised an error");
+            }
+        }
+        res.filename = fill_template(forcing_file, reading_file_index);
+        res.new_file = true;
+        ++reading_file_index;
     }
-    if (remove_afterwards) {
-        std::remove(forcing_file.c_str());
+    std::lock_guard<std::mutex> lock(netcdf_lock());
+    if (res.new_file) {
+        reading_forcing.reset(read_forcing_file(res.filename, variable_name));
+        res.calendar_str = reading_forcing->calendar_str();
+        res.time_units_str = reading_forcing->time_units_str();
     }
-    if (!expression.empty()) {
-        const std::string final_expression = fill_template(expression);
-        log::info(this, "Invoking '", final_expression, "'");
-        if (std::system(final_expression.c_str()) != 0) {  // NOLINT(cert-env33-c)
-            throw log::error(this, "Invoking '", final_expression, "' raised an error");
+    res.forcing = reading_forcing;
+    res.day = reading_forcing->next_timestep(res.changes);
+    if (res.day < 0) {
+        // res still holds the forcing, so it is not released while holding the lock
+        reading_forcing.reset();
+    }
+    return res;
+}
+
+void ExternalScenario::prefetch() {
+    try {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(prefetch_mutex);
+                prefetch_cv.wait(lock, [this]() { return prefetch_stop || prefetch_queue.size() < prefetch_size; });
+                if (prefetch_stop) {
+                    return;
+                }
+            }
+            ForcingStep step = read_step();
+            const bool last = !step.forcing;
+            {
+                std::lock_guard<std::mutex> lock(prefetch_mutex);
+                prefetch_queue.emplace_back(std::move(step));
+                prefetch_finished = last;
+            }
+            prefetch_cv.notify_all();
+            if (last) {
+                return;
+            }
         }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(prefetch_mutex);
+            prefetch_exception = std::current_exception();
+        }
+        prefetch_cv.notify_all();
     }
-    const std::string filename = fill_template(forcing_file);
-    forcing.reset(read_forcing_file(filename, variable_name));
-    const std::string new_calendar_str = forcing->calendar_str();
-    if (!calendar_str_.empty() && new_calendar_str != calendar_str_) {
+}
+
+ExternalScenario::ForcingStep ExternalScenario::fetch_step() {
+    if (prefetch_size == 0) {
+        return read_step();
+    }
+    ForcingStep res;
+    {
+        std::unique_lock<std::mutex> lock(prefetch_mutex);
+        prefetch_cv.wait(lock, [this]() { return !prefetch_queue.empty() || prefetch_exception || prefetch_finished; });
+        if (prefetch_queue.empty()) {
+            if (prefetch_exception) {
+                // raise errors of the prefetch thread only once all timesteps read before have been used, i.e. where they would occur when reading
+                // synchronously
+                std::rethrow_exception(prefetch_exception);
+            }
+            return res;
+        }
+        res = std::move(prefetch_queue.front());
+        prefetch_queue.pop_front();
+    }
+    prefetch_cv.notify_all();
+    return res;
+}
+
+void ExternalScenario::stop_prefetch() {
+    if (prefetch_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(prefetch_mutex);
+            prefetch_stop = true;
+        }
+        prefetch_cv.notify_all();
+        prefetch_thread.join();
+    }
+    prefetch_queue.clear();
+    reading_forcing.reset();
+}
+
+bool ExternalScenario::next_forcing_file() {
+    ForcingStep step = fetch_step();
+    if (!step.forcing) {
+        forcing.reset();
+        return false;
+    }
+    forcing = std::move(step.forcing);
+    forcing_changes = std::move(step.changes);
+    if (!calendar_str_.empty() && step.calendar_str != calendar_str_) {
         throw log::error(this, "Forcing files differ in calendar");
     }
-    calendar_str_ = new_calendar_str;
-    const std::string new_time_units_str = forcing->time_units_str();
-    if (new_time_units_str.substr(0, 14) == "seconds since ") {
+    calendar_str_ = step.calendar_str;
+    if (step.time_units_str.substr(0, 14) == "seconds since ") {
         time_step_width = 24 * 60 * 60;
     } else {
         time_step_width = 1;
     }
-    if (!time_units_str_.empty() && new_time_units_str != time_units_str_) {
-        const unsigned int ref_year = get_ref_year(filename, time_units_str_);
-        const unsigned int new_ref_year = get_ref_year(filename, new_time_units_str);
+    if (!time_units_str_.empty() && step.time_units_str != time_units_str_) {
+        const unsigned int ref_year = get_ref_year(step.filename, time_units_str_);
+        const unsigned int new_ref_year = get_ref_year(step.filename, step.time_units_str);
         if (new_ref_year != ref_year + 1) {
             throw log::error(this, "Forcing files differ by more than a year");
         }
         time_offset = model()->time() + model()->delta_t();
     }
-    time_units_str_ = new_time_units_str;
-    next_time = Time(forcing->next_timestep()) / time_step_width;
+    time_units_str_ = step.time_units_str;
+    next_time = Time(step.day) / time_step_width;
     if (next_time < 0) {
-        throw log::error(this, "Empty forcing in ", filename);
+        throw log::error(this, "Empty forcing in ", step.filename);
     }
     next_time += time_offset;
     file_index++;
@@ -137,6 +232,7 @@ void ExternalScenario::start() {
     file_index_from = forcing_node["index_from"].as<int>(0);
     file_index_to = forcing_node["index_to"].as<int>(file_index_from);
     file_index = file_index_from;
+    reading_file_index = file_index_from;
 
     if (forcing_node.has("expression")) {
         expression = forcing_node["expression"].as<std::string>();
@@ -147,12 +243,18 @@ void ExternalScenario::start() {
         expression = "";
     }
 
+    prefetch_size = forcing_node["prefetch"].as<std::size_t>(2);
+    if (prefetch_size > 0) {
+        prefetch_thread = std::thread(&ExternalScenario::prefetch, this);
+    }
+
     if (!next_forcing_file()) {
         throw log::error(this, "Empty forcing");
     }
 }
 
 void ExternalScenario::end() {
+    stop_prefetch();
     forcing.reset();
     if (remove_afterwards) {
         remove(forcing_file.c_str());
@@ -182,7 +284,9 @@ void ExternalScenario::iterate() {
     }
     if (model()->time() >= next_time) {
         read_forcings();
-        next_time = Time(forcing->next_timestep()) / time_step_width;
+        ForcingStep step = fetch_step();
+        forcing_changes = std::move(step.changes);
+        next_time = Time(step.day) / time_step_width;
         if (next_time >= 0) {
             next_time += time_offset;
         }
@@ -0,0 +1,213 @@
+/*
+  Copyright (C) 2014-2020 Sven Willner <sven.willner@pik-potsdam.de>
+                          Christian Otto <christian.otto@pik-potsdam.de>
+
+  This file is part of Acclimate.
+
+  Acclimate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU Affero General Public License as
+  published by the Free Software Foundation, either version 3 of
+  the License, or (at your option) any later version.
+
+  Acclimate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU Affero General Public License for more details.
+
+  You should have received a copy of the GNU Affero General Public License
+  along with Acclimate.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "scenario/MappedForcing.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include "acclimate.h"
+#include "netcdfpp.h"
+
+namespace acclimate {
+
+static_assert(std::is_trivially_copyable<ForcingChange>::value, "ForcingChange is written as is");
+static_assert(std::is_trivially_copyable<MappedForcingFile::Header>::value, "Header is written as is");
+static_assert(std::is_trivially_copyable<MappedForcingFile::Step>::value, "Step is written as is");
+
+static std::size_t aligned(std::size_t offset, std::size_t alignment) { return (offset + alignment - 1) / alignment * alignment; }
+
+bool MappedForcingFile::is_mapped_forcing(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::array<char, 8> magic{};
+    return file.read(magic.data(), magic.size()) && magic == MAGIC;
+}
+
+MappedForcingFile::MappedForcingFile(const std::string& filename) {
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw log::error("Could not open forcing file ", filename);
+    }
+    struct stat st = {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw log::error("Could not open forcing file ", filename);
+    }
+    size = st.st_size;
+    void* mapping = size >= sizeof(Header) ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw log::error("Could not map forcing file ", filename);
+    }
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapping);
+
+    const auto invalid = [&]() {
+        ::munmap(mapping, size);
+        return log::error("Invalid forcing file ", filename);
+    };
+    header_m = reinterpret_cast<const Header*>(data);
+    // sizes are compared by division, as offset + count * size could overflow for corrupt headers
+    if (header_m->magic != MAGIC || header_m->strings_offset > header_m->steps_offset || header_m->steps_offset > size
+        || header_m->timesteps_count > (size - header_m->steps_offset) / sizeof(Step)) {
+        throw invalid();
+    }
+    steps = reinterpret_cast<const Step*>(data + header_m->steps_offset);
+    for (std::size_t i = 0; i < header_m->timesteps_count; ++i) {
+        if (steps[i].changes_offset > size || steps[i].changes_count > (size - steps[i].changes_offset) / sizeof(ForcingChange)) {
+            throw invalid();
+        }
+    }
+
+    const char* s = data + header_m->strings_offset;
+    const char* strings_end = data + header_m->steps_offset;
+    const auto next_string = [&]() {
+        const auto* end = static_cast<const char*>(std::memchr(s, '\0', strings_end - s));
+        if (end == nullptr) {
+            throw invalid();
+        }
+        std::string res(s, end);
+        s = end + 1;
+        return res;
+    };
+    calendar_str_ = next_string();
+    time_units_str_ = next_string();
+    for (auto [count, labels] : {std::make_pair(header_m->sectors_count, &sectors_), std::make_pair(header_m->regions_count, &regions_),
+                                 std::make_pair(header_m->sea_routes_count, &sea_routes_)}) {
+        labels->reserve(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            labels->emplace_back(next_string());
+        }
+    }
+}
+
+MappedForcingFile::~MappedForcingFile() { ::munmap(const_cast<char*>(data), size); }
+
+void MappedForcingFile::changes(std::size_t time_index, ForcingChanges& res) const {
+    const auto& step = steps[time_index];
+    res.begin_ = reinterpret_cast<const ForcingChange*>(data + step.changes_offset);
+    res.end_ = res.begin_ + step.changes_count;
+}
+
+const std::vector<std::string>& MappedForcingFile::labels(const std::string& name) const {
+    if (name == "sector") {
+        return sectors_;
+    }
+    if (name == "region") {
+        return regions_;
+    }
+    if (name == "sea_route") {
+        return sea_routes_;
+    }
+    throw log::error("Unknown forcing labels '", name, "'");
+}
+
+void convert_forcing(const std::string& netcdf_filename, const std::string& variable_name, const std::string& filename) {
+    netCDF::File in(netcdf_filename, 'r');
+    auto variable = in.variable(variable_name).require();
+    auto time_variable = in.variable("time").require();
+
+    MappedForcingFile::Header header = {};
+    header.magic = MappedForcingFile::MAGIC;
+    header.timesteps_count = time_variable.size();
+    std::vector<std::string> sectors;
+    std::vector<std::string> regions;
+    std::vector<std::string> sea_routes;
+    // same layout as read by EventSeriesScenario
+    if (in.variable("region") && in.variable("sector")) {
+        sectors = in.variable("sector").require().get<std::string>();
+        regions = in.variable("region").require().get<std::string>();
+    }
+    if (in.variable("sea_route")) {
+        sea_routes = in.variable("sea_route").require().get<std::string>();
+    }
+    header.sectors_count = sectors.size();
+    header.regions_count = regions.size();
+    header.sea_routes_count = sea_routes.size();
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw log::error("Could not open ", filename);
+    }
+    std::size_t offset = sizeof(header);
+    const auto write = [&](const void* p, std::size_t n) {
+        out.write(static_cast<const char*>(p), n);
+        offset += n;
+    };
+    const auto pad = [&](std::size_t alignment) {
+        static constexpr std::array<char, 16> zeros = {};
+        write(zeros.data(), aligned(offset, alignment) - offset);
+    };
+    out.seekp(offset);
+
+    header.strings_offset = offset;
+    const auto write_string = [&](const std::string& s) { write(s.c_str(), s.size() + 1); };
+    write_string(time_variable.attribute("calendar").require().get_string());
+    write_string(time_variable.attribute("units").require().get_string());
+    for (const auto* labels : {&sectors, &regions, &sea_routes}) {
+        for (const auto& label : *labels) {
+            write_string(label);
+        }
+    }
+
+    const std::size_t count = !sectors.empty() ? sectors.size() * regions.size() : sea_routes.size();
+    std::vector<Forcing> values(count);
+    std::vector<Forcing> previous_values;
+    std::vector<ForcingChange> changes;
+    std::vector<MappedForcingFile::Step> steps(header.timesteps_count);
+    for (std::size_t t = 0; t < header.timesteps_count; ++t) {
+        if (!sectors.empty()) {
+            variable.read<Forcing, 3>(&values[0], {t, 0, 0}, {1, sectors.size(), regions.size()});
+        } else if (!sea_routes.empty()) {
+            variable.read<Forcing, 3>(&values[0], {t, 0, 0}, {1, sea_routes.size(), 1});
+        }
+        changes.clear();
+        for (std::size_t i = 0; i < count; ++i) {
+            if (previous_values.empty() || (values[i] != previous_values[i] && !(std::isnan(values[i]) && std::isnan(previous_values[i])))) {
+                changes.push_back(ForcingChange{static_cast<std::uint32_t>(i), values[i]});
+            }
+        }
+        previous_values = values;
+        pad(alignof(ForcingChange));
+        steps[t].day = time_variable.get<int, 1>({t});
+        steps[t].changes_offset = offset;
+        steps[t].changes_count = changes.size();
+        write(changes.data(), changes.size() * sizeof(ForcingChange));
+    }
+    pad(alignof(MappedForcingFile::Step));
+    header.steps_offset = offset;
+    write(steps.data(), steps.size() * sizeof(MappedForcingFile::Step));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!out) {
+        throw log::error("Could not write ", filename);
+    }
+}
+
+}  // namespace acclimate
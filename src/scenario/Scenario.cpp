@@ -20,9 +20,11 @@
 
 #include "scenario/Scenario.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "acclimate.h"
 #include "model/CapacityManager.h"
@@ -42,39 +44,70 @@ Scenario::Scenario(const settings::SettingsNode& settings_p, settings::SettingsN
     srand(0);  // NOLINT(cert-msc32-c,cert-msc51-cpp)
 }
 
-void Scenario::set_firm_property(Firm* firm, const settings::SettingsNode& node, bool reset) {
+void Scenario::Action::apply(bool reset) const {
+    switch (type) {
+        case type_t::FIRM_FORCING:
+            firm->set_forcing(reset ? Forcing(1.0) : value);
+            break;
+        case type_t::FIRM_REMAINING_CAPACITY:
+            firm->set_forcing(reset ? 1.0 : value / firm->capacity_manager->possible_overcapacity_ratio_beta);
+            break;
+        case type_t::CONSUMER_FORCING:
+            consumer->set_forcing(reset ? Forcing(1.0) : value);
+            break;
+        case type_t::LOCATION_PASSAGE:
+            location->set_forcing_nu(reset ? -1. : value);
+            break;
+    }
+}
+
+void Scenario::compile_firm_property(Firm* firm, const settings::SettingsNode& node, std::vector<Action>& actions) {
     for (const auto& it_map : node.as_map()) {
         const std::string& name = it_map.first;
         const settings::SettingsNode& it = it_map.second;
+        Action action;
+        action.firm = firm;
         if (name == "remaining_capacity") {
-            firm->set_forcing(reset ? 1.0 : it.as<Forcing>() / firm->capacity_manager->possible_overcapacity_ratio_beta);
+            action.type = Action::type_t::FIRM_REMAINING_CAPACITY;
         } else if (name == "forcing") {
-            firm->set_forcing(reset ? Forcing(1.0) : it.as<Forcing>());
+            action.type = Action::type_t::FIRM_FORCING;
+        } else {
+            continue;
         }
+        action.value = it.as<Forcing>();
+        actions.push_back(action);
     }
 }
 
-void Scenario::set_consumer_property(Consumer* consumer, const settings::SettingsNode& node, bool reset) {
+void Scenario::compile_consumer_property(Consumer* consumer, const settings::SettingsNode& node, std::vector<Action>& actions) {
     for (const auto& it_map : node.as_map()) {
         const std::string& name = it_map.first;
         const settings::SettingsNode& it = it_map.second;
         if (name == "remaining_consumption_rate") {
-            consumer->set_forcing(reset ? Forcing(1.0) : it.as<Forcing>());
+            Action action;
+            action.type = Action::type_t::CONSUMER_FORCING;
+            action.consumer = consumer;
+            action.value = it.as<Forcing>();
+            actions.push_back(action);
         }
     }
 }
 
-void Scenario::set_location_property(GeoLocation* location, const settings::SettingsNode& node, bool reset) {
+void Scenario::compile_location_property(GeoLocation* location, const settings::SettingsNode& node, std::vector<Action>& actions) {
     for (const auto& it_map : node.as_map()) {
         const std::string& name = it_map.first;
         const settings::SettingsNode& it = it_map.second;
         if (name == "passage") {
-            location->set_forcing_nu(reset ? -1. : it.as<Forcing>());
+            Action action;
+            action.type = Action::type_t::LOCATION_PASSAGE;
+            action.location = location;
+            action.value = it.as<Forcing>();
+            actions.push_back(action);
         }
     }
 }
 
-void Scenario::apply_target(const settings::SettingsNode& node, bool reset) {
+void Scenario::compile_targets(const settings::SettingsNode& node, std::vector<Action>& actions) {
     for (const auto& targets : node.as_sequence()) {
         for (const auto& target : targets.as_map()) {
             const std::string& type = target.first;
@@ -89,7 +122,7 @@ void Scenario::apply_target(const settings::SettingsNode& node, bool reset) {
                     if (!agent->is_firm()) {
                         throw log::error(this, "Agent ", agent_name, " is not a firm");
                     }
-                    set_firm_property(agent->as_firm(), it, reset);
+                    compile_firm_property(agent->as_firm(), it, actions);
                 } else if (it.has("sector")) {
                     auto* sector = model()->sectors.find(it["sector"].as<std::string>());
                     if (sector == nullptr) {
@@ -100,10 +133,10 @@ void Scenario::apply_target(const settings::SettingsNode& node, bool reset) {
                         if (firm == nullptr) {
                             throw log::error(this, "Firm ", it["sector"].as<std::string>(), ":", it["region"].as<std::string>(), " not found");
                         }
-                        set_firm_property(firm, it, reset);
+                        compile_firm_property(firm, it, actions);
                     } else {
                         for (auto& p : sector->firms) {
-                            set_firm_property(p, it, reset);
+                            compile_firm_property(p, it, actions);
                         }
                     }
                 } else {
@@ -114,13 +147,13 @@ void Scenario::apply_target(const settings::SettingsNode& node, bool reset) {
                         }
                         for (auto& ea : region->economic_agents) {
                             if (ea->type == EconomicAgent::type_t::FIRM) {
-                                set_firm_property(ea->as_firm(), it, reset);
+                                compile_firm_property(ea->as_firm(), it, actions);
                             }
                         }
                     } else {
                         for (auto& s : model()->sectors) {
                             for (auto& p : s->firms) {
-                                set_firm_property(p, it, reset);
+                                compile_firm_property(p, it, actions);
                             }
                         }
                     }
@@ -133,14 +166,14 @@ void Scenario::apply_target(const settings::SettingsNode& node, bool reset) {
                     }
                     for (auto& ea : region->economic_agents) {
                         if (ea->type == EconomicAgent::type_t::CONSUMER) {
-                            set_consumer_property(ea->as_consumer(), it, reset);
+                            compile_consumer_property(ea->as_consumer(), it, actions);
                         }
                     }
                 } else {
                     for (auto& r : model()->regions) {
                         for (auto& ea : r->economic_agents) {
                             if (ea->type == EconomicAgent::type_t::CONSUMER) {
-                                set_consumer_property(ea->as_consumer(), it, reset);
+                                compile_consumer_property(ea->as_consumer(), it, actions);
                             }
                         }
                     }
@@ -151,26 +184,54 @@ void Scenario::apply_target(const settings::SettingsNode& node, bool reset) {
                     if (location == nullptr) {
                         throw log::error(this, "Sea route ", it["sea_route"].as<std::string>(), " not found");
                     }
-                    set_location_property(location, it, reset);
+                    compile_location_property(location, it, actions);
                 }
             }
         }
     }
 }
 
-void Scenario::iterate() {
+void Scenario::start() {
+    std::size_t index = 0;
     for (const auto& event : scenario_node["events"].as_sequence()) {
         const std::string& type = event["type"].as<std::string>();
         if (type == "shock") {
-            const Time from = event["from"].as<Time>();
-            const Time to = event["to"].as<Time>();
-            if (model()->time() >= from && model()->time() <= to) {
-                apply_target(event["targets"], false);
-            } else if (model()->time() == to + model()->delta_t()) {
-                apply_target(event["targets"], true);
+            Event compiled;
+            compiled.index = index;
+            compiled.from = event["from"].as<Time>();
+            compiled.to = event["to"].as<Time>();
+            compile_targets(event["targets"], compiled.actions);
+            timeline.emplace_back(std::move(compiled));
+        }
+        ++index;
+    }
+    std::stable_sort(std::begin(timeline), std::end(timeline), [](const Event& a, const Event& b) { return a.from < b.from; });
+}
+
+void Scenario::iterate() {
+    const auto time = model()->time();
+    while (next_event < timeline.size() && timeline[next_event].from <= time) {
+        const auto* event = &timeline[next_event];
+        active_events.insert(std::upper_bound(std::begin(active_events), std::end(active_events), event,
+                                              [](const Event* a, const Event* b) { return a->index < b->index; }),
+                             event);
+        ++next_event;
+    }
+    // events are applied in the order they are given in the settings, so later ones take precedence
+    for (const auto* event : active_events) {
+        if (time <= event->to) {
+            for (const auto& action : event->actions) {
+                action.apply(false);
+            }
+        } else if (time == event->to + model()->delta_t()) {
+            for (const auto& action : event->actions) {
+                action.apply(true);
             }
         }
     }
+    // events past their end have been reset (or started after their reset time) and are not needed anymore
+    active_events.erase(std::remove_if(std::begin(active_events), std::end(active_events), [&](const Event* event) { return time > event->to; }),
+                        std::end(active_events));
 }
 
 std::string Scenario::time_units_str() const {